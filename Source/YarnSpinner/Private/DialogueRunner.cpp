@@ -6,7 +6,13 @@
 #include "Option.h"
 #include "YarnSubsystem.h"
 #include "YarnSpinner.h"
+#include "YarnDialogueNetRelay.h"
+#include "GameplayTasksComponent.h"
+#include "Library/YarnCommandHandle.h"
+#include "Library/YarnNativeFunctionRegistry.h"
+#include "Async/Async.h"
 #include "Kismet/KismetInternationalizationLibrary.h"
+#include "Misc/MarkupParser.h"
 #include "Misc/YSLogging.h"
 
 THIRD_PARTY_INCLUDES_START
@@ -28,6 +34,13 @@ void ADialogueRunner::PreInitializeComponents()
 {
     Super::PreInitializeComponents();
 
+    if (bServerAuthoritative)
+    {
+        // Every client needs the content stream, wherever it is
+        SetReplicates(true);
+        bAlwaysRelevant = true;
+    }
+
     if (!YarnProject)
     {
         UE_LOG(LogYarnSpinner, Error, TEXT("DialogueRunner can't initialize, because it doesn't have a Yarn Asset."));
@@ -36,6 +49,13 @@ void ADialogueRunner::PreInitializeComponents()
 
     YarnProject->Init();
 
+    // Clients are sent their content by the server, so they never run the script
+    if (IsNetworkedClient())
+    {
+        YS_LOG("%s is a client of server-authoritative dialogue, so it doesn't load the program", *GetName())
+        return;
+    }
+
     Yarn::Program Program{};
 
     bool bParseSuccess = Program.ParsePartialFromArray(YarnProject->Data.GetData(), YarnProject->Data.Num());
@@ -49,8 +69,11 @@ void ADialogueRunner::PreInitializeComponents()
     // Create the Library
     Library = TUniquePtr<Yarn::Library>(new Yarn::Library(*this));
 
-    UYarnSubsystem* SS = YarnSubsystem();
-
+    // Load the Blueprint libraries this program uses now, rather than on their first call
+    if (UYarnSubsystem* SS = YarnSubsystem())
+    {
+        SS->GetYarnLibraryRegistry()->LinkProgram(Program);
+    }
 
     // Create the VirtualMachine, supplying it with the loaded Program and
     // configuring it to use our library, plus use this ADialogueRunner as the
@@ -58,49 +81,85 @@ void ADialogueRunner::PreInitializeComponents()
     // VirtualMachine = TUniquePtr<Yarn::VirtualMachine>(new Yarn::VirtualMachine(Program, *(Library), *this, *this));
     VirtualMachine = TUniquePtr<Yarn::VirtualMachine>(new Yarn::VirtualMachine(Program, *this, *this));
 
+    // Jumps look nodes up through the project's node hash instead of the program's map
+    NodesByIndex.Reset(YarnProject->NodeNames.Num());
+    const auto& Nodes = VirtualMachine->GetProgram().nodes();
+    for (const FString& NodeName : YarnProject->NodeNames)
+    {
+        const auto Found = Nodes.find(TCHAR_TO_UTF8(*NodeName));
+        if (Found == Nodes.end())
+        {
+            break;
+        }
+        NodesByIndex.Add(&Found->second);
+    }
+    if (NodesByIndex.Num() == static_cast<int32>(Nodes.size()))
+    {
+        VirtualMachine->FindNode = [this](const char* NodeName) -> const Yarn::Node*
+        {
+            const FUTF8ToTCHAR Name(NodeName);
+            const int32 Index = YarnProject->GetNodeIndex(FStringView(Name.Get(), Name.Length()));
+            return NodesByIndex.IsValidIndex(Index) ? NodesByIndex[Index] : nullptr;
+        };
+    }
+    else
+    {
+        NodesByIndex.Reset();
+    }
+
     VirtualMachine->LineHandler = [this](Yarn::Line& Line)
     {
         UE_LOG(LogYarnSpinner, Log, TEXT("Received line %s"), UTF8_TO_TCHAR(Line.LineID.c_str()));
+        if (PrefetchLines > 0)
+        {
+            const FUTF8ToTCHAR LineID(Line.LineID.c_str());
+            UpdatePrefetch(VirtualMachine->GetProgramCounter() + 1, YarnProject->LineTable.Find(FStringView(LineID.Get(), LineID.Length())));
+        }
 
-        // Get the Yarn line struct, and make a ULine out of it to use
-        ULine* LineObject = NewObject<ULine>(this);
-        LineObject->LineID = FName(Line.LineID.c_str());
-
-        GetDisplayTextForLine(LineObject, Line);
+        if (bServerAuthoritative)
+        {
+            FlushVariableDeltas();
+            MulticastRunLine(++ContentSequence, MakeNetLine(Line));
+            return;
+        }
 
-        const TArray<TSoftObjectPtr<UObject>> LineAssets = YarnProject->GetLineAssets(LineObject->LineID);
-        YS_LOG_FUNC("Got %d line assets for line '%s'", LineAssets.Num(), *LineObject->LineID.ToString())
+        if (MaxLinesPerBatch > 1 && !DialogueListener)
+        {
+            BatchLine(Line);
+            return;
+        }
 
-        OnRunLine(LineObject, LineAssets);
+        PresentLine(Line);
     };
 
     VirtualMachine->OptionsHandler = [this](Yarn::OptionSet& OptionSet)
     {
         UE_LOG(LogYarnSpinner, Log, TEXT("Received %i options"), OptionSet.Options.size());
+        FlushLineBatch(false);
 
-        // Build a TArray for every option in this OptionSet
-        TArray<UOption*> Options;
-
-        for (auto Option : OptionSet.Options)
+        TArray<std::string, TInlineAllocator<8>> Destinations;
+        for (const Yarn::Option& Option : OptionSet.Options)
         {
-            UE_LOG(LogYarnSpinner, Log, TEXT("- %i: %s"), Option.ID, UTF8_TO_TCHAR(Option.Line.LineID.c_str()));
-
-            UOption* Opt = NewObject<UOption>(this);
-            Opt->OptionID = Option.ID;
-
-            Opt->Line = NewObject<ULine>(Opt);
-            Opt->Line->LineID = FName(Option.Line.LineID.c_str());
-
-            GetDisplayTextForLine(Opt->Line, Option.Line);
-
-            Opt->bIsAvailable = Option.IsAvailable;
-
-            Opt->SourceDialogueRunner = this;
+            Destinations.Add(Option.DestinationNode);
+        }
+        UpdatePrefetch(VirtualMachine->GetProgramCounter() + 1, INDEX_NONE, Destinations);
 
-            Options.Add(Opt);
+        if (bServerAuthoritative)
+        {
+            CurrentNetOptions.Reset(OptionSet.Options.size());
+            for (const Yarn::Option& Option : OptionSet.Options)
+            {
+                FYarnNetOption& NetOption = CurrentNetOptions.AddDefaulted_GetRef();
+                NetOption.Line = MakeNetLine(Option.Line);
+                NetOption.OptionID = Option.ID;
+                NetOption.bIsAvailable = Option.IsAvailable;
+            }
+            FlushVariableDeltas();
+            MulticastRunOptions(++ContentSequence, CurrentNetOptions);
+            return;
         }
 
-        OnRunOptions(Options);
+        PresentOptions(OptionSet);
     };
 
     VirtualMachine->DoesFunctionExist = [this](const std::string& FunctionName) -> bool
@@ -113,17 +172,31 @@ void ADialogueRunner::PreInitializeComponents()
         return YarnSubsystem()->GetYarnLibraryRegistry()->GetExpectedFunctionParamCount(FName(UTF8_TO_TCHAR(FunctionName.c_str())));
     };
 
-    VirtualMachine->CallFunction = [this](const std::string& FunctionName, const std::vector<Yarn::Value>& Parameters) -> Yarn::Value
+    VirtualMachine->CallFunction = [this](const std::string& FunctionName, const Yarn::Value* Parameters, size_t ParameterCount) -> Yarn::Value
     {
-        return YarnSubsystem()->GetYarnLibraryRegistry()->CallFunction(
-            FName(UTF8_TO_TCHAR(FunctionName.c_str())),
-            TArray<Yarn::Value>(Parameters.data(), Parameters.size())
+        const FName Name = FName(UTF8_TO_TCHAR(FunctionName.c_str()));
+        FYarnPendingFunctionResult Pending;
+        Yarn::Value Result = YarnSubsystem()->GetYarnLibraryRegistry()->CallFunction(
+            Name,
+            TArrayView<const Yarn::Value>(Parameters, ParameterCount),
+            &Pending
         );
+
+        if (Pending.Future.IsValid())
+        {
+            if (Pending.Future.IsReady())
+            {
+                return Pending.Future.Get();
+            }
+            AwaitFunctionResult(Name, MoveTemp(Pending));
+        }
+        return Result;
     };
 
     VirtualMachine->CommandHandler = [this](Yarn::Command& Command)
     {
         UE_LOG(LogYarnSpinner, Log, TEXT("Received command \"%s\""), UTF8_TO_TCHAR(Command.Text.c_str()));
+        FlushLineBatch(false);
 
         FString CommandText = FString(UTF8_TO_TCHAR(Command.Text.c_str()));
 
@@ -141,24 +214,37 @@ void ADialogueRunner::PreInitializeComponents()
         FName CommandName = FName(CommandElements[0]);
         CommandElements.RemoveAt(0);
 
+        const int32 LatentCommandsStartedBefore = LatentCommandsStarted;
+        TGuardValue<FName> CommandNameGuard(CurrentCommandName, CommandName);
+
         auto Lib = YarnSubsystem()->GetYarnLibraryRegistry();
 
         if (Lib->HasCommand(CommandName))
         {
-            return Lib->CallCommand(
+            Lib->CallCommand(
                 CommandName,
                 this,
                 CommandElements
             );
+            ResolveCommandWait(LatentCommandsStartedBefore);
+            return;
         }
 
         // Haven't handled the function yet, so call the DialogueRunner's handler
+        if (bServerAuthoritative)
+        {
+            FlushVariableDeltas();
+            MulticastRunCommand(++ContentSequence, CommandName.ToString(), CommandElements);
+            return;
+        }
         OnRunCommand(CommandName.ToString(), CommandElements);
+        ResolveCommandWait(LatentCommandsStartedBefore);
     };
 
     VirtualMachine->NodeStartHandler = [this](std::string NodeName)
     {
         UE_LOG(LogYarnSpinner, Log, TEXT("Received node start \"%s\""), UTF8_TO_TCHAR(NodeName.c_str()));
+        UpdatePrefetch(0);
     };
 
     VirtualMachine->NodeCompleteHandler = [this](std::string NodeName)
@@ -169,15 +255,46 @@ void ADialogueRunner::PreInitializeComponents()
     VirtualMachine->DialogueCompleteHandler = [this]()
     {
         UE_LOG(LogYarnSpinner, Log, TEXT("Received dialogue complete"));
+        FlushLineBatch(false);
+        ReleasePrefetch();
+        // Parallel commands still running are left to finish on their own
+        bRunCommandsInParallel = false;
+        bJoiningCommands = false;
+        if (bServerAuthoritative)
+        {
+            FlushVariableDeltas();
+            MulticastDialogueEnded();
+            return;
+        }
         OnDialogueEnded();
     };
 }
 
 
+void ADialogueRunner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    CancelLatentCommands();
+    CancelPendingFunction();
+    ReleasePrefetch();
+    Prefetcher.Reset();
+    if (UYarnSubsystem* Subsystem = YarnSubsystem())
+    {
+        Subsystem->GetTimerWheel().CancelAll(this);
+    }
+    Super::EndPlay(EndPlayReason);
+}
+
+
 // Called every frame
 void ADialogueRunner::Tick(float DeltaTime)
 {
     Super::Tick(DeltaTime);
+
+    // Changes made by commands or between content still need to reach clients
+    if (PendingVariableDeltas.Num() > 0)
+    {
+        FlushVariableDeltas();
+    }
 }
 
 
@@ -201,6 +318,17 @@ void ADialogueRunner::OnRunLine_Implementation(ULine* Line, const TArray<TSoftOb
 }
 
 
+void ADialogueRunner::OnRunLineBatch_Implementation(const TArray<FYarnBatchedLine>& Lines, bool bWaitingForContinue)
+{
+    // default = log and continue if the dialogue is waiting
+    UE_LOG(LogYarnSpinner, Warning, TEXT("DialogueRunner received a batch of %i lines. Implement OnRunLineBatch to customise its behaviour."), Lines.Num());
+    if (bWaitingForContinue)
+    {
+        ContinueDialogue();
+    }
+}
+
+
 void ADialogueRunner::OnRunOptions_Implementation(const TArray<class UOption*>& Options)
 {
     // default = log and choose the first option
@@ -221,17 +349,37 @@ void ADialogueRunner::OnRunCommand_Implementation(const FString& Command, const
 /** Starts running dialogue from the given node name. */
 void ADialogueRunner::StartDialogue(FName NodeName)
 {
+    if (IsNetworkedClient())
+    {
+        UE_LOG(LogYarnSpinner, Error, TEXT("DialogueRunner can't start node %s on a client, because it is server-authoritative."), *NodeName.ToString());
+        return;
+    }
+
     if (VirtualMachine.IsValid() == false)
     {
         UE_LOG(LogYarnSpinner, Error, TEXT("DialogueRunner can't start node %s, because it failed to load a Yarn asset."), *NodeName.ToString());
         return;
     }
 
+    // Nothing from a previous run should be able to continue this one
+    CancelLatentCommands();
+    CancelPendingFunction();
+    bYieldQueued = false;
+    LineBatch.Reset();
+    bRunOnFromBatchedLine = false;
+
     bool bNodeSelected = VirtualMachine->SetNode(TCHAR_TO_UTF8(*NodeName.ToString()));
 
     if (bNodeSelected)
     {
-        OnDialogueStarted();
+        if (bServerAuthoritative)
+        {
+            MulticastDialogueStarted();
+        }
+        else
+        {
+            OnDialogueStarted();
+        }
         ContinueDialogue();
     }
     else
@@ -247,27 +395,407 @@ void ADialogueRunner::ContinueDialogue()
 {
     YS_LOG_FUNCSIG
 
+    // Whatever was handed out for the last content is finished with
+    ReleaseContentObjects();
+
+    if (IsNetworkedClient())
+    {
+        if (UYarnDialogueNetRelay* Relay = UYarnDialogueNetRelay::FindLocal(GetWorld()))
+        {
+            Relay->ServerContinueDialogue(this, ContentSequence);
+        }
+        else
+        {
+            UE_LOG(LogYarnSpinner, Error, TEXT("DialogueRunner can't continue: server-authoritative dialogue needs a YarnDialogueNetRelay on the local PlayerController."));
+        }
+        return;
+    }
+
     if (VirtualMachine->GetCurrentExecutionState() == Yarn::VirtualMachine::ExecutionState::ERROR)
     {
         UE_LOG(LogYarnSpinner, Error, TEXT("VirtualMachine is in an error state and cannot continue running."));
         return;
     }
 
-    VirtualMachine->Continue();
+    if (bYieldQueued)
+    {
+        // The script is already set to carry on next frame; continuing now as well would skip content
+        YS_VERBOSE("Ignoring ContinueDialogue: the dialogue is waiting for the next frame to carry on")
+        return;
+    }
+
+    UYarnSubsystem* Subsystem = YarnSubsystem();
+    Yarn::VirtualMachine::ExecutionBudget Budget;
+    // Continuing from inside a handler only marks the VM to carry on, so it's never held back
+    const bool bNested = VirtualMachine->GetCurrentExecutionState() == Yarn::VirtualMachine::ExecutionState::DELIVERING_CONTENT;
+    if (Subsystem && !Subsystem->GetExecutionBudget(Budget) && !bNested)
+    {
+        QueueYield();
+        return;
+    }
+
+    double StartTime = FPlatformTime::Seconds();
+    VirtualMachine->Continue(Budget);
+    if (!bNested)
+    {
+        // A batched line parks the VM like any other, and it's run on from here rather than from inside the line
+        // handler, until the batch is full, the VM stops for something else or the frame's budget runs out
+        while (bRunOnFromBatchedLine && LineBatch.Num() < MaxLinesPerBatch
+            && VirtualMachine->GetCurrentExecutionState() == Yarn::VirtualMachine::ExecutionState::WAITING_FOR_CONTINUE)
+        {
+            bRunOnFromBatchedLine = false;
+            if (Subsystem)
+            {
+                const double Now = FPlatformTime::Seconds();
+                Subsystem->ChargeExecutionTime(Now - StartTime);
+                StartTime = Now;
+                if (!Subsystem->GetExecutionBudget(Budget))
+                {
+                    break;
+                }
+            }
+            VirtualMachine->Continue(Budget);
+        }
+        bRunOnFromBatchedLine = false;
+
+        if (Subsystem)
+        {
+            Subsystem->ChargeExecutionTime(FPlatformTime::Seconds() - StartTime);
+        }
+    }
 
     Yarn::VirtualMachine::ExecutionState State = VirtualMachine->GetCurrentExecutionState();
 
+    // The VM has stopped, so whatever lines it ran ahead through go out now
+    if (!bNested)
+    {
+        FlushLineBatch(State == Yarn::VirtualMachine::ExecutionState::WAITING_FOR_CONTINUE);
+    }
+
     if (State == Yarn::VirtualMachine::ExecutionState::ERROR)
     {
         UE_LOG(LogYarnSpinner, Error, TEXT("VirtualMachine encountered an error."));
         return;
     }
+
+    if (State == Yarn::VirtualMachine::ExecutionState::YIELDED)
+    {
+        YS_VERBOSE("Dialogue ran out of budget after %d instructions; carrying on next frame", VirtualMachine->GetLastInstructionCount())
+        QueueYield();
+    }
+}
+
+
+void ADialogueRunner::QueueYield()
+{
+    UYarnSubsystem* Subsystem = YarnSubsystem();
+    if (!Subsystem)
+    {
+        return;
+    }
+    bYieldQueued = true;
+    Subsystem->QueueYieldedRunner(this);
+}
+
+
+void ADialogueRunner::ResumeAfterYield()
+{
+    // Stopped or restarted since it yielded
+    if (!bYieldQueued)
+    {
+        return;
+    }
+    bYieldQueued = false;
+    ContinueDialogue();
+}
+
+
+void ADialogueRunner::StopDialogue()
+{
+    if (IsNetworkedClient())
+    {
+        UE_LOG(LogYarnSpinner, Error, TEXT("DialogueRunner can't stop dialogue on a client, because it is server-authoritative."));
+        return;
+    }
+
+    if (!VirtualMachine.IsValid() || VirtualMachine->GetCurrentExecutionState() == Yarn::VirtualMachine::ExecutionState::STOPPED)
+    {
+        return;
+    }
+
+    CancelLatentCommands();
+    CancelPendingFunction();
+    bYieldQueued = false;
+    LineBatch.Reset();
+    bRunOnFromBatchedLine = false;
+    ReleaseContentObjects();
+    ReleasePrefetch();
+    VirtualMachine->Stop();
+
+    if (bServerAuthoritative)
+    {
+        FlushVariableDeltas();
+        MulticastDialogueEnded();
+    }
+    else
+    {
+        OnDialogueEnded();
+    }
+}
+
+
+FYarnPrefetchStats ADialogueRunner::GetPrefetchStats() const
+{
+    return Prefetcher.IsValid() ? Prefetcher->GetStats() : FYarnPrefetchStats();
+}
+
+
+void ADialogueRunner::UpdatePrefetch(int32 ProgramCounter, int32 KeepLine, TArrayView<const std::string> Destinations)
+{
+    if (PrefetchLines <= 0 || !ShouldPresentLocally() || !VirtualMachine.IsValid())
+    {
+        return;
+    }
+
+    if (!Prefetcher.IsValid())
+    {
+        Prefetcher = MakeUnique<FYarnLinePrefetcher>(YarnProject, VirtualMachine->GetProgram());
+    }
+    Prefetcher->MaxLines = PrefetchLines;
+    Prefetcher->MaxNodeJumps = PrefetchNodeJumps;
+
+    if (KeepLine != INDEX_NONE)
+    {
+        Prefetcher->RecordLine(KeepLine);
+    }
+    Prefetcher->Update(VirtualMachine->GetCurrentNodeName(), ProgramCounter, Destinations, KeepLine);
+}
+
+
+void ADialogueRunner::ReleasePrefetch()
+{
+    if (Prefetcher.IsValid())
+    {
+        Prefetcher->ReleaseAll();
+    }
+}
+
+
+UYarnCommandHandle* ADialogueRunner::BeginLatentCommand(FName CommandName)
+{
+    UYarnCommandHandle* Handle = NewObject<UYarnCommandHandle>(this);
+    Handle->Start(this, CommandName.IsNone() ? CurrentCommandName : CommandName, bRunCommandsInParallel, LatentCommandTimeout);
+    Handle->bContinueWhenDone = bPresentingNetCommand || IsNetworkedClient();
+    RunningCommands.Add(Handle);
+    LatentCommandsStarted++;
+
+    YS_LOG("Latent command '%s' started%s", *Handle->CommandName.ToString(), bRunCommandsInParallel ? TEXT(" in parallel") : TEXT(""))
+    return Handle;
+}
+
+
+void ADialogueRunner::BeginParallelCommands()
+{
+    bRunCommandsInParallel = true;
+    ContinueDialogue();
+}
+
+
+void ADialogueRunner::JoinCommands()
+{
+    bRunCommandsInParallel = false;
+    bJoiningCommands = true;
+    if (IsWaitingOnCommands() && VirtualMachine->WaitOnCommand())
+    {
+        YS_LOG("Joining %d running commands", RunningCommands.Num())
+        return;
+    }
+    bJoiningCommands = false;
+    ContinueDialogue();
+}
+
+
+UGameplayTasksComponent* ADialogueRunner::FindOrAddGameplayTasksComponent()
+{
+    if (!GameplayTasksComponent)
+    {
+        GameplayTasksComponent = FindComponentByClass<UGameplayTasksComponent>();
+    }
+    if (!GameplayTasksComponent)
+    {
+        GameplayTasksComponent = NewObject<UGameplayTasksComponent>(this, TEXT("YarnGameplayTasks"));
+        GameplayTasksComponent->RegisterComponent();
+    }
+    return GameplayTasksComponent;
+}
+
+
+bool ADialogueRunner::IsWaitingOnCommands() const
+{
+    return RunningCommands.ContainsByPredicate([this](const UYarnCommandHandle* Handle)
+    {
+        return !Handle->bContinueWhenDone && (bJoiningCommands || !Handle->bParallel);
+    });
+}
+
+
+void ADialogueRunner::ResolveCommandWait(int32 LatentCommandsStartedBefore)
+{
+    // Either the command already continued, or it's an old-style command that will call ContinueDialogue itself
+    if (LatentCommandsStarted == LatentCommandsStartedBefore || VirtualMachine->GetCurrentExecutionState() != Yarn::VirtualMachine::ExecutionState::DELIVERING_CONTENT)
+    {
+        return;
+    }
+
+    if (IsWaitingOnCommands())
+    {
+        VirtualMachine->WaitOnCommand();
+        return;
+    }
+    ContinueDialogue();
+}
+
+
+void ADialogueRunner::LatentCommandFinished(UYarnCommandHandle* Handle)
+{
+    RunningCommands.Remove(Handle);
+
+    if (Handle->bContinueWhenDone)
+    {
+        // Stands in for the ContinueDialogue a replicated command would otherwise call
+        if (!RunningCommands.ContainsByPredicate([](const UYarnCommandHandle* Other) { return Other->bContinueWhenDone; }))
+        {
+            ContinueDialogue();
+        }
+        return;
+    }
+
+    // Still inside the command's own call (ResolveCommandWait deals with it), or running in parallel
+    if (!VirtualMachine.IsValid() || VirtualMachine->GetCurrentExecutionState() != Yarn::VirtualMachine::ExecutionState::WAITING_ON_COMMAND || IsWaitingOnCommands())
+    {
+        return;
+    }
+
+    bJoiningCommands = false;
+    VirtualMachine->CompleteCommand();
+    ContinueDialogue();
+}
+
+
+void ADialogueRunner::CancelLatentCommands()
+{
+    bRunCommandsInParallel = false;
+    bJoiningCommands = false;
+
+    // Cancelling can run arbitrary Blueprint code, so work from a copy
+    TArray<TObjectPtr<UYarnCommandHandle>> Cancelled = MoveTemp(RunningCommands);
+    RunningCommands.Reset();
+    for (UYarnCommandHandle* Handle : Cancelled)
+    {
+        Handle->Cancel();
+    }
+}
+
+
+void ADialogueRunner::AwaitFunctionResult(FName FunctionName, FYarnPendingFunctionResult&& Pending)
+{
+    if (!VirtualMachine->WaitOnFunction())
+    {
+        return;
+    }
+
+    const uint32 Serial = ++LastFunctionSerial;
+    AwaitedFunctionSerial = Serial;
+    YS_LOG("Waiting on async function '%s'", *FunctionName.ToString())
+
+    // The future can be fulfilled on any thread, but the VM only runs on the game thread
+    TWeakObjectPtr<ADialogueRunner> WeakThis(this);
+    Pending.Future.Then([WeakThis, Serial](TFuture<Yarn::Value> Result)
+    {
+        AsyncTask(ENamedThreads::GameThread, [WeakThis, Serial, Value = Result.Get()]()
+        {
+            if (ADialogueRunner* Runner = WeakThis.Get())
+            {
+                Runner->ResumeFunction(Serial, Value);
+            }
+        });
+    });
+
+    // Timed on the subsystem's wheel like every other dialogue timer, so EndPlay's CancelAll covers it too
+    UYarnSubsystem* Subsystem = Pending.Timeout > 0 ? YarnSubsystem() : nullptr;
+    if (Subsystem)
+    {
+        FunctionTimeoutHandle = Subsystem->GetTimerWheel().Schedule(Pending.Timeout, [WeakThis, Serial, FunctionName, Timeout = Pending.Timeout, TimeoutValue = Pending.TimeoutValue]()
+        {
+            if (ADialogueRunner* Runner = WeakThis.Get())
+            {
+                YS_WARN("Async function '%s' didn't return within %.1f seconds; using \"%s\" instead", *FunctionName.ToString(), Timeout, UTF8_TO_TCHAR(TimeoutValue.ConvertToString().c_str()))
+                Runner->FunctionTimeoutHandle.Invalidate();
+                Runner->ResumeFunction(Serial, TimeoutValue);
+            }
+        }, this);
+    }
+}
+
+
+void ADialogueRunner::ResumeFunction(uint32 Serial, const Yarn::Value& Value)
+{
+    // A late result after a timeout, or from a dialogue that's since been stopped
+    if (Serial != AwaitedFunctionSerial)
+    {
+        return;
+    }
+
+    CancelPendingFunction();
+    if (VirtualMachine.IsValid() && VirtualMachine->ResumeWithValue(Value))
+    {
+        ContinueDialogue();
+    }
+}
+
+
+void ADialogueRunner::CancelPendingFunction()
+{
+    AwaitedFunctionSerial = 0;
+    if (FunctionTimeoutHandle.IsValid())
+    {
+        if (UYarnSubsystem* Subsystem = YarnSubsystem())
+        {
+            Subsystem->GetTimerWheel().Cancel(FunctionTimeoutHandle);
+        }
+        FunctionTimeoutHandle.Invalidate();
+    }
 }
 
 
 /** Indicates to the dialogue runner that an option was selected. */
 void ADialogueRunner::SelectOption(UOption* Option)
 {
+    SelectOptionInternal(Option->OptionID, Option->Line);
+}
+
+
+void ADialogueRunner::SelectOptionByID(int32 OptionID)
+{
+    SelectOptionInternal(OptionID, nullptr);
+}
+
+
+void ADialogueRunner::SelectOptionInternal(int32 OptionID, ULine* OptionLine)
+{
+    if (IsNetworkedClient())
+    {
+        if (UYarnDialogueNetRelay* Relay = UYarnDialogueNetRelay::FindLocal(GetWorld()))
+        {
+            Relay->ServerSelectOption(this, ContentSequence, OptionID);
+        }
+        else
+        {
+            UE_LOG(LogYarnSpinner, Error, TEXT("DialogueRunner can't select an option: server-authoritative dialogue needs a YarnDialogueNetRelay on the local PlayerController."));
+        }
+        return;
+    }
+
     Yarn::VirtualMachine::ExecutionState State = this->VirtualMachine->GetCurrentExecutionState();
 
     if (State != Yarn::VirtualMachine::ExecutionState::WAITING_ON_OPTION_SELECTION)
@@ -276,24 +804,410 @@ void ADialogueRunner::SelectOption(UOption* Option)
         return;
     }
 
-    UE_LOG(LogYarnSpinner, Log, TEXT("Selected option %i (%s)"), Option->OptionID, *Option->Line->LineID.ToString());
+    UE_LOG(LogYarnSpinner, Log, TEXT("Selected option %i (%s)"), OptionID, OptionLine ? *OptionLine->LineID.ToString() : TEXT("-"));
+
+    ApplySelectedOption(OptionID, OptionLine);
+}
+
 
-    VirtualMachine->SetSelectedOption(Option->OptionID);
+void ADialogueRunner::ApplySelectedOption(int32 OptionID, ULine* OptionLine)
+{
+    VirtualMachine->SetSelectedOption(OptionID);
 
     if (bRunSelectedOptionsAsLines)
     {
-        const TArray<TSoftObjectPtr<UObject>> LineAssets = YarnProject->GetLineAssets(Option->Line->LineID);
-        YS_LOG_FUNC("Got %d line assets for line '%s'", LineAssets.Num(), *Option->Line->LineID.ToString())
+        if (bServerAuthoritative)
+        {
+            const FYarnNetOption* Selected = CurrentNetOptions.FindByPredicate([OptionID](const FYarnNetOption& Option) { return Option.OptionID == OptionID; });
+            if (Selected)
+            {
+                FlushVariableDeltas();
+                MulticastRunLine(++ContentSequence, Selected->Line);
+                return;
+            }
+        }
+        else if (OptionLine)
+        {
+            const TArray<TSoftObjectPtr<UObject>>& LineAssets = YarnProject->FindLineAssets(OptionLine->LineID);
+            YS_LOG_FUNC("Got %d line assets for line '%s'", LineAssets.Num(), *OptionLine->LineID.ToString())
+
+            OnRunLine(OptionLine, LineAssets);
+            return;
+        }
+    }
+
+    ContinueDialogue();
+}
+
+
+void ADialogueRunner::HandleClientContinue(int32 Sequence)
+{
+    // Every client answers the same content, so only the first answer to the latest content counts
+    if (Sequence != ContentSequence)
+    {
+        YS_VERBOSE("Ignoring stale continue request (sequence %d, current %d)", Sequence, ContentSequence)
+        return;
+    }
+    if (!VirtualMachine || VirtualMachine->GetCurrentExecutionState() != Yarn::VirtualMachine::ExecutionState::WAITING_FOR_CONTINUE)
+    {
+        YS_VERBOSE("Ignoring continue request while the dialogue isn't waiting for one")
+        return;
+    }
+    ContinueDialogue();
+}
+
+
+void ADialogueRunner::HandleClientSelectOption(int32 Sequence, int32 OptionID)
+{
+    if (Sequence != ContentSequence)
+    {
+        YS_VERBOSE("Ignoring stale option selection (sequence %d, current %d)", Sequence, ContentSequence)
+        return;
+    }
+    if (!VirtualMachine || VirtualMachine->GetCurrentExecutionState() != Yarn::VirtualMachine::ExecutionState::WAITING_ON_OPTION_SELECTION)
+    {
+        YS_VERBOSE("Ignoring option selection while the dialogue isn't waiting for one")
+        return;
+    }
+    if (!CurrentNetOptions.ContainsByPredicate([OptionID](const FYarnNetOption& Option) { return Option.OptionID == OptionID; }))
+    {
+        YS_WARN("Ignoring selection of option %d, which isn't on offer", OptionID)
+        return;
+    }
+
+    UE_LOG(LogYarnSpinner, Log, TEXT("Client selected option %i"), OptionID);
+    ApplySelectedOption(OptionID, nullptr);
+}
+
+
+void ADialogueRunner::PresentLine(const Yarn::Line& Line)
+{
+    if (DialogueListener && DialogueListener->HandleLine(*this, MakeLineView(Line)))
+    {
+        return;
+    }
+
+    // Get the Yarn line struct, and make a ULine out of it to use
+    ULine* LineObject = AcquireLine();
+    LineObject->LineID = FName(Line.LineID.c_str());
+
+    GetDisplayTextForLine(LineObject, Line);
+
+    const TArray<TSoftObjectPtr<UObject>>& LineAssets = YarnProject->FindLineAssets(LineObject->LineID);
+    YS_LOG_FUNC("Got %d line assets for line '%s'", LineAssets.Num(), *LineObject->LineID.ToString())
+
+    OnRunLine(LineObject, LineAssets);
+}
+
+
+void ADialogueRunner::BatchLine(const Yarn::Line& Line)
+{
+    FYarnBatchedLine& Batched = LineBatch.AddDefaulted_GetRef();
+    Batched.Line = AcquireLine();
+    Batched.Line->LineID = FName(Line.LineID.c_str());
+
+    GetDisplayTextForLine(Batched.Line, Line);
 
-        OnRunLine(Option->Line, LineAssets);
+    Batched.LineAssets = YarnProject->FindLineAssets(Batched.Line->LineID);
+
+    // Leave the VM waiting for a continue; ContinueDialogue runs on to the next line unless the batch is full, and sends
+    // the batch once the VM stops
+    bRunOnFromBatchedLine = true;
+}
+
+
+void ADialogueRunner::FlushLineBatch(bool bWaitingForContinue)
+{
+    if (LineBatch.Num() == 0)
+    {
+        return;
+    }
+
+    // Taken first, as the handler may well continue the dialogue and start another batch
+    const TArray<FYarnBatchedLine> Lines = MoveTemp(LineBatch);
+    LineBatch.Reset();
+    YS_LOG_FUNC("Sending a batch of %d lines", Lines.Num())
+    OnRunLineBatch(Lines, bWaitingForContinue);
+}
+
+
+void ADialogueRunner::PresentOptions(const Yarn::OptionSet& OptionSet)
+{
+    if (DialogueListener)
+    {
+        TArray<FYarnOptionView, TInlineAllocator<8>> Views;
+        for (const Yarn::Option& Option : OptionSet.Options)
+        {
+            FYarnOptionView& View = Views.AddDefaulted_GetRef();
+            View.OptionID = Option.ID;
+            View.bIsAvailable = Option.IsAvailable;
+            View.Line = MakeLineView(Option.Line);
+        }
+        if (DialogueListener->HandleOptions(*this, Views))
+        {
+            return;
+        }
+    }
+
+    // Build a TArray for every option in this OptionSet
+    TArray<UOption*> Options;
+
+    for (const Yarn::Option& Option : OptionSet.Options)
+    {
+        UE_LOG(LogYarnSpinner, Log, TEXT("- %i: %s"), Option.ID, UTF8_TO_TCHAR(Option.Line.LineID.c_str()));
+
+        UOption* Opt = AcquireOption();
+        Opt->OptionID = Option.ID;
+
+        Opt->Line->LineID = FName(Option.Line.LineID.c_str());
+
+        GetDisplayTextForLine(Opt->Line, Option.Line);
+
+        Opt->bIsAvailable = Option.IsAvailable;
+
+        Opt->SourceDialogueRunner = this;
+
+        Options.Add(Opt);
+    }
+
+    OnRunOptions(Options);
+}
+
+
+ULine* ADialogueRunner::AcquireLine()
+{
+    if (!bReuseContentObjects)
+    {
+        return NewObject<ULine>(this);
+    }
+
+    ULine* Line = FreeLines.Num() > 0 ? FreeLines.Pop().Get() : NewObject<ULine>(this);
+    Line->DisplayText = FText::GetEmpty();
+    LinesInUse.Add(Line);
+    return Line;
+}
+
+
+UOption* ADialogueRunner::AcquireOption()
+{
+    UOption* Option = bReuseContentObjects && FreeOptions.Num() > 0 ? FreeOptions.Pop().Get() : nullptr;
+    if (Option)
+    {
+        Option->Line->DisplayText = FText::GetEmpty();
     }
     else
     {
+        Option = NewObject<UOption>(this);
+        Option->Line = NewObject<ULine>(Option);
+    }
+
+    if (bReuseContentObjects)
+    {
+        OptionsInUse.Add(Option);
+    }
+    return Option;
+}
+
+
+void ADialogueRunner::ReleaseContentObjects()
+{
+    FreeLines.Append(LinesInUse);
+    LinesInUse.Reset();
+    FreeOptions.Append(OptionsInUse);
+    OptionsInUse.Reset();
+}
+
+
+FYarnLineView ADialogueRunner::MakeLineView(const Yarn::Line& Line) const
+{
+    FYarnLineView View;
+    View.LineID = FName(Line.LineID.c_str());
+    if (YarnProject && !IsRunningDedicatedServer())
+    {
+        View.LineIndex = YarnProject->GetLineIndex(View.LineID);
+        YarnProject->FindLineText(View.LineIndex, View.Text, View.Markup);
+    }
+    View.Substitutions = MakeArrayView(Line.Substitutions.data(), static_cast<int32>(Line.Substitutions.size()));
+    return View;
+}
+
+
+void ADialogueRunner::MulticastDialogueStarted_Implementation()
+{
+    if (!HasAuthority())
+    {
+        ContentSequence = 0;
+    }
+    if (ShouldPresentLocally())
+    {
+        OnDialogueStarted();
+    }
+}
+
+
+void ADialogueRunner::MulticastDialogueEnded_Implementation()
+{
+    if (ShouldPresentLocally())
+    {
+        OnDialogueEnded();
+    }
+}
+
+
+void ADialogueRunner::MulticastRunLine_Implementation(int32 Sequence, const FYarnNetLine& Line)
+{
+    if (!HasAuthority())
+    {
+        ContentSequence = Sequence;
+    }
+    if (ShouldPresentLocally())
+    {
+        PresentLine(MakeYarnLine(Line));
+    }
+}
+
+
+void ADialogueRunner::MulticastRunOptions_Implementation(int32 Sequence, const TArray<FYarnNetOption>& Options)
+{
+    if (!HasAuthority())
+    {
+        ContentSequence = Sequence;
+    }
+    if (!ShouldPresentLocally())
+    {
+        return;
+    }
+
+    Yarn::OptionSet OptionSet;
+    OptionSet.Options.reserve(Options.Num());
+    for (const FYarnNetOption& NetOption : Options)
+    {
+        Yarn::Option Option;
+        Option.Line = MakeYarnLine(NetOption.Line);
+        Option.ID = NetOption.OptionID;
+        Option.IsAvailable = NetOption.bIsAvailable;
+        OptionSet.Options.push_back(MoveTemp(Option));
+    }
+    PresentOptions(OptionSet);
+}
+
+
+void ADialogueRunner::MulticastRunCommand_Implementation(int32 Sequence, const FString& Command, const TArray<FString>& Parameters)
+{
+    if (!HasAuthority())
+    {
+        ContentSequence = Sequence;
+    }
+    if (ShouldPresentLocally())
+    {
+        TGuardValue<bool> PresentingGuard(bPresentingNetCommand, true);
+        OnRunCommand(Command, Parameters);
+    }
+    else if (HasAuthority())
+    {
+        // Nobody on a dedicated server will handle it, so don't stall waiting for a continue
         ContinueDialogue();
     }
 }
 
 
+void ADialogueRunner::MulticastVariableDeltas_Implementation(const TArray<FYarnNetVariableDelta>& Deltas)
+{
+    // The server made these changes itself
+    if (HasAuthority())
+    {
+        return;
+    }
+
+    UYarnSubsystem* Subsystem = YarnSubsystem();
+    if (!Subsystem)
+    {
+        return;
+    }
+
+    for (const FYarnNetVariableDelta& Delta : Deltas)
+    {
+        const FString* Name = &Delta.Name;
+        if (Delta.VariableIndex != INDEX_NONE)
+        {
+            Name = YarnProject ? YarnProject->GetVariableNameForIndex(Delta.VariableIndex) : nullptr;
+            if (!Name)
+            {
+                YS_WARN("Received change to unknown variable index %d; is the client's Yarn project out of date?", Delta.VariableIndex)
+                continue;
+            }
+        }
+
+        if (Delta.bCleared)
+        {
+            Subsystem->ClearVariable(*Name);
+        }
+        else
+        {
+            Subsystem->SetVariable(*Name, Delta.Value.ToValue());
+        }
+    }
+}
+
+
+FYarnNetLine ADialogueRunner::MakeNetLine(const Yarn::Line& Line) const
+{
+    FYarnNetLine NetLine;
+    NetLine.LineIndex = YarnProject->GetLineIndex(FName(Line.LineID.c_str()));
+    if (NetLine.LineIndex == INDEX_NONE)
+    {
+        YS_WARN("Line '%s' is not in the project's line table; clients will show it as missing", UTF8_TO_TCHAR(Line.LineID.c_str()))
+    }
+    NetLine.Substitutions.Reserve(Line.Substitutions.size());
+    for (const std::string& Substitution : Line.Substitutions)
+    {
+        NetLine.Substitutions.Add(UTF8_TO_TCHAR(Substitution.c_str()));
+    }
+    return NetLine;
+}
+
+
+Yarn::Line ADialogueRunner::MakeYarnLine(const FYarnNetLine& NetLine) const
+{
+    Yarn::Line Line;
+    const FName LineID = YarnProject ? YarnProject->GetLineIDForIndex(NetLine.LineIndex) : NAME_None;
+    Line.LineID = TCHAR_TO_UTF8(*LineID.ToString());
+    Line.Substitutions.reserve(NetLine.Substitutions.Num());
+    for (const FString& Substitution : NetLine.Substitutions)
+    {
+        Line.Substitutions.push_back(TCHAR_TO_UTF8(*Substitution));
+    }
+    return Line;
+}
+
+
+void ADialogueRunner::QueueVariableDelta(const FString& Name, const TOptional<Yarn::Value>& Value)
+{
+    FYarnNetVariableDelta& Delta = PendingVariableDeltas.AddDefaulted_GetRef();
+    Delta.VariableIndex = YarnProject ? YarnProject->GetVariableIndex(Name) : INDEX_NONE;
+    if (Delta.VariableIndex == INDEX_NONE)
+    {
+        Delta.Name = Name;
+    }
+    Delta.bCleared = !Value.IsSet();
+    if (Value.IsSet())
+    {
+        Delta.Value = FYarnNetValue(Value.GetValue());
+    }
+}
+
+
+void ADialogueRunner::FlushVariableDeltas()
+{
+    if (PendingVariableDeltas.Num() == 0)
+    {
+        return;
+    }
+    MulticastVariableDeltas(PendingVariableDeltas);
+    PendingVariableDeltas.Reset();
+}
+
+
 void ADialogueRunner::Log(std::string Message, Type Severity)
 {
     FString MessageText = FString(UTF8_TO_TCHAR(Message.c_str()));
@@ -316,21 +1230,21 @@ void ADialogueRunner::Log(std::string Message, Type Severity)
 void ADialogueRunner::SetValue(std::string Name, bool bValue)
 {
     YS_LOG("Setting variable %s to bool %i", UTF8_TO_TCHAR(Name.c_str()), bValue)
-    YarnSubsystem()->SetValue(Name, bValue);
+    SetVariable(UTF8_TO_TCHAR(Name.c_str()), Yarn::Value(bValue));
 }
 
 
 void ADialogueRunner::SetValue(std::string Name, float Value)
 {
     YS_LOG("Setting variable %s to float %f", UTF8_TO_TCHAR(Name.c_str()), Value)
-    YarnSubsystem()->SetValue(Name, Value);
+    SetVariable(UTF8_TO_TCHAR(Name.c_str()), Yarn::Value(Value));
 }
 
 
 void ADialogueRunner::SetValue(std::string Name, std::string Value)
 {
     YS_LOG("Setting variable %s to string %s", UTF8_TO_TCHAR(Name.c_str()), UTF8_TO_TCHAR(Value.c_str()))
-    YarnSubsystem()->SetValue(Name, Value);
+    SetVariable(UTF8_TO_TCHAR(Name.c_str()), Yarn::Value(Value));
 }
 
 
@@ -351,7 +1265,28 @@ Yarn::Value ADialogueRunner::GetValue(std::string Name)
 void ADialogueRunner::ClearValue(std::string Name)
 {
     YS_LOG("Clearing variable %s", UTF8_TO_TCHAR(Name.c_str()))
-    YarnSubsystem()->ClearValue(Name);
+    const FString VariableName = UTF8_TO_TCHAR(Name.c_str());
+    YarnSubsystem()->ClearVariable(VariableName, GetCurrentNodeName());
+    if (bServerAuthoritative)
+    {
+        QueueVariableDelta(VariableName, {});
+    }
+}
+
+
+void ADialogueRunner::SetVariable(const FString& Name, const Yarn::Value& Value)
+{
+    YarnSubsystem()->SetVariable(Name, Value, GetCurrentNodeName());
+    if (bServerAuthoritative)
+    {
+        QueueVariableDelta(Name, Value);
+    }
+}
+
+
+FName ADialogueRunner::GetCurrentNodeName() const
+{
+    return VirtualMachine ? FName(UTF8_TO_TCHAR(VirtualMachine->GetCurrentNodeName())) : NAME_None;
 }
 
 
@@ -368,31 +1303,48 @@ UYarnSubsystem* ADialogueRunner::YarnSubsystem() const
 
 void ADialogueRunner::GetDisplayTextForLine(ULine* Line, const Yarn::Line& YarnLine)
 {
+    Line->Attributes.Reset();
+
+    // Dedicated servers are cooked without line text (see UYarnProject::bStripPresentationDataForServer)
+    if (IsRunningDedicatedServer())
+    {
+        return;
+    }
+
     const FName LineID = FName(YarnLine.LineID.c_str());
 
     // This assumes that we only ever care about lines that actually exist in .yarn files (rather than allowing extra lines in .csv files)
-    if (!YarnProject || !YarnProject->Lines.Contains(LineID))
+    const FYarnCompiledLine* Compiled = YarnProject ? YarnProject->GetCompiledLine(LineID) : nullptr;
+    if (!Compiled)
     {
         Line->DisplayText = FText::FromString(TEXT("(missing line!)"));
         return;
     }
 
-    const FText LocalisedDisplayText = FText::FromString(YarnProject->Lines[LineID]);
-
-    const FText NonLocalisedDisplayText = FText::FromString(YarnProject->Lines[LineID]);
+    if (!Compiled->Format.IsSet())
+    {
+        Line->DisplayText = Compiled->Text;
+        Line->Attributes = Compiled->Attributes;
+        return;
+    }
 
     // Apply substitutions
     FFormatOrderedArguments FormatArgs;
-    for (auto Substitution : YarnLine.Substitutions)
+    FormatArgs.Reserve(YarnLine.Substitutions.size());
+    for (const std::string& Substitution : YarnLine.Substitutions)
     {
         FormatArgs.Emplace(FText::FromString(UTF8_TO_TCHAR(Substitution.c_str())));
     }
 
-    const FText TextWithSubstitutions = (LocalisedDisplayText.IsEmptyOrWhitespace()) ? FText::Format(NonLocalisedDisplayText, FormatArgs) : FText::Format(LocalisedDisplayText, FormatArgs);
+    const FText TextWithSubstitutions = FText::Format(Compiled->Format.GetValue(), MoveTemp(FormatArgs));
 
-    // TODO: add support for markup & context (speaker, target)
+    // Only lines with substitutions get here with their markup still in; everything else was parsed on import.  Their
+    // [plural] and [ordinal] markers are chosen by the rules compiled into the project, without going to ICU.
+    FMarkupParseResult Parsed;
+    FMarkupParser::Parse(TextWithSubstitutions.ToString(), Parsed, YarnProject->GetPluralRules());
 
-    YS_LOG_FUNC("Setting line %s to display text '%s'", *LineID.ToString(), *TextWithSubstitutions.ToString())
+    YS_LOG_FUNC("Setting line %s to display text '%s'", *LineID.ToString(), *Parsed.Text)
 
-    Line->DisplayText = TextWithSubstitutions;
+    Line->DisplayText = FText::FromString(MoveTemp(Parsed.Text));
+    Line->Attributes = MoveTemp(Parsed.Attributes);
 }
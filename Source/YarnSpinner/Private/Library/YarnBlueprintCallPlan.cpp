@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Library/YarnBlueprintCallPlan.h"
+
+#include "Library/YarnLibraryRegistry.h"
+#include "Misc/YSLogging.h"
+
+
+namespace
+{
+    const TCHAR* YarnTypeName(Yarn::Value::ValueType Type)
+    {
+        switch (Type)
+        {
+        case Yarn::Value::BOOL:
+            return TEXT("boolean");
+        case Yarn::Value::NUMBER:
+            return TEXT("number");
+        default:
+            return TEXT("string");
+        }
+    }
+
+
+    const FName DialogueRunnerParamName = TEXT("DialogueRunner");
+}
+
+
+FYarnBlueprintCallPlan::~FYarnBlueprintCallPlan()
+{
+    FMemory::Free(Buffer);
+}
+
+
+bool FYarnBlueprintCallPlan::Build(const UClass* Class, FName FunctionName, const TArray<FYarnBlueprintParam>& InParams, const FYarnBlueprintParam* ReturnParam, bool bIsCommand)
+{
+    Name = FunctionName;
+    Function.Reset();
+    Params.Reset();
+    Return.Reset();
+    DialogueRunnerProperty = nullptr;
+
+    UFunction* Func = Class ? Class->FindFunctionByName(FunctionName) : nullptr;
+    if (!Func)
+    {
+        YS_WARN("Could not find Blueprint function '%s' on %s", *FunctionName.ToString(), Class ? *Class->GetName() : TEXT("(null)"))
+        return false;
+    }
+
+    int32 ExpectedInputs = InParams.Num();
+    if (bIsCommand)
+    {
+        DialogueRunnerProperty = CastField<FObjectPropertyBase>(Func->FindPropertyByName(DialogueRunnerParamName));
+        if (!DialogueRunnerProperty)
+        {
+            YS_WARN("Yarn command '%s' has no '%s' object parameter", *FunctionName.ToString(), *DialogueRunnerParamName.ToString())
+            return false;
+        }
+        ExpectedInputs++;
+    }
+
+    int32 ActualInputs = 0;
+    for (TFieldIterator<FProperty> It(Func); It && It->HasAnyPropertyFlags(CPF_Parm); ++It)
+    {
+        if (!It->HasAnyPropertyFlags(CPF_OutParm | CPF_ReturnParm))
+        {
+            ActualInputs++;
+        }
+    }
+    if (ActualInputs != ExpectedInputs)
+    {
+        YS_WARN("Blueprint function '%s' takes %d parameters but the Yarn library data lists %d; recompile its library", *FunctionName.ToString(), ActualInputs, ExpectedInputs)
+        return false;
+    }
+
+    for (const FYarnBlueprintParam& InParam : InParams)
+    {
+        if (!ResolveParam(Func, InParam, Params.AddDefaulted_GetRef()))
+        {
+            return false;
+        }
+    }
+
+    if (ReturnParam)
+    {
+        if (!ResolveParam(Func, *ReturnParam, Return.Emplace()))
+        {
+            return false;
+        }
+    }
+
+    FMemory::Free(Buffer);
+    Buffer = static_cast<uint8*>(FMemory::Malloc(FMath::Max(Func->GetStructureSize(), 1), Func->GetMinAlignment()));
+    Function = Func;
+    return true;
+}
+
+
+bool FYarnBlueprintCallPlan::Call(UObject* Target, TArrayView<const Yarn::Value> Args, Yarn::Value* OutResult, UObject* DialogueRunner)
+{
+    UFunction* Func = Function.Get();
+    if (!Func || !Target)
+    {
+        YS_WARN("Blueprint function '%s' is no longer available", *Name.ToString())
+        return false;
+    }
+
+    if (Args.Num() != Params.Num())
+    {
+        YS_WARN("Blueprint function '%s' called with %d arguments (expected %d)", *Name.ToString(), Args.Num(), Params.Num())
+        return false;
+    }
+
+    // A function that ends up calling itself gets its own buffer
+    if (bBufferInUse)
+    {
+        uint8* Memory = static_cast<uint8*>(FMemory::Malloc(FMath::Max(Func->GetStructureSize(), 1), Func->GetMinAlignment()));
+        Invoke(Target, Func, Memory, Args, OutResult, DialogueRunner);
+        FMemory::Free(Memory);
+        return true;
+    }
+
+    bBufferInUse = true;
+    Invoke(Target, Func, Buffer, Args, OutResult, DialogueRunner);
+    bBufferInUse = false;
+    return true;
+}
+
+
+bool FYarnBlueprintCallPlan::ResolveParam(const UFunction* Func, const FYarnBlueprintParam& Param, FParam& OutParam) const
+{
+    FProperty* Property = Func->FindPropertyByName(Param.Name);
+    if (!Property || !Property->HasAnyPropertyFlags(CPF_Parm))
+    {
+        YS_WARN("Blueprint function '%s' has no parameter named '%s'", *Name.ToString(), *Param.Name.ToString())
+        return false;
+    }
+
+    OutParam.Property = Property;
+    OutParam.Offset = Property->GetOffset_ForUFunction();
+
+    bool bMatches = false;
+    switch (Param.Value.GetType())
+    {
+    case Yarn::Value::BOOL:
+        bMatches = Property->IsA<FBoolProperty>();
+        OutParam.Conversion = EConversion::Bool;
+        break;
+    case Yarn::Value::NUMBER:
+        bMatches = true;
+        if (Property->IsA<FDoubleProperty>())
+            OutParam.Conversion = EConversion::Double;
+        else if (Property->IsA<FFloatProperty>())
+            OutParam.Conversion = EConversion::Float;
+        else if (Property->IsA<FIntProperty>())
+            OutParam.Conversion = EConversion::Int;
+        else
+            bMatches = false;
+        break;
+    case Yarn::Value::STRING:
+        bMatches = Property->IsA<FStrProperty>();
+        OutParam.Conversion = EConversion::String;
+        break;
+    }
+
+    if (!bMatches)
+    {
+        YS_WARN("Parameter '%s' of Blueprint function '%s' is a %s, which can't hold a Yarn %s", *Param.Name.ToString(), *Name.ToString(), *Property->GetCPPType(), YarnTypeName(Param.Value.GetType()))
+        return false;
+    }
+    return true;
+}
+
+
+void FYarnBlueprintCallPlan::Invoke(UObject* Target, UFunction* Func, uint8* Memory, TArrayView<const Yarn::Value> Args, Yarn::Value* OutResult, UObject* DialogueRunner) const
+{
+    Func->InitializeStruct(Memory);
+
+    if (DialogueRunnerProperty)
+    {
+        DialogueRunnerProperty->SetObjectPropertyValue(Memory + DialogueRunnerProperty->GetOffset_ForUFunction(), DialogueRunner);
+    }
+
+    for (int32 I = 0; I < Params.Num(); I++)
+    {
+        const FParam& Param = Params[I];
+        const Yarn::Value& Arg = Args[I];
+        uint8* Value = Memory + Param.Offset;
+        switch (Param.Conversion)
+        {
+        case EConversion::Bool:
+            static_cast<FBoolProperty*>(Param.Property)->SetPropertyValue(Value, Arg.boolean);
+            break;
+        case EConversion::Float:
+            *reinterpret_cast<float*>(Value) = static_cast<float>(Arg.number);
+            break;
+        case EConversion::Double:
+            *reinterpret_cast<double*>(Value) = Arg.number;
+            break;
+        case EConversion::Int:
+            *reinterpret_cast<int32*>(Value) = static_cast<int32>(Arg.number);
+            break;
+        case EConversion::String:
+            *reinterpret_cast<FString*>(Value) = UTF8_TO_TCHAR(Arg.stringValue.c_str());
+            break;
+        }
+    }
+
+    Target->ProcessEvent(Func, Memory);
+
+    if (OutResult && Return.IsSet())
+    {
+        const uint8* Value = Memory + Return->Offset;
+        switch (Return->Conversion)
+        {
+        case EConversion::Bool:
+            *OutResult = Yarn::Value(static_cast<FBoolProperty*>(Return->Property)->GetPropertyValue(Value));
+            break;
+        case EConversion::Float:
+            *OutResult = Yarn::Value(static_cast<double>(*reinterpret_cast<const float*>(Value)));
+            break;
+        case EConversion::Double:
+            *OutResult = Yarn::Value(*reinterpret_cast<const double*>(Value));
+            break;
+        case EConversion::Int:
+            *OutResult = Yarn::Value(static_cast<double>(*reinterpret_cast<const int32*>(Value)));
+            break;
+        case EConversion::String:
+            *OutResult = Yarn::Value(std::string(TCHAR_TO_UTF8(**reinterpret_cast<const FString*>(Value))));
+            break;
+        }
+    }
+
+    Func->DestroyStruct(Memory);
+}
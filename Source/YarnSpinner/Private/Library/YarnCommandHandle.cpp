@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Library/YarnCommandHandle.h"
+
+#include "DialogueRunner.h"
+#include "GameplayTask.h"
+#include "Engine/GameInstance.h"
+#include "YarnSubsystem.h"
+#include "Async/Async.h"
+#include "Misc/YSLogging.h"
+
+
+void UYarnCommandHandle::Complete()
+{
+    if (!Finish())
+    {
+        return;
+    }
+
+    YS_LOG("Latent command '%s' completed", *CommandName.ToString())
+    if (ADialogueRunner* Runner = DialogueRunner.Get())
+    {
+        Runner->LatentCommandFinished(this);
+    }
+}
+
+
+void UYarnCommandHandle::CompleteWhen(TFuture<void>&& Future)
+{
+    TWeakObjectPtr<UYarnCommandHandle> WeakThis(this);
+    Future.Then([WeakThis](TFuture<void>)
+    {
+        AsyncTask(ENamedThreads::GameThread, [WeakThis]()
+        {
+            if (UYarnCommandHandle* Handle = WeakThis.Get())
+            {
+                Handle->Complete();
+            }
+        });
+    });
+}
+
+
+void UYarnCommandHandle::CompleteAfter(float Seconds)
+{
+    UYarnSubsystem* Subsystem = bRunning && Seconds > 0 ? GetYarnSubsystem() : nullptr;
+    if (!Subsystem)
+    {
+        Complete();
+        return;
+    }
+
+    TWeakObjectPtr<UYarnCommandHandle> WeakThis(this);
+    CompletionHandle = Subsystem->GetTimerWheel().Schedule(Seconds, [WeakThis]()
+    {
+        if (UYarnCommandHandle* Handle = WeakThis.Get())
+        {
+            Handle->CompletionHandle.Invalidate();
+            Handle->Complete();
+        }
+    }, DialogueRunner.Get());
+}
+
+
+void UYarnCommandHandle::Start(ADialogueRunner* Runner, FName Name, bool bInParallel, float Timeout)
+{
+    DialogueRunner = Runner;
+    CommandName = Name;
+    bParallel = bInParallel;
+    bRunning = true;
+
+    // Owned by the runner, so its timers are all cancelled together when it's destroyed
+    UYarnSubsystem* Subsystem = Timeout > 0 ? GetYarnSubsystem() : nullptr;
+    if (Subsystem)
+    {
+        TWeakObjectPtr<UYarnCommandHandle> WeakThis(this);
+        TimeoutHandle = Subsystem->GetTimerWheel().Schedule(Timeout, [WeakThis, Timeout]()
+        {
+            UYarnCommandHandle* Handle = WeakThis.Get();
+            if (!Handle)
+            {
+                return;
+            }
+            YS_WARN("Latent command '%s' didn't complete within %.1f seconds; cancelling it and continuing the dialogue", *Handle->CommandName.ToString(), Timeout)
+            Handle->TimeoutHandle.Invalidate();
+            Handle->Cancel();
+            if (ADialogueRunner* Runner = Handle->DialogueRunner.Get())
+            {
+                Runner->LatentCommandFinished(Handle);
+            }
+        }, Runner);
+    }
+}
+
+
+void UYarnCommandHandle::Cancel()
+{
+    if (!Finish())
+    {
+        return;
+    }
+
+    YS_LOG("Latent command '%s' cancelled", *CommandName.ToString())
+    if (UGameplayTask* RunningTask = Task.Get())
+    {
+        RunningTask->ExternalCancel();
+    }
+    OnCancelled.Broadcast(this);
+}
+
+
+bool UYarnCommandHandle::Finish()
+{
+    if (!bRunning)
+    {
+        return false;
+    }
+
+    bRunning = false;
+    if (UYarnSubsystem* Subsystem = TimeoutHandle.IsValid() || CompletionHandle.IsValid() ? GetYarnSubsystem() : nullptr)
+    {
+        Subsystem->GetTimerWheel().Cancel(TimeoutHandle);
+        Subsystem->GetTimerWheel().Cancel(CompletionHandle);
+    }
+    TimeoutHandle.Invalidate();
+    CompletionHandle.Invalidate();
+    return true;
+}
+
+
+UYarnSubsystem* UYarnCommandHandle::GetYarnSubsystem() const
+{
+    const ADialogueRunner* Runner = DialogueRunner.Get();
+    const UGameInstance* GameInstance = Runner ? Runner->GetGameInstance() : nullptr;
+    return GameInstance ? GameInstance->GetSubsystem<UYarnSubsystem>() : nullptr;
+}
@@ -4,8 +4,12 @@
 #include "Library/YarnCommandLibrary.h"
 
 #include "DialogueRunner.h"
+#include "GameplayTask.h"
+#include "GameplayTasksComponent.h"
 #include "AssetRegistry/ARFilter.h"
 #include "AssetRegistry/AssetRegistryModule.h"
+#include "Library/YarnBlueprintCallPlan.h"
+#include "Library/YarnCommandHandle.h"
 #include "Library/YarnLibraryRegistry.h"
 #include "Misc/OutputDeviceNull.h"
 #include "Misc/YSLogging.h"
@@ -58,70 +62,66 @@ UYarnCommandLibrary* UYarnCommandLibrary::FromBlueprint(const UBlueprint* Bluepr
 }
 
 
-void UYarnCommandLibrary::CallCommand(FName CommandName, TSoftObjectPtr<ADialogueRunner> DialogueRunner, TArray<FYarnBlueprintParam> Args)
+void UYarnCommandLibrary::CallCommand(FYarnBlueprintCallPlan& Plan, const TSoftObjectPtr<ADialogueRunner>& DialogueRunner, TArrayView<const Yarn::Value> Args)
 {
-    // Find the function
-    UFunction* Function = FindFunction(CommandName);
+    // Call the function (and assume it either calls Continue on the DialogueRunner or begins a latent command)
+    TGuardValue<TWeakObjectPtr<ADialogueRunner>> CallingGuard(CallingDialogueRunner, DialogueRunner.Get());
+    if (!Plan.Call(this, Args, nullptr, DialogueRunner.Get()))
+    {
+        ContinueDialogue(DialogueRunner);
+    }
+}
 
-    if (!Function)
+
+UYarnCommandHandle* UYarnCommandLibrary::RunTask(UGameplayTask* Task, ADialogueRunner* DialogueRunner)
+{
+    if (!Task || !DialogueRunner)
     {
-        YS_WARN("Could not find command function '%s'", *CommandName.ToString())
-        return ContinueDialogue(DialogueRunner);
+        YS_WARN_FUNC("needs both a task and a dialogue runner")
+        return nullptr;
+    }
+    // Only tasks created inside a command with this library as their owner get a tasks component, and only those
+    // report back here when they end
+    if (!Task->GetGameplayTasksComponent())
+    {
+        YS_WARN("Gameplay task %s wasn't created inside a command with %s as its owner, so it can't be awaited", *Task->GetName(), *GetName())
+        return nullptr;
     }
 
-    // Set up the parameters
-    FStructOnScope FuncParams(Function);
-    FBoolProperty* BoolParam;
-    FFloatProperty* FloatParam;
-    FStrProperty* StringParam;
+    UYarnCommandHandle* Handle = DialogueRunner->BeginLatentCommand(Task->GetInstanceName());
+    Handle->Task = Task;
+    TaskHandles.Add(Task, Handle);
 
-    const FName DialogueRunnerField = TEXT("DialogueRunner");
+    Task->ReadyForActivation();
+    return Handle;
+}
 
-    const FObjectProperty* ObjectProperty = CastField<FObjectProperty>(Function->FindPropertyByName(DialogueRunnerField));
-    ObjectProperty->SetObjectPropertyValue_InContainer(FuncParams.GetStructMemory(), DialogueRunner.Get());
 
-    // FSoftObjectProperty* DialogueRunnerProperty = CastField<FSoftObjectProperty>(Function->FindPropertyByName(DialogueRunnerField));
-    // // FSoftObjectProperty SoftObjectProperty = FSoftObjectProperty
-    // DialogueRunnerProperty->SetObjectPropertyValue_InContainer(FuncParams.GetStructMemory(), DialogueRunner);
-    // DialogueRunnerProperty->SetPropertyValue_InContainer(FuncParams.GetStructMemory(), {DialogueRunner});
+UGameplayTasksComponent* UYarnCommandLibrary::GetGameplayTasksComponent(const UGameplayTask& Task) const
+{
+    ADialogueRunner* Runner = CallingDialogueRunner.Get();
+    return Runner ? Runner->FindOrAddGameplayTasksComponent() : nullptr;
+}
+
 
-    for (auto Arg : Args)
+AActor* UYarnCommandLibrary::GetGameplayTaskOwner(const UGameplayTask* Task) const
+{
+    // Tasks outlive the call that created them, so prefer the runner that owns their component
+    if (Task && Task->GetGameplayTasksComponent())
     {
-        // Set input properties
-        switch (Arg.Value.GetType())
-        {
-        case Yarn::Value::ValueType::BOOL:
-            BoolParam = CastField<FBoolProperty>(Function->FindPropertyByName(Arg.Name));
-            if (!BoolParam)
-            {
-                YS_WARN_FUNC("Could not create function parameter '%s' for command '%s' from given values", *Arg.Name.ToString(), *CommandName.ToString())
-                return ContinueDialogue(DialogueRunner);
-            }
-            BoolParam->SetPropertyValue_InContainer(FuncParams.GetStructMemory(), Arg.Value.GetBooleanValue());
-            break;
-        case Yarn::Value::ValueType::NUMBER:
-            FloatParam = CastField<FFloatProperty>(Function->FindPropertyByName(Arg.Name));
-            if (!FloatParam)
-            {
-                YS_WARN_FUNC("Could not create function parameter '%s' for command '%s' from given values", *Arg.Name.ToString(), *CommandName.ToString())
-                return ContinueDialogue(DialogueRunner);
-            }
-            FloatParam->SetPropertyValue_InContainer(FuncParams.GetStructMemory(), Arg.Value.GetNumberValue());
-            break;
-        case Yarn::Value::ValueType::STRING:
-            StringParam = CastField<FStrProperty>(Function->FindPropertyByName(Arg.Name));
-            if (!StringParam)
-            {
-                YS_WARN_FUNC("Could not create function parameter '%s' for command '%s' from given values", *Arg.Name.ToString(), *CommandName.ToString())
-                return ContinueDialogue(DialogueRunner);
-            }
-            StringParam->SetPropertyValue_InContainer(FuncParams.GetStructMemory(), FString(Arg.Value.GetStringValue().c_str()));
-            break;
-        }
+        return Task->GetGameplayTasksComponent()->GetOwner();
     }
+    return CallingDialogueRunner.Get();
+}
 
-    // Call the function (and assume it correctly calls Continue on the DialogueRunner)
-    ProcessEvent(Function, FuncParams.GetStructMemory());
+
+void UYarnCommandLibrary::OnGameplayTaskDeactivated(UGameplayTask& Task)
+{
+    TWeakObjectPtr<UYarnCommandHandle> Handle;
+    if (TaskHandles.RemoveAndCopyValue(&Task, Handle) && Handle.IsValid())
+    {
+        Handle->Complete();
+    }
 }
 
 
@@ -5,6 +5,7 @@
 
 #include "AssetRegistry/ARFilter.h"
 #include "AssetRegistry/AssetRegistryModule.h"
+#include "Library/YarnBlueprintCallPlan.h"
 #include "Library/YarnLibraryRegistry.h"
 #include "Misc/OutputDeviceNull.h"
 #include "Misc/YSLogging.h"
@@ -56,99 +57,31 @@ UYarnFunctionLibrary* UYarnFunctionLibrary::FromBlueprint(const UBlueprint* Blue
 }
 
 
-TOptional<Yarn::Value> UYarnFunctionLibrary::CallFunction(FName FunctionName, TArray<FYarnBlueprintParam> Args, TOptional<FYarnBlueprintParam> ReturnValue)
+TOptional<Yarn::Value> UYarnFunctionLibrary::CallFunction(FYarnBlueprintCallPlan& Plan, TArrayView<const Yarn::Value> Args)
 {
-    TOptional<Yarn::Value> Result;
-    
-    // Find the function
-    UFunction* Function = FindFunction(FunctionName);
-
-    if (!Function)
+    Yarn::Value Result;
+    if (!Plan.Call(this, Args, &Result))
     {
-        YS_WARN("Could not find function '%s'", *FunctionName.ToString())
-        return Result;
+        return {};
     }
+    return Result;
+}
 
-    // Set up the parameters
-    FStructOnScope FuncParams(Function);
-    FBoolProperty* BoolParam;
-    FFloatProperty* FloatParam;
-    FStrProperty* StringParam;
-    
-    for (auto Arg : Args)
+
+TOptional<Yarn::Value> UYarnFunctionLibrary::CallFunction(FName FunctionName, const TArray<FYarnBlueprintParam>& Args, const TOptional<FYarnBlueprintParam>& ReturnValue)
+{
+    FYarnBlueprintCallPlan Plan;
+    if (!Plan.Build(GetClass(), FunctionName, Args, ReturnValue.GetPtrOrNull(), false))
     {
-        // Set input properties
-        switch (Arg.Value.GetType())
-        {
-        case Yarn::Value::ValueType::BOOL:
-            BoolParam = CastField<FBoolProperty>(Function->FindPropertyByName(Arg.Name));
-            if (!BoolParam)
-            {
-                YS_WARN_FUNC("Could not create function parameter '%s' for function %s from given values", *Arg.Name.ToString(), *FunctionName.ToString())
-                return Result;
-            }
-            BoolParam->SetPropertyValue_InContainer(FuncParams.GetStructMemory(), Arg.Value.GetBooleanValue());
-            break;
-        case Yarn::Value::ValueType::NUMBER:
-            FloatParam = CastField<FFloatProperty>(Function->FindPropertyByName(Arg.Name));
-            if (!FloatParam)
-            {
-                YS_WARN_FUNC("Could not create function parameter '%s' for function %s from given values", *Arg.Name.ToString(), *FunctionName.ToString())
-                return Result;
-            }
-            FloatParam->SetPropertyValue_InContainer(FuncParams.GetStructMemory(), Arg.Value.GetNumberValue());
-            break;
-        case Yarn::Value::ValueType::STRING:
-            StringParam = CastField<FStrProperty>(Function->FindPropertyByName(Arg.Name));
-            if (!StringParam)
-            {
-                YS_WARN_FUNC("Could not create function parameter '%s' for function %s from given values", *Arg.Name.ToString(), *FunctionName.ToString())
-                return Result;
-            }
-            StringParam->SetPropertyValue_InContainer(FuncParams.GetStructMemory(), FString(Arg.Value.GetStringValue().c_str()));
-            break;
-        }
+        return {};
     }
 
-    // Call the function
-    ProcessEvent(Function, FuncParams.GetStructMemory());
-
-    // Get the return value
-    if (ReturnValue.IsSet())
+    TArray<Yarn::Value, TInlineAllocator<8>> Values;
+    for (const FYarnBlueprintParam& Arg : Args)
     {
-        switch (ReturnValue->Value.GetType())
-        {
-        case Yarn::Value::ValueType::BOOL:
-            BoolParam = CastField<FBoolProperty>(Function->FindPropertyByName(ReturnValue->Name));
-            if (!BoolParam)
-            {
-                YS_WARN_FUNC("Could not get return parameter '%s' for function '%s'", *ReturnValue->Name.ToString(), *FunctionName.ToString())
-                return Result;
-            }
-            Result = Yarn::Value(BoolParam->GetPropertyValue_InContainer(FuncParams.GetStructMemory()));
-            break;
-        case Yarn::Value::ValueType::NUMBER:
-            FloatParam = CastField<FFloatProperty>(Function->FindPropertyByName(ReturnValue->Name));
-            if (!FloatParam)
-            {
-                YS_WARN_FUNC("Could not get return parameter '%s' for function '%s'", *ReturnValue->Name.ToString(), *FunctionName.ToString())
-                return Result;
-            }
-            Result = Yarn::Value(FloatParam->GetPropertyValue_InContainer(FuncParams.GetStructMemory()));
-            break;
-        case Yarn::Value::ValueType::STRING:
-            StringParam = CastField<FStrProperty>(Function->FindPropertyByName(ReturnValue->Name));
-            if (!StringParam)
-            {
-                YS_WARN_FUNC("Could not get return parameter '%s' for function '%s'", *ReturnValue->Name.ToString(), *FunctionName.ToString())
-                return Result;
-            }
-            Result = Yarn::Value(TCHAR_TO_UTF8(*StringParam->GetPropertyValue_InContainer(FuncParams.GetStructMemory())));
-            break;
-        }
+        Values.Add(Arg.Value);
     }
-
-    return Result;
+    return CallFunction(Plan, Values);
 }
 
 
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Library/YarnLibraryIndex.h"
+
+#include "Library/YarnNativeFunctionRegistry.h"
+#include "Library/YarnSpinnerLibraryData.h"
+#include "Misc/YarnAssetHelpers.h"
+
+
+FYarnLibraryIndexEntry FYarnLibraryIndexEntry::FromYSLS(const FYSLSAction& Action)
+{
+    FYarnLibraryIndexEntry Entry;
+    Entry.Name = FName(Action.DefinitionName);
+    // FileName is the Blueprint's object path; what actually gets cooked is its generated class
+    Entry.LibraryClass = FSoftClassPath(Action.FileName + TEXT("_C"));
+    Entry.ReturnType = UYarnLibraryIndex::TypeFromYSLS(Action.ReturnType);
+
+    for (const FYSLSParameter& InParam : Action.Parameters)
+    {
+        FYarnLibraryIndexParam& Param = Entry.Params.AddDefaulted_GetRef();
+        Param.Name = FName(InParam.Name);
+        Param.Type = UYarnLibraryIndex::TypeFromYSLS(InParam.Type);
+    }
+
+    return Entry;
+}
+
+
+UYarnLibraryIndex* UYarnLibraryIndex::Load()
+{
+    return LoadObject<UYarnLibraryIndex>(nullptr, *FYarnAssetHelpers::LibraryIndexObjectPath(), nullptr, LOAD_NoWarn | LOAD_Quiet);
+}
+
+
+bool UYarnLibraryIndex::SetFromYSLS(const FYarnSpinnerLibraryData& Data)
+{
+    auto Convert = [](const TArray<FYSLSAction>& Actions)
+    {
+        TArray<FYarnLibraryIndexEntry> Entries;
+        for (const FYSLSAction& Action : Actions)
+        {
+            // Native functions are registered in code and don't need an entry
+            if (Action.Language != FYarnNativeFunctionRegistry::YSLSLanguage)
+            {
+                Entries.Add(FYarnLibraryIndexEntry::FromYSLS(Action));
+            }
+        }
+        return Entries;
+    };
+
+    TArray<FYarnLibraryIndexEntry> NewFunctions = Convert(Data.Functions);
+    TArray<FYarnLibraryIndexEntry> NewCommands = Convert(Data.Commands);
+    if (NewFunctions == Functions && NewCommands == Commands)
+    {
+        return false;
+    }
+
+    Functions = MoveTemp(NewFunctions);
+    Commands = MoveTemp(NewCommands);
+    return true;
+}
+
+
+EYarnVariableType UYarnLibraryIndex::TypeFromYSLS(const FString& Type)
+{
+    if (Type == TEXT("boolean"))
+        return EYarnVariableType::Bool;
+    if (Type == TEXT("number"))
+        return EYarnVariableType::Number;
+    return EYarnVariableType::String;
+}
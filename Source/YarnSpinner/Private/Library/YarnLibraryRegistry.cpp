@@ -5,8 +5,11 @@
 
 #include "DialogueRunner.h"
 #include "YarnSubsystem.h"
+#include "Library/YarnCommandHandle.h"
 #include "Library/YarnCommandLibrary.h"
 #include "Library/YarnFunctionLibrary.h"
+#include "Library/YarnLibraryIndex.h"
+#include "Library/YarnNativeFunctionRegistry.h"
 #include "Library/YarnSpinnerLibraryData.h"
 #include "Misc/YarnAssetHelpers.h"
 #include "Misc/YSLogging.h"
@@ -31,13 +34,13 @@ void UYarnLibraryRegistry::BeginDestroy()
 
 bool UYarnLibraryRegistry::HasFunction(const FName& Name) const
 {
-    if (StdFunctions.Contains(Name))
+    if (StdFunctions.Contains(Name) || FYarnNativeFunctionRegistry::Get().Find(Name))
         return true;
 
     if (!AllFunctions.Contains(Name))
     {
         FString S = TEXT("Could not find function '") + Name.ToString() + TEXT("'.  Known functions: ");
-        for (auto Func : AllFunctions)
+        for (const auto& Func : AllFunctions)
         {
             S += TEXT("'") + Func.Key.ToString() + TEXT("', ");
         }
@@ -56,7 +59,7 @@ bool UYarnLibraryRegistry::HasCommand(const FName& Name) const
     if (!AllCommands.Contains(Name))
     {
         FString S = TEXT("Could not find command '") + Name.ToString() + TEXT("'.  Known commands: ");
-        for (auto Cmd : AllCommands)
+        for (const auto& Cmd : AllCommands)
         {
             S += TEXT("'") + Cmd.Key.ToString() + TEXT("', ");
         }
@@ -72,38 +75,67 @@ int32 UYarnLibraryRegistry::GetExpectedFunctionParamCount(const FName& Name) con
     if (StdFunctions.Contains(Name))
         return StdFunctions[Name].ExpectedParamCount;
 
+    if (const FYarnNativeFunction* Native = FYarnNativeFunctionRegistry::Get().Find(Name))
+        return Native->ParamTypes.Num();
+
     if (!AllFunctions.Contains(Name))
     {
         YS_WARN("Could not find function '%s' in registry.", *Name.ToString())
         return 0;
     }
 
-    return AllFunctions[Name].InParams.Num();
+    return AllFunctions[Name].Detail.InParams.Num();
 }
 
 
-Yarn::Value UYarnLibraryRegistry::CallFunction(const FName& Name, TArray<Yarn::Value> Parameters) const
+Yarn::Value UYarnLibraryRegistry::CallFunction(const FName& Name, TArrayView<const Yarn::Value> Parameters, FYarnPendingFunctionResult* OutPending)
 {
-    if (StdFunctions.Contains(Name))
+    if (const FYarnStdLibFunction* StdFunction = StdFunctions.Find(Name))
     {
-        return StdFunctions[Name].Function(Parameters);
+        return StdFunction->Function(Parameters);
     }
 
-    if (!AllFunctions.Contains(Name))
+    if (const FYarnNativeFunction* Native = FYarnNativeFunctionRegistry::Get().Find(Name))
+    {
+        if (Native->IsAsync())
+        {
+            if (!OutPending)
+            {
+                YS_WARN("Async function '%s' can't be called here; using its timeout value", *Name.ToString())
+                return Native->TimeoutValue;
+            }
+            if (!Native->AsyncThunk(Parameters, OutPending->Future))
+            {
+                YS_WARN("Native function '%s' called with arguments that don't match its signature (expected %s)", *Name.ToString(), *FString::Join(Native->ParamTypes, TEXT(", ")))
+                return Native->TimeoutValue;
+            }
+            OutPending->Timeout = Native->Timeout;
+            OutPending->TimeoutValue = Native->TimeoutValue;
+            return Native->TimeoutValue;
+        }
+
+        Yarn::Value Result;
+        if (!Native->Thunk(Parameters, Result))
+        {
+            YS_WARN("Native function '%s' called with arguments that don't match its signature (expected %s)", *Name.ToString(), *FString::Join(Native->ParamTypes, TEXT(", ")))
+        }
+        return Result;
+    }
+
+    FYarnBlueprintLibEntry* Entry = AllFunctions.Find(Name);
+    if (!Entry)
     {
         YS_WARN("Attempted to call non-existent function '%s'", *Name.ToString())
         return Yarn::Value();
     }
 
-    auto FuncDetail = AllFunctions[Name];
-
-    if (FuncDetail.InParams.Num() != Parameters.Num())
+    if (Entry->Detail.InParams.Num() != Parameters.Num())
     {
-        YS_WARN("Attempted to call function '%s' with incorrect number of arguments (expected %d).", *Name.ToString(), FuncDetail.InParams.Num())
+        YS_WARN("Attempted to call function '%s' with incorrect number of arguments (expected %d).", *Name.ToString(), Entry->Detail.InParams.Num())
         return Yarn::Value();
     }
 
-    auto Lib = UYarnFunctionLibrary::FromBlueprint(FuncDetail.Library);
+    UYarnFunctionLibrary* Lib = ResolveEntry(*Entry, false) ? Cast<UYarnFunctionLibrary>(Entry->Library) : nullptr;
 
     if (!Lib)
     {
@@ -111,17 +143,7 @@ Yarn::Value UYarnLibraryRegistry::CallFunction(const FName& Name, TArray<Yarn::V
         return Yarn::Value();
     }
 
-    TArray<FYarnBlueprintParam> InParams;
-    for (auto Param : FuncDetail.InParams)
-    {
-        FYarnBlueprintParam InParam = Param;
-        InParam.Value = Parameters[InParams.Num()];
-        InParams.Add(InParam);
-    }
-
-    TOptional<FYarnBlueprintParam> OutParam = FuncDetail.OutParam;
-
-    auto Result = Lib->CallFunction(Name, InParams, OutParam);
+    auto Result = Lib->CallFunction(*Entry->Plan, Parameters);
     if (Result.IsSet())
     {
         return Result.GetValue();
@@ -131,20 +153,21 @@ Yarn::Value UYarnLibraryRegistry::CallFunction(const FName& Name, TArray<Yarn::V
 }
 
 
-void UYarnLibraryRegistry::CallCommand(const FName& Name, TSoftObjectPtr<ADialogueRunner> DialogueRunner, TArray<FString> UnprocessedParamStrings) const
+void UYarnLibraryRegistry::CallCommand(const FName& Name, TSoftObjectPtr<ADialogueRunner> DialogueRunner, TArray<FString> UnprocessedParamStrings)
 {
     if (StdCommands.Contains(Name))
     {
         return StdCommands[Name].Command(DialogueRunner, UnprocessedParamStrings);
     }
 
-    if (!AllCommands.Contains(Name))
+    FYarnBlueprintLibEntry* Entry = AllCommands.Find(Name);
+    if (!Entry)
     {
         YS_WARN("Attempted to call non-existent command '%s'", *Name.ToString())
         return;
     }
 
-    FYarnBlueprintLibFunction CmdDetail = AllCommands[Name];
+    const FYarnBlueprintLibFunction& CmdDetail = Entry->Detail;
 
     if (CmdDetail.InParams.Num() != UnprocessedParamStrings.Num())
     {
@@ -152,7 +175,7 @@ void UYarnLibraryRegistry::CallCommand(const FName& Name, TSoftObjectPtr<ADialog
         return;
     }
 
-    UYarnCommandLibrary* Lib = UYarnCommandLibrary::FromBlueprint(CmdDetail.Library);
+    UYarnCommandLibrary* Lib = ResolveEntry(*Entry, true) ? Cast<UYarnCommandLibrary>(Entry->Library) : nullptr;
 
     if (!Lib)
     {
@@ -161,224 +184,198 @@ void UYarnLibraryRegistry::CallCommand(const FName& Name, TSoftObjectPtr<ADialog
     }
 
     // Convert strings to expected params
-    TArray<FYarnBlueprintParam> InParams;
+    TArray<Yarn::Value, TInlineAllocator<8>> Args;
     for (int I = 0; I < CmdDetail.InParams.Num(); I++)
     {
-        FYarnBlueprintParam InParam = CmdDetail.InParams[I];
-        if (UnprocessedParamStrings.Num() > I)
+        const Yarn::Value::ValueType Type = CmdDetail.InParams[I].Value.type;
+        if (Type == Yarn::Value::ValueType::NUMBER)
         {
-            if (InParam.Value.type == Yarn::Value::ValueType::NUMBER)
-            {
-                InParam.Value = Yarn::Value(FCString::Atof(*UnprocessedParamStrings[I]));
-            }
-            else if (InParam.Value.type == Yarn::Value::ValueType::BOOL)
-            {
-                InParam.Value = Yarn::Value(UnprocessedParamStrings[I].ToLower() == "true");
-            }
-            else
-            {
-                InParam.Value = Yarn::Value(TCHAR_TO_UTF8(*UnprocessedParamStrings[I]));
-            }
+            Args.Emplace(FCString::Atod(*UnprocessedParamStrings[I]));
+        }
+        else if (Type == Yarn::Value::ValueType::BOOL)
+        {
+            Args.Emplace(UnprocessedParamStrings[I].ToLower() == "true");
+        }
+        else
+        {
+            Args.Emplace(std::string(TCHAR_TO_UTF8(*UnprocessedParamStrings[I])));
         }
-        InParams.Add(InParam);
     }
 
-    Lib->CallCommand(Name, DialogueRunner, InParams);
+    Lib->CallCommand(*Entry->Plan, DialogueRunner, Args);
 
     YS_LOG("Command '%s' called.", *Name.ToString())
 }
 
 
-UBlueprint* UYarnLibraryRegistry::GetYarnFunctionLibraryBlueprint(const FAssetData& AssetData)
+void UYarnLibraryRegistry::LinkProgram(const Yarn::Program& Program)
 {
-    UBlueprint* BP = Cast<UBlueprint>(AssetData.GetAsset());
-
-    if (!BP)
+    // Actors can initialize before the game instance has started
+    if (!bIndexLoaded)
     {
-        // YS_LOG_FUNC("Could not cast asset to UBlueprint")
-        return nullptr;
+        FindFunctionsAndCommands();
     }
-    if (!BP->ParentClass->IsChildOf<UYarnFunctionLibrary>())
-    {
-        // YS_LOG_FUNC("Blueprint is not a child of UYarnFunctionLibrary")
-        return nullptr;
-    }
-    if (!BP->GeneratedClass)
-    {
-        // YS_LOG_FUNC("Blueprint has no generated class")
-        return nullptr;
-    }
-
-    return BP;
-}
 
+    const double StartTime = FPlatformTime::Seconds();
+    const int32 LibrariesBefore = LoadedLibraries.Num();
 
-UBlueprint* UYarnLibraryRegistry::GetYarnCommandLibraryBlueprint(const FAssetData& AssetData)
-{
-    UBlueprint* BP = Cast<UBlueprint>(AssetData.GetAsset());
-
-    if (!BP)
-    {
-        // YS_LOG_FUNC("Could not cast asset to UBlueprint")
-        return nullptr;
-    }
-    if (!BP->ParentClass->IsChildOf<UYarnCommandLibrary>())
+    for (const auto& Node : Program.nodes())
     {
-        // YS_LOG_FUNC("Blueprint is not a child of UYarnCommandLibrary")
-        return nullptr;
-    }
-    if (!BP->GeneratedClass)
-    {
-        // YS_LOG_FUNC("Blueprint has no generated class")
-        return nullptr;
+        for (const Yarn::Instruction& Instruction : Node.second.instructions())
+        {
+            if (Instruction.opcode() == Yarn::Instruction_OpCode_CALL_FUNC)
+            {
+                if (FYarnBlueprintLibEntry* Entry = AllFunctions.Find(FName(UTF8_TO_TCHAR(Instruction.operands(0).string_value().c_str()))))
+                {
+                    ResolveEntry(*Entry, false);
+                }
+            }
+            else if (Instruction.opcode() == Yarn::Instruction_OpCode_RUN_COMMAND)
+            {
+                // The command name is the first word of the command text
+                const std::string& CommandText = Instruction.operands(0).string_value();
+                const std::string CommandName = CommandText.substr(0, CommandText.find(' '));
+                if (FYarnBlueprintLibEntry* Entry = AllCommands.Find(FName(UTF8_TO_TCHAR(CommandName.c_str()))))
+                {
+                    ResolveEntry(*Entry, true);
+                }
+            }
+        }
     }
 
-    return BP;
+    YS_LOG("Linked program in %.2f ms (%d libraries loaded)", (FPlatformTime::Seconds() - StartTime) * 1000.0, LoadedLibraries.Num() - LibrariesBefore)
 }
 
 
 void UYarnLibraryRegistry::FindFunctionsAndCommands()
 {
     YS_LOG_FUNCSIG
-    YS_LOG("Project content dir: %s", *FPaths::ProjectContentDir());
 
-    FString YSLSFileData;
-    FFileHelper::LoadFileToString(YSLSFileData, *FYarnAssetHelpers::YSLSFilePath());
+    // Only the index is read here; no Blueprint is loaded until something links against it
+    const double StartTime = FPlatformTime::Seconds();
+
+    AllFunctions.Reset();
+    AllCommands.Reset();
+    bIndexLoaded = true;
 
-    if (auto YSLSData = FYarnSpinnerLibraryData::FromJsonString(YSLSFileData))
+    if (const UYarnLibraryIndex* Index = UYarnLibraryIndex::Load())
     {
-        for (auto Func : YSLSData->Functions)
+        for (const FYarnLibraryIndexEntry& Func : Index->Functions)
         {
-            AddFunction(Func);
+            AddEntry(AllFunctions, Func);
         }
-        for (auto Cmd : YSLSData->Commands)
+        for (const FYarnLibraryIndexEntry& Cmd : Index->Commands)
         {
-            AddCommand(Cmd);
+            AddEntry(AllCommands, Cmd);
         }
-    }
-}
 
-
-void UYarnLibraryRegistry::AddFunction(const FYSLSAction& Func)
-{
-    // Find the blueprint
-#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1
-    auto Asset = FAssetRegistryModule::GetRegistry().GetAssetByObjectPath(FSoftObjectPath(Func.FileName));
-#else
-    auto Asset = FAssetRegistryModule::GetRegistry().GetAssetByObjectPath(FName(Func.FileName));
-#endif
-
-    YS_LOG_FUNC("Found asset %s for function %s (%s)", *Asset.GetFullName(), *Func.DefinitionName, *Func.FileName)
-    Asset.PrintAssetData();
-
-    auto BP = GetYarnFunctionLibraryBlueprint(Asset);
-    if (!BP)
-    {
-        YS_WARN("Could not load Blueprint for Yarn function '%s'", *Func.DefinitionName)
+        YS_LOG("Indexed %d Yarn functions and %d commands from %s in %.2f ms",
+            AllFunctions.Num(), AllCommands.Num(), *Index->GetPathName(), (FPlatformTime::Seconds() - StartTime) * 1000.0)
         return;
     }
 
-    FunctionLibraries.Add(BP);
+    // No cooked index (e.g. the editor hasn't saved one yet), so fall back to the .ysls file
+    FString YSLSFileData;
+    FFileHelper::LoadFileToString(YSLSFileData, *FYarnAssetHelpers::YSLSFilePath());
+    const double ReadTime = FPlatformTime::Seconds();
 
-    FYarnBlueprintLibFunction FuncDetail{BP, FName(Func.DefinitionName)};
+    auto YSLSData = FYarnSpinnerLibraryData::FromJsonString(YSLSFileData);
+    const double ParseTime = FPlatformTime::Seconds();
 
-    for (auto InParam : Func.Parameters)
+    if (YSLSData)
     {
-        FYarnBlueprintParam Param{FName(InParam.Name)};
-        if (InParam.Type == "boolean")
-        {
-            Param.Value = Yarn::Value(InParam.DefaultValue == "true");
-        }
-        else if (InParam.Type == "number")
+        for (const FYSLSAction& Func : YSLSData->Functions)
         {
-            Param.Value = Yarn::Value(FCString::Atof(*InParam.DefaultValue));
+            // Native functions are only listed for the language server; they're already registered
+            if (Func.Language == FYarnNativeFunctionRegistry::YSLSLanguage)
+            {
+                continue;
+            }
+            AddEntry(AllFunctions, FYarnLibraryIndexEntry::FromYSLS(Func));
         }
-        else
+        for (const FYSLSAction& Cmd : YSLSData->Commands)
         {
-            Param.Value = Yarn::Value(TCHAR_TO_UTF8(*InParam.DefaultValue));
+            AddEntry(AllCommands, FYarnLibraryIndexEntry::FromYSLS(Cmd));
         }
-
-        FuncDetail.InParams.Add(Param);
     }
+    const double EndTime = FPlatformTime::Seconds();
 
-    FYarnBlueprintParam Param{GYSFunctionReturnParamName};
-    if (Func.ReturnType == "boolean")
-    {
-        Param.Value = Yarn::Value(false);
-    }
-    else if (Func.ReturnType == "number")
+    YS_LOG("Indexed %d Yarn functions and %d commands from .ysls in %.2f ms (read %.2f ms, parse %.2f ms, index %.2f ms)",
+        AllFunctions.Num(), AllCommands.Num(), (EndTime - StartTime) * 1000.0,
+        (ReadTime - StartTime) * 1000.0, (ParseTime - ReadTime) * 1000.0, (EndTime - ParseTime) * 1000.0)
+}
+
+
+void UYarnLibraryRegistry::AddEntry(TMap<FName, FYarnBlueprintLibEntry>& Entries, const FYarnLibraryIndexEntry& IndexEntry)
+{
+    auto MakeParam = [](FName Name, EYarnVariableType Type)
     {
-        Param.Value = Yarn::Value(0.0f);
-    }
-    else
+        FYarnBlueprintParam Param{Name};
+        switch (Type)
+        {
+        case EYarnVariableType::Bool:
+            Param.Value = Yarn::Value(false);
+            break;
+        case EYarnVariableType::Number:
+            Param.Value = Yarn::Value(0.0);
+            break;
+        default:
+            Param.Value = Yarn::Value("");
+            break;
+        }
+        return Param;
+    };
+
+    FYarnBlueprintLibEntry Entry;
+    Entry.Detail.Name = IndexEntry.Name;
+    Entry.LibraryClassPath = IndexEntry.LibraryClass;
+
+    for (const FYarnLibraryIndexParam& Param : IndexEntry.Params)
     {
-        Param.Value = Yarn::Value("");
+        Entry.Detail.InParams.Add(MakeParam(Param.Name, Param.Type));
     }
-    FuncDetail.OutParam = Param;
+    Entry.Detail.OutParam = MakeParam(GYSFunctionReturnParamName, IndexEntry.ReturnType);
 
-    AllFunctions.Add(FName(Func.DefinitionName), FuncDetail);
+    Entries.Add(Entry.Detail.Name, MoveTemp(Entry));
 }
 
 
-void UYarnLibraryRegistry::AddCommand(const FYSLSAction& Cmd)
+bool UYarnLibraryRegistry::ResolveEntry(FYarnBlueprintLibEntry& Entry, bool bIsCommand)
 {
-    YS_LOG_FUNCSIG
-    // Find the blueprint
-#if ENGINE_MAJOR_VERSION == 5 && ENGINE_MINOR_VERSION >= 1
-    auto Asset = FAssetRegistryModule::GetRegistry().GetAssetByObjectPath(FSoftObjectPath(Cmd.FileName));
-#else
-    auto Asset = FAssetRegistryModule::GetRegistry().GetAssetByObjectPath(FName(Cmd.FileName));
-#endif
-
-    YS_LOG_FUNC("Found asset %s for function %s (%s)", *Asset.GetFullName(), *Cmd.DefinitionName, *Cmd.FileName)
-    Asset.PrintAssetData();
-
-    auto BP = GetYarnCommandLibraryBlueprint(Asset);
-    if (!BP)
-    {
-        YS_WARN("Could not load Blueprint for Yarn function '%s'", *Cmd.DefinitionName)
-        return;
-    }
+    if (Entry.Plan)
+        return true;
+    if (Entry.bResolveFailed)
+        return false;
 
-    CommandLibraries.Add(BP);
+    const double StartTime = FPlatformTime::Seconds();
+    const FString Kind = bIsCommand ? TEXT("command") : TEXT("function");
 
-    FYarnBlueprintLibFunction CmdDetail{BP, FName(Cmd.DefinitionName)};
+    // Failures aren't retried, so a missing library is only reported once
+    Entry.bResolveFailed = true;
 
-    for (auto InParam : Cmd.Parameters)
+    UClass* LibraryClass = Entry.LibraryClassPath.TryLoadClass<UObject>();
+    const UClass* ExpectedClass = bIsCommand ? UYarnCommandLibrary::StaticClass() : UYarnFunctionLibrary::StaticClass();
+    if (!LibraryClass || !LibraryClass->IsChildOf(ExpectedClass))
     {
-        FYarnBlueprintParam Param{FName(InParam.Name)};
-        if (InParam.Type == "boolean")
-        {
-            Param.Value = Yarn::Value(InParam.DefaultValue == "true");
-        }
-        else if (InParam.Type == "number")
-        {
-            Param.Value = Yarn::Value(FCString::Atof(*InParam.DefaultValue));
-        }
-        else
-        {
-            Param.Value = Yarn::Value(TCHAR_TO_UTF8(*InParam.DefaultValue));
-        }
-
-        CmdDetail.InParams.Add(Param);
+        YS_WARN("Could not load Blueprint %s for Yarn %s '%s'", *Entry.LibraryClassPath.ToString(), *Kind, *Entry.Detail.Name.ToString())
+        return false;
     }
 
-    FYarnBlueprintParam Param{GYSFunctionReturnParamName};
-    if (Cmd.ReturnType == "boolean")
-    {
-        Param.Value = Yarn::Value(false);
-    }
-    else if (Cmd.ReturnType == "number")
-    {
-        Param.Value = Yarn::Value(0.0f);
-    }
-    else
+    // Commands don't return anything to Yarn, so only their inputs are planned
+    TUniquePtr<FYarnBlueprintCallPlan> Plan = MakeUnique<FYarnBlueprintCallPlan>();
+    if (!Plan->Build(LibraryClass, Entry.Detail.Name, Entry.Detail.InParams, bIsCommand ? nullptr : Entry.Detail.OutParam.GetPtrOrNull(), bIsCommand))
     {
-        Param.Value = Yarn::Value("");
+        YS_WARN("Yarn %s '%s' doesn't match its Blueprint and won't be available", *Kind, *Entry.Detail.Name.ToString())
+        return false;
     }
-    CmdDetail.OutParam = Param;
 
-    AllCommands.Add(FName(Cmd.DefinitionName), CmdDetail);
+    LoadedLibraries.Add(LibraryClass);
+    Entry.Library = LibraryClass->GetDefaultObject();
+    Entry.Plan = MoveTemp(Plan);
+    Entry.bResolveFailed = false;
+
+    YS_LOG("Resolved Yarn %s '%s' from %s in %.2f ms", *Kind, *Entry.Detail.Name.ToString(), *LibraryClass->GetName(), (FPlatformTime::Seconds() - StartTime) * 1000.0)
+    return true;
 }
 
 
@@ -403,7 +400,7 @@ void UYarnLibraryRegistry::AddStdCommand(const FYarnStdLibCommand& Command)
 void UYarnLibraryRegistry::LoadStdFunctions()
 {
     AddStdFunction({
-        TEXT("Number.EqualTo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.EqualTo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -420,7 +417,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.NotEqualTo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.NotEqualTo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -437,7 +434,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.Add"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.Add"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -454,7 +451,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.Minus"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.Minus"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -471,7 +468,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.Divide"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.Divide"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -488,7 +485,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.Multiply"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.Multiply"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -505,7 +502,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.Modulo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.Modulo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -522,7 +519,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.UnaryMinus"), 1, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.UnaryMinus"), 1, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 1)
             {
@@ -539,7 +536,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.GreaterThan"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.GreaterThan"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -556,7 +553,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.GreaterThanOrEqualTo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.GreaterThanOrEqualTo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -573,7 +570,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.LessThan"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.LessThan"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -590,7 +587,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Number.LessThanOrEqualTo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Number.LessThanOrEqualTo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -607,7 +604,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Bool.EqualTo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Bool.EqualTo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -624,7 +621,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Bool.NotEqualTo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Bool.NotEqualTo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2)
             {
@@ -641,7 +638,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Bool.And"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Bool.And"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2 || !Params[0].IsBoolean() || !Params[1].IsBoolean())
             {
@@ -653,7 +650,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Bool.Or"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Bool.Or"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2 || !Params[0].IsBoolean() || !Params[1].IsBoolean())
             {
@@ -665,7 +662,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Bool.Xor"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Bool.Xor"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2 || !Params[0].IsBoolean() || !Params[1].IsBoolean())
             {
@@ -677,7 +674,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("Bool.Not"), 1, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("Bool.Not"), 1, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 1 || !Params[0].IsBoolean())
             {
@@ -689,7 +686,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("String.EqualTo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("String.EqualTo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2 || !Params[0].IsString() || !Params[1].IsString())
             {
@@ -701,7 +698,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("String.NotEqualTo"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("String.NotEqualTo"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2 || !Params[0].IsString() || !Params[1].IsString())
             {
@@ -713,7 +710,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("String.Add"), 2, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("String.Add"), 2, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 2 || !Params[0].IsString() || !Params[1].IsString())
             {
@@ -725,7 +722,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("string"), 1, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("string"), 1, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 1)
             {
@@ -737,7 +734,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("number"), 1, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("number"), 1, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 1)
             {
@@ -749,7 +746,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("visited"), 1, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("visited"), 1, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 1 || !Params[0].IsString())
             {
@@ -770,7 +767,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
     });
 
     AddStdFunction({
-        TEXT("visited_count"), 1, [](TArray<Yarn::Value> Params) -> Yarn::Value
+        TEXT("visited_count"), 1, [](TArrayView<const Yarn::Value> Params) -> Yarn::Value
         {
             if (Params.Num() != 1 || !Params[0].IsString())
             {
@@ -795,7 +792,7 @@ void UYarnLibraryRegistry::LoadStdFunctions()
 void UYarnLibraryRegistry::LoadStdCommands()
 {
     AddStdCommand({
-        TEXT("wait"), 1, [this](TSoftObjectPtr<ADialogueRunner> DialogueRunner, TArray<FString> Params)
+        TEXT("wait"), 1, [](TSoftObjectPtr<ADialogueRunner> DialogueRunner, TArray<FString> Params)
         {
             YS_LOG_FUNCSIG
             float WaitTime = 0;
@@ -808,12 +805,23 @@ void UYarnLibraryRegistry::LoadStdCommands()
                 YS_WARN("wait called with incorrect parameter types (expected NUMBER).")
             }
 
-            DialogueRunner->GetWorld()->GetTimerManager().SetTimer(CommandTimerHandle, [DialogueRunner]()
-            {
-                YS_LOG_FUNCSIG
-                DialogueRunner->ContinueDialogue();
-            }, WaitTime, false);
+            // The handle owns the timer, so stopping the dialogue, which cancels the handle, takes it off the wheel too
+            DialogueRunner->BeginLatentCommand(TEXT("wait"))->CompleteAfter(WaitTime);
         }
     });
-}
 
+    // Latent commands after <<parallel>> don't hold up the dialogue until the next <<join>>
+    AddStdCommand({
+        TEXT("parallel"), 0, [](TSoftObjectPtr<ADialogueRunner> DialogueRunner, TArray<FString> Params)
+        {
+            DialogueRunner->BeginParallelCommands();
+        }
+    });
+
+    AddStdCommand({
+        TEXT("join"), 0, [](TSoftObjectPtr<ADialogueRunner> DialogueRunner, TArray<FString> Params)
+        {
+            DialogueRunner->JoinCommands();
+        }
+    });
+}
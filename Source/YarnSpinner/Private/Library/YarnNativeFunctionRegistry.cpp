@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Library/YarnNativeFunctionRegistry.h"
+
+#include "Library/YarnSpinnerLibraryData.h"
+#include "Misc/YSLogging.h"
+
+
+const FString FYarnNativeFunctionRegistry::YSLSLanguage = TEXT("cpp");
+
+
+FYarnNativeFunctionRegistry& FYarnNativeFunctionRegistry::Get()
+{
+    static FYarnNativeFunctionRegistry Registry;
+    return Registry;
+}
+
+
+void FYarnNativeFunctionRegistry::Unregister(FName Name)
+{
+    Functions.Remove(Name);
+}
+
+
+void FYarnNativeFunctionRegistry::GetYSLSActions(TArray<FYSLSAction>& OutActions) const
+{
+    for (const auto& Entry : Functions)
+    {
+        const FYarnNativeFunction& Function = Entry.Value;
+
+        FYSLSAction& Action = OutActions.AddDefaulted_GetRef();
+        Action.YarnName = Function.Name.ToString();
+        Action.DefinitionName = Action.YarnName;
+        Action.Language = YSLSLanguage;
+        Action.Documentation = Function.Documentation;
+        Action.ReturnType = Function.ReturnType;
+
+        TArray<FString> SignatureParams;
+        for (int32 I = 0; I < Function.ParamTypes.Num(); I++)
+        {
+            FYSLSParameter& Param = Action.Parameters.AddDefaulted_GetRef();
+            Param.Name = FString::Printf(TEXT("arg%d"), I);
+            Param.Type = Function.ParamTypes[I];
+            SignatureParams.Add(Param.Type);
+        }
+        Action.Signature = FString::Printf(TEXT("%s(%s) -> %s"), *Action.YarnName, *FString::Join(SignatureParams, TEXT(", ")), Function.ReturnType);
+    }
+}
+
+
+void FYarnNativeFunctionRegistry::Add(FYarnNativeFunction&& Function)
+{
+    if (Functions.Contains(Function.Name))
+    {
+        YS_WARN("Native Yarn function '%s' is being registered twice; the later registration wins", *Function.Name.ToString())
+    }
+    Functions.Add(Function.Name, MoveTemp(Function));
+}
@@ -3,3 +3,43 @@
 
 #include "Line.h"
 
+
+bool ULine::TryGetAttribute(const FString& Name, FYarnMarkupAttribute& OutAttribute) const
+{
+    for (const FYarnMarkupAttribute& Attribute : Attributes)
+    {
+        if (Attribute.Name.Equals(Name, ESearchCase::CaseSensitive))
+        {
+            OutAttribute = Attribute;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+FString ULine::GetCharacterName() const
+{
+    for (const FYarnMarkupAttribute& Attribute : Attributes)
+    {
+        if (Attribute.Name.Equals(TEXT("character"), ESearchCase::CaseSensitive))
+        {
+            const FString* Name = Attribute.FindProperty(TEXT("name"));
+            return Name ? *Name : FString();
+        }
+    }
+    return FString();
+}
+
+
+FText ULine::GetTextWithoutCharacterName() const
+{
+    for (const FYarnMarkupAttribute& Attribute : Attributes)
+    {
+        if (Attribute.Name.Equals(TEXT("character"), ESearchCase::CaseSensitive))
+        {
+            return FText::FromString(DisplayText.ToString().Mid(Attribute.Position + Attribute.Length));
+        }
+    }
+    return DisplayText;
+}
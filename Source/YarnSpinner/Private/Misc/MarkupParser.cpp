@@ -1,13 +1,506 @@
-﻿#include "MarkupParser.h"
+﻿#include "Misc/MarkupParser.h"
 
+#include "Misc/YSLogging.h"
 
-FString FMarkupParser::Parse(const FString& LineText)
+
+namespace
+{
+    const TCHAR* const NoMarkupAttribute = TEXT("nomarkup");
+    const TCHAR* const CharacterAttribute = TEXT("character");
+    const TCHAR* const SelectMarker = TEXT("select");
+    const TCHAR* const PluralMarker = TEXT("plural");
+    const TCHAR* const OrdinalMarker = TEXT("ordinal");
+
+    // TMap's FString keys ignore case, but markup names and values don't
+    struct FCaseSensitiveKeyFuncs : TDefaultMapKeyFuncs<FString, int32, false>
+    {
+        static bool Matches(const FString& A, const FString& B) { return A.Equals(B, ESearchCase::CaseSensitive); }
+        static uint32 GetKeyHash(const FString& Key) { return FCrc::StrCrc32(*Key); }
+    };
+
+    bool IsEscapable(TCHAR Char)
+    {
+        return Char == TEXT('[') || Char == TEXT(']') || Char == TEXT('\\');
+    }
+
+    bool IsNameChar(TCHAR Char)
+    {
+        return FChar::IsAlnum(Char) || Char == TEXT('_') || Char == TEXT('-');
+    }
+
+    void SkipWhitespace(FStringView Tag, int32& Index)
+    {
+        while (Index < Tag.Len() && FChar::IsWhitespace(Tag[Index]))
+        {
+            Index++;
+        }
+    }
+
+    bool ReadName(FStringView Tag, int32& Index, FString& OutName)
+    {
+        const int32 Start = Index;
+        while (Index < Tag.Len() && IsNameChar(Tag[Index]))
+        {
+            Index++;
+        }
+        OutName = FString(Tag.Mid(Start, Index - Start));
+        return Index > Start;
+    }
+
+    bool ReadValue(FStringView Tag, int32& Index, FString& OutValue)
+    {
+        OutValue.Reset();
+        if (Index < Tag.Len() && Tag[Index] == TEXT('"'))
+        {
+            for (Index++; Index < Tag.Len() && Tag[Index] != TEXT('"'); Index++)
+            {
+                if (Tag[Index] == TEXT('\\') && Index + 1 < Tag.Len())
+                {
+                    Index++;
+                }
+                OutValue.AppendChar(Tag[Index]);
+            }
+            if (Index >= Tag.Len())
+            {
+                return false;
+            }
+            Index++;
+            return true;
+        }
+
+        const int32 Start = Index;
+        while (Index < Tag.Len() && !FChar::IsWhitespace(Tag[Index]))
+        {
+            Index++;
+        }
+        OutValue = FString(Tag.Mid(Start, Index - Start));
+        return Index > Start;
+    }
+
+    // The inside of an opening tag: a name, an optional =value, then any number of name=value properties
+    bool ParseOpenTag(FStringView Tag, FYarnMarkupAttribute& OutAttribute)
+    {
+        int32 Index = 0;
+        if (!ReadName(Tag, Index, OutAttribute.Name))
+        {
+            return false;
+        }
+
+        if (Index < Tag.Len() && Tag[Index] == TEXT('='))
+        {
+            Index++;
+            FYarnMarkupProperty& Property = OutAttribute.Properties.AddDefaulted_GetRef();
+            Property.Name = OutAttribute.Name;
+            if (!ReadValue(Tag, Index, Property.Value))
+            {
+                return false;
+            }
+        }
+
+        while (true)
+        {
+            SkipWhitespace(Tag, Index);
+            if (Index >= Tag.Len())
+            {
+                return true;
+            }
+
+            FYarnMarkupProperty& Property = OutAttribute.Properties.AddDefaulted_GetRef();
+            if (!ReadName(Tag, Index, Property.Name) || Index >= Tag.Len() || Tag[Index] != TEXT('='))
+            {
+                return false;
+            }
+            Index++;
+            if (!ReadValue(Tag, Index, Property.Value))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Index of the ] that ends the tag starting at Start, skipping any inside quoted values
+    int32 FindTagEnd(FStringView Text, int32 Start)
+    {
+        bool bInQuotes = false;
+        for (int32 Index = Start; Index < Text.Len(); Index++)
+        {
+            const TCHAR Char = Text[Index];
+            if (bInQuotes && Char == TEXT('\\'))
+            {
+                Index++;
+            }
+            else if (Char == TEXT('"'))
+            {
+                bInQuotes = !bInQuotes;
+            }
+            else if (Char == TEXT(']') && !bInQuotes)
+            {
+                return Index;
+            }
+        }
+        return INDEX_NONE;
+    }
+
+    bool Fail(FStringView LineText, FMarkupParseResult& OutResult, const TCHAR* Reason)
+    {
+        YS_WARN("Couldn't parse the markup in \"%.*s\": %s", LineText.Len(), LineText.GetData(), Reason)
+        OutResult.Text = FString(LineText);
+        OutResult.Attributes.Reset();
+        return false;
+    }
+
+    // Appends the text for a [select], [plural] or [ordinal] marker.  Returns false if it has no value.
+    bool AppendReplacement(const FYarnMarkupAttribute& Marker, const FYarnCultureRules* Rules, FString& Text)
+    {
+        const FString* Value = Marker.FindProperty(TEXT("value"));
+        if (!Value)
+        {
+            return false;
+        }
+
+        FStringView Category = *Value;
+        if (FCString::Strcmp(*Marker.Name, SelectMarker) != 0)
+        {
+            const FYarnPluralRules* Table = nullptr;
+            if (Rules)
+            {
+                Table = FCString::Strcmp(*Marker.Name, OrdinalMarker) == 0 ? &Rules->Ordinal : &Rules->Cardinal;
+            }
+            Category = FYarnCultureRules::GetCategoryName(Table ? Table->Evaluate(*Value) : EYarnPluralCategory::Other);
+        }
+
+        const FString* Replacement = Marker.FindProperty(Category);
+        if (!Replacement)
+        {
+            Replacement = Marker.FindProperty(TEXT("other"));
+        }
+        if (Replacement)
+        {
+            for (const TCHAR Char : *Replacement)
+            {
+                if (Char == TEXT('%'))
+                {
+                    Text += *Value;
+                }
+                else
+                {
+                    Text.AppendChar(Char);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool IsReplacementMarker(const FString& Name)
+    {
+        return FCString::Strcmp(*Name, SelectMarker) == 0 || FCString::Strcmp(*Name, PluralMarker) == 0 || FCString::Strcmp(*Name, OrdinalMarker) == 0;
+    }
+
+    // "Name: text" is spoken by Name, unless the line says otherwise with its own [character] attribute
+    void AddCharacterAttribute(FMarkupParseResult& Result)
+    {
+        int32 Colon;
+        if (!Result.Text.FindChar(TEXT(':'), Colon))
+        {
+            return;
+        }
+
+        int32 End = Colon + 1;
+        while (End < Result.Text.Len() && FChar::IsWhitespace(Result.Text[End]))
+        {
+            End++;
+        }
+
+        FYarnMarkupAttribute Character;
+        Character.Name = CharacterAttribute;
+        Character.Position = 0;
+        Character.Length = End;
+        FYarnMarkupProperty& Name = Character.Properties.AddDefaulted_GetRef();
+        Name.Name = TEXT("name");
+        Name.Value = Result.Text.Left(Colon);
+        Result.Attributes.Insert(MoveTemp(Character), 0);
+    }
+}
+
+
+const FString* FYarnMarkupAttribute::FindProperty(FStringView PropertyName) const
+{
+    for (const FYarnMarkupProperty& Property : Properties)
+    {
+        if (PropertyName.Equals(Property.Name, ESearchCase::CaseSensitive))
+        {
+            return &Property.Value;
+        }
+    }
+    return nullptr;
+}
+
+
+bool FMarkupParser::Parse(FStringView LineText, FMarkupParseResult& OutResult, const FYarnCultureRules* Rules)
+{
+    FString& Text = OutResult.Text;
+    TArray<FYarnMarkupAttribute>& Attributes = OutResult.Attributes;
+    Attributes.Reset();
+
+    if (!HasMarkup(LineText))
+    {
+        Text = FString(LineText);
+        return true;
+    }
+
+    Text.Reset(LineText.Len());
+    // Indices in Attributes of the attributes still open, innermost last
+    TArray<int32, TInlineAllocator<8>> Open;
+    bool bNoMarkup = false;
+    bool bHasCharacter = false;
+
+    int32 Index = 0;
+    while (Index < LineText.Len())
+    {
+        const TCHAR Char = LineText[Index];
+        if (Char == TEXT('\\') && !bNoMarkup && Index + 1 < LineText.Len() && IsEscapable(LineText[Index + 1]))
+        {
+            Text.AppendChar(LineText[Index + 1]);
+            Index += 2;
+            continue;
+        }
+        if (Char != TEXT('['))
+        {
+            Text.AppendChar(Char);
+            Index++;
+            continue;
+        }
+
+        const int32 TagStart = Index;
+        const int32 TagEnd = FindTagEnd(LineText, Index + 1);
+        if (TagEnd == INDEX_NONE)
+        {
+            if (bNoMarkup)
+            {
+                Text.Append(LineText.GetData() + Index, LineText.Len() - Index);
+                break;
+            }
+            return Fail(LineText, OutResult, TEXT("a [ with no ]"));
+        }
+        FStringView Tag = LineText.Mid(TagStart + 1, TagEnd - TagStart - 1).TrimStartAndEnd();
+        Index = TagEnd + 1;
+
+        if (bNoMarkup)
+        {
+            if (Tag.Len() > 1 && Tag[0] == TEXT('/') && Tag.Mid(1).TrimStart().Equals(NoMarkupAttribute, ESearchCase::CaseSensitive))
+            {
+                bNoMarkup = false;
+            }
+            else
+            {
+                Text.Append(LineText.GetData() + TagStart, Index - TagStart);
+            }
+            continue;
+        }
+
+        if (Tag.Len() == 1 && Tag[0] == TEXT('/'))
+        {
+            for (const int32 OpenIndex : Open)
+            {
+                Attributes[OpenIndex].Length = Text.Len() - Attributes[OpenIndex].Position;
+            }
+            Open.Reset();
+            continue;
+        }
+
+        if (Tag.Len() > 0 && Tag[0] == TEXT('/'))
+        {
+            const FStringView Name = Tag.Mid(1).TrimStart();
+            int32 OpenPosition = Open.Num() - 1;
+            while (OpenPosition >= 0 && !Name.Equals(Attributes[Open[OpenPosition]].Name, ESearchCase::CaseSensitive))
+            {
+                OpenPosition--;
+            }
+            if (OpenPosition < 0)
+            {
+                return Fail(LineText, OutResult, TEXT("a closing tag for an attribute that isn't open"));
+            }
+            FYarnMarkupAttribute& Attribute = Attributes[Open[OpenPosition]];
+            Attribute.Length = Text.Len() - Attribute.Position;
+            Open.RemoveAt(OpenPosition);
+            continue;
+        }
+
+        const bool bSelfClosing = Tag.EndsWith(TEXT('/'));
+        if (bSelfClosing)
+        {
+            Tag = Tag.LeftChop(1).TrimEnd();
+        }
+
+        FYarnMarkupAttribute Attribute;
+        if (!ParseOpenTag(Tag, Attribute))
+        {
+            return Fail(LineText, OutResult, TEXT("a malformed tag"));
+        }
+
+        if (!bSelfClosing && FCString::Strcmp(*Attribute.Name, NoMarkupAttribute) == 0)
+        {
+            bNoMarkup = true;
+            continue;
+        }
+
+        if (bSelfClosing && IsReplacementMarker(Attribute.Name))
+        {
+            if (!AppendReplacement(Attribute, Rules, Text))
+            {
+                return Fail(LineText, OutResult, TEXT("a replacement marker with no value"));
+            }
+            continue;
+        }
+
+        bHasCharacter |= FCString::Strcmp(*Attribute.Name, CharacterAttribute) == 0;
+        Attribute.Position = Text.Len();
+
+        if (bSelfClosing)
+        {
+            // As in Yarn Spinner, a self-closing tag between two spaces leaves only one of them
+            const FString* Trim = Attribute.FindProperty(TEXT("trimwhitespace"));
+            const bool bTrim = !Trim || FCString::Stricmp(**Trim, TEXT("false")) != 0;
+            if (bTrim && (Text.IsEmpty() || FChar::IsWhitespace(Text[Text.Len() - 1])) && Index < LineText.Len() && FChar::IsWhitespace(LineText[Index]))
+            {
+                Index++;
+            }
+            Attributes.Add(MoveTemp(Attribute));
+        }
+        else
+        {
+            Open.Add(Attributes.Add(MoveTemp(Attribute)));
+        }
+    }
+
+    // Anything left open runs to the end of the line
+    for (const int32 OpenIndex : Open)
+    {
+        Attributes[OpenIndex].Length = Text.Len() - Attributes[OpenIndex].Position;
+    }
+
+    if (!bHasCharacter)
+    {
+        AddCharacterAttribute(OutResult);
+    }
+    return true;
+}
+
+
+bool FMarkupParser::HasMarkup(FStringView LineText)
+{
+    for (const TCHAR Char : LineText)
+    {
+        if (Char == TEXT('[') || Char == TEXT('\\') || Char == TEXT(':'))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void FYarnMarkupTable::Build(TArrayView<FString> InOutLines, const FYarnCultureRules* Rules)
 {
-    // TODO
-    FString S;
-    for (auto C : LineText)
+    Reset();
+
+    TMap<FString, int32, FDefaultSetAllocator, FCaseSensitiveKeyFuncs> StringIndices;
+    auto Intern = [this, &StringIndices](const FString& String)
+    {
+        if (const int32* Found = StringIndices.Find(String))
+        {
+            return *Found;
+        }
+        const int32 StringIndex = Strings.Add(String);
+        StringIndices.Add(String, StringIndex);
+        return StringIndex;
+    };
+
+    LineSpans.Reserve(InOutLines.Num() + 1);
+    FMarkupParseResult Result;
+    for (FString& Line : InOutLines)
     {
+        LineSpans.Add(Spans.Num());
+        if (NeedsRuntimeParse(Line) || !FMarkupParser::HasMarkup(Line) || !FMarkupParser::Parse(Line, Result, Rules))
+        {
+            continue;
+        }
+
+        for (const FYarnMarkupAttribute& Attribute : Result.Attributes)
+        {
+            FYarnMarkupSpan& Span = Spans.AddDefaulted_GetRef();
+            Span.Name = Intern(Attribute.Name);
+            Span.Position = Attribute.Position;
+            Span.Length = Attribute.Length;
+            Span.FirstProperty = Properties.Num() / 2;
+            Span.NumProperties = Attribute.Properties.Num();
+            for (const FYarnMarkupProperty& Property : Attribute.Properties)
+            {
+                Properties.Add(Intern(Property.Name));
+                Properties.Add(Intern(Property.Value));
+            }
+        }
+        Line = MoveTemp(Result.Text);
+    }
+    LineSpans.Add(Spans.Num());
+}
+
+
+void FYarnMarkupTable::Reset()
+{
+    LineSpans.Reset();
+    Spans.Reset();
+    Properties.Reset();
+    Strings.Reset();
+}
+
+
+bool FYarnMarkupTable::NeedsRuntimeParse(FStringView LineText)
+{
+    int32 Brace;
+    return LineText.FindChar(TEXT('{'), Brace);
+}
+
 
+int32 FYarnMarkupTable::NumAttributes(int32 LineIndex) const
+{
+    if (LineIndex < 0 || LineIndex + 1 >= LineSpans.Num())
+    {
+        return 0;
+    }
+    return LineSpans[LineIndex + 1] - LineSpans[LineIndex];
+}
+
+
+void FYarnMarkupTable::GetAttributes(int32 LineIndex, TArray<FYarnMarkupAttribute>& OutAttributes) const
+{
+    OutAttributes.Reset();
+    const int32 Count = NumAttributes(LineIndex);
+    OutAttributes.Reserve(Count);
+    for (int32 SpanIndex = LineSpans.IsValidIndex(LineIndex) ? LineSpans[LineIndex] : 0; OutAttributes.Num() < Count; SpanIndex++)
+    {
+        const FYarnMarkupSpan& Span = Spans[SpanIndex];
+        FYarnMarkupAttribute& Attribute = OutAttributes.AddDefaulted_GetRef();
+        Attribute.Name = Strings[Span.Name];
+        Attribute.Position = Span.Position;
+        Attribute.Length = Span.Length;
+        Attribute.Properties.Reserve(Span.NumProperties);
+        for (int32 PropertyIndex = Span.FirstProperty; PropertyIndex < Span.FirstProperty + Span.NumProperties; PropertyIndex++)
+        {
+            FYarnMarkupProperty& Property = Attribute.Properties.AddDefaulted_GetRef();
+            Property.Name = Strings[Properties[PropertyIndex * 2]];
+            Property.Value = Strings[Properties[PropertyIndex * 2 + 1]];
+        }
+    }
+}
+
+
+SIZE_T FYarnMarkupTable::GetAllocatedSize() const
+{
+    SIZE_T Size = LineSpans.GetAllocatedSize() + Spans.GetAllocatedSize() + Properties.GetAllocatedSize() + Strings.GetAllocatedSize();
+    for (const FString& String : Strings)
+    {
+        Size += String.GetAllocatedSize();
     }
-    return "";
+    return Size;
 }
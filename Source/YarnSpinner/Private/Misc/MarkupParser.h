@@ -1,10 +0,0 @@
-﻿#pragma once
-
-class FMarkupParser
-{
-public:
-
-    FString Parse(const FString& LineText);
-
-    
-};
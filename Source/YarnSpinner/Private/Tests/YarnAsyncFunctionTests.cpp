@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnDialogueTestHelpers.h"
+
+#include "DialogueRunner.h"
+#include "YarnSubsystem.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Library/YarnNativeFunctionRegistry.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/ScopeExit.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+using namespace YarnTests;
+
+
+namespace
+{
+    // Registers an async function answering with a promise the test keeps, so it decides when (and whether) each call
+    // returns.  Every promise must be fulfilled before the test ends.
+    void RegisterPromisedFunction(FName Name, TArray<TSharedRef<TPromise<double>>>& Promises, float Timeout = 0)
+    {
+        FYarnNativeFunctionRegistry::Get().RegisterAsync(Name, [&Promises]()
+        {
+            return Promises.Add_GetRef(MakeShared<TPromise<double>>())->GetFuture();
+        }, Timeout, 7.0);
+    }
+
+
+    // Stores the function's result in $result, then runs a line
+    Yarn::Program MakeProgram(const char* FunctionName)
+    {
+        Yarn::Program Program;
+        FNodeBuilder(Program, "Start").CallFunction(FunctionName, 0).StoreVariable("$result").Pop().Line("line:after").Stop();
+        return Program;
+    }
+
+
+    // Results are handed to the runner on the game thread
+    void RunGameThreadTasks()
+    {
+        FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+    }
+
+
+    double GetResult(const FTestDialogue& Dialogue)
+    {
+        const TOptional<Yarn::Value> Result = Dialogue.FindVariable(TEXT("$result"));
+        return Result.IsSet() ? Result->GetNumberValue() : -1;
+    }
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnAsyncFunctionResumeTest, "YarnSpinner.AsyncFunctions.Resume", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnAsyncFunctionResumeTest::RunTest(const FString& Parameters)
+{
+    TArray<TSharedRef<TPromise<double>>> Promises;
+    RegisterPromisedFunction(TEXT("test_async_resume"), Promises);
+    ON_SCOPE_EXIT { FYarnNativeFunctionRegistry::Get().Unregister(TEXT("test_async_resume")); };
+
+    FTestDialogue Dialogue(MakeProgram("test_async_resume"));
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    if (!TestEqual(TEXT("Calls made"), Promises.Num(), 1))
+    {
+        return false;
+    }
+    TestEqual(TEXT("Waiting on the function"), Dialogue.GetLines(), TEXT(""));
+
+    Promises[0]->SetValue(42);
+    RunGameThreadTasks();
+    TestEqual(TEXT("Carried on with the result"), Dialogue.GetLines(), TEXT("line:after"));
+    TestEqual(TEXT("Result"), GetResult(Dialogue), 42.0);
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnAsyncFunctionStaleResultTest, "YarnSpinner.AsyncFunctions.StaleResult", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnAsyncFunctionStaleResultTest::RunTest(const FString& Parameters)
+{
+    TArray<TSharedRef<TPromise<double>>> Promises;
+    RegisterPromisedFunction(TEXT("test_async_stale"), Promises);
+    ON_SCOPE_EXIT { FYarnNativeFunctionRegistry::Get().Unregister(TEXT("test_async_stale")); };
+
+    FTestDialogue Dialogue(MakeProgram("test_async_stale"));
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    Dialogue.GetRunner().StopDialogue();
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    if (!TestEqual(TEXT("Calls made"), Promises.Num(), 2))
+    {
+        return false;
+    }
+
+    // The first call belongs to the dialogue that was stopped, so its result must not resume the new one
+    Promises[0]->SetValue(1);
+    RunGameThreadTasks();
+    TestEqual(TEXT("Still waiting after the stale result"), Dialogue.GetLines(), TEXT(""));
+    TestFalse(TEXT("Stale result stored"), Dialogue.FindVariable(TEXT("$result")).IsSet());
+
+    Promises[1]->SetValue(2);
+    RunGameThreadTasks();
+    TestEqual(TEXT("Carried on with the current result"), Dialogue.GetLines(), TEXT("line:after"));
+    TestEqual(TEXT("Result"), GetResult(Dialogue), 2.0);
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnAsyncFunctionTimeoutTest, "YarnSpinner.AsyncFunctions.Timeout", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnAsyncFunctionTimeoutTest::RunTest(const FString& Parameters)
+{
+    AddExpectedError(TEXT("didn't return within"), EAutomationExpectedErrorFlags::Contains, 1);
+
+    TArray<TSharedRef<TPromise<double>>> Promises;
+    RegisterPromisedFunction(TEXT("test_async_timeout"), Promises, 1);
+    ON_SCOPE_EXIT { FYarnNativeFunctionRegistry::Get().Unregister(TEXT("test_async_timeout")); };
+
+    FTestDialogue Dialogue(MakeProgram("test_async_timeout"));
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    if (!TestEqual(TEXT("Calls made"), Promises.Num(), 1))
+    {
+        return false;
+    }
+    Dialogue.AdvanceTime(0.9);
+    TestEqual(TEXT("Waiting before the timeout"), Dialogue.GetLines(), TEXT(""));
+    Dialogue.AdvanceTime(0.2);
+    TestEqual(TEXT("Carried on at the timeout"), Dialogue.GetLines(), TEXT("line:after"));
+    TestEqual(TEXT("Timeout value"), GetResult(Dialogue), 7.0);
+
+    // The real result turning up afterwards changes nothing
+    Promises[0]->SetValue(3);
+    RunGameThreadTasks();
+    TestEqual(TEXT("Lines after the late result"), Dialogue.GetLines(), TEXT("line:after"));
+    TestEqual(TEXT("Result after the late result"), GetResult(Dialogue), 7.0);
+    return true;
+}
+
+
+#endif
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnDialogueTestHelpers.h"
+
+#include "DialogueRunner.h"
+#include "YarnProject.h"
+#include "YarnSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace YarnTests
+{
+    FNodeBuilder::FNodeBuilder(Yarn::Program& Program, const char* NodeName)
+        : Node((*Program.mutable_nodes())[NodeName])
+    {
+        Node.set_name(NodeName);
+    }
+
+
+    FNodeBuilder& FNodeBuilder::Line(const char* LineID)
+    {
+        Add(Yarn::Instruction_OpCode_RUN_LINE).add_operands()->set_string_value(LineID);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::Command(const char* Text)
+    {
+        Add(Yarn::Instruction_OpCode_RUN_COMMAND).add_operands()->set_string_value(Text);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::PushFloat(float Value)
+    {
+        Add(Yarn::Instruction_OpCode_PUSH_FLOAT).add_operands()->set_float_value(Value);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::PushVariable(const char* Name)
+    {
+        Add(Yarn::Instruction_OpCode_PUSH_VARIABLE).add_operands()->set_string_value(Name);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::StoreVariable(const char* Name)
+    {
+        Add(Yarn::Instruction_OpCode_STORE_VARIABLE).add_operands()->set_string_value(Name);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::Pop()
+    {
+        Add(Yarn::Instruction_OpCode_POP);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::CallFunction(const char* Name, int32 NumParams)
+    {
+        PushFloat(NumParams);
+        Add(Yarn::Instruction_OpCode_CALL_FUNC).add_operands()->set_string_value(Name);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::Label(const char* Name)
+    {
+        (*Node.mutable_labels())[Name] = Node.instructions_size();
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::JumpTo(const char* Label)
+    {
+        Add(Yarn::Instruction_OpCode_JUMP_TO).add_operands()->set_string_value(Label);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::JumpIfFalse(const char* Label)
+    {
+        Add(Yarn::Instruction_OpCode_JUMP_IF_FALSE).add_operands()->set_string_value(Label);
+        return *this;
+    }
+
+
+    FNodeBuilder& FNodeBuilder::Stop()
+    {
+        Add(Yarn::Instruction_OpCode_STOP);
+        return *this;
+    }
+
+
+    Yarn::Instruction& FNodeBuilder::Add(Yarn::Instruction_OpCode OpCode)
+    {
+        Yarn::Instruction* Instruction = Node.add_instructions();
+        Instruction->set_opcode(OpCode);
+        return *Instruction;
+    }
+
+
+    FTestDialogue::FTestDialogue(const Yarn::Program& Program, TFunction<void(ADialogueRunner&)> Configure)
+    {
+        GameInstance = NewObject<UGameInstance>(GEngine);
+        GameInstance->AddToRoot();
+        GameInstance->InitializeStandalone();
+        World = GameInstance->GetWorld();
+        World->InitializeActorsForPlay(FURL());
+
+        UYarnProject* Project = NewObject<UYarnProject>(GetTransientPackage());
+        Project->Data.SetNumUninitialized(Program.ByteSizeLong());
+        Program.SerializeToArray(Project->Data.GetData(), Project->Data.Num());
+
+        Runner = World->SpawnActorDeferred<ADialogueRunner>(ADialogueRunner::StaticClass(), FTransform::Identity);
+        Runner->YarnProject = Project;
+        if (Configure)
+        {
+            Configure(*Runner);
+        }
+        Runner->FinishSpawning(FTransform::Identity);
+        Runner->SetDialogueListener(this);
+    }
+
+
+    FTestDialogue::~FTestDialogue()
+    {
+        Runner->SetDialogueListener(nullptr);
+        GameInstance->Shutdown();
+        World->DestroyWorld(false);
+        GEngine->DestroyWorldContext(World);
+        GameInstance->RemoveFromRoot();
+    }
+
+
+    UYarnSubsystem& FTestDialogue::GetSubsystem() const
+    {
+        return *GameInstance->GetSubsystem<UYarnSubsystem>();
+    }
+
+
+    TOptional<Yarn::Value> FTestDialogue::FindVariable(const FString& Name) const
+    {
+        return GetSubsystem().GetVariableStore().Find(Name);
+    }
+
+
+    void FTestDialogue::AdvanceTime(double Seconds)
+    {
+        constexpr double FrameSeconds = 1.0 / 60;
+        for (; Seconds > 0; Seconds -= FrameSeconds)
+        {
+            GetSubsystem().GetTimerWheel().Advance(FMath::Min(Seconds, FrameSeconds));
+        }
+    }
+
+
+    void FTestDialogue::NextFrame()
+    {
+        GFrameCounter++;
+        GetSubsystem().Tick(0);
+    }
+
+
+    bool FTestDialogue::HandleLine(ADialogueRunner& InRunner, const FYarnLineView& Line)
+    {
+        Lines.Add(Line.LineID.ToString());
+        return true;
+    }
+
+
+    FScopedConsoleVariable::FScopedConsoleVariable(const TCHAR* Name, int32 Value)
+        : Variable(IConsoleManager::Get().FindConsoleVariable(Name))
+    {
+        check(Variable);
+        OldValue = Variable->GetString();
+        Variable->Set(Value, ECVF_SetByConsole);
+    }
+
+
+    FScopedConsoleVariable::~FScopedConsoleVariable()
+    {
+        Variable->Set(*OldValue, ECVF_SetByConsole);
+    }
+}
+
+
+#endif
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnDialogueListener.h"
+#include "YarnSpinnerCore/Value.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "YarnSpinnerCore/yarn_spinner.pb.h"
+THIRD_PARTY_INCLUDES_END
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+class ADialogueRunner;
+class IConsoleVariable;
+class UGameInstance;
+class UWorld;
+class UYarnSubsystem;
+
+
+namespace YarnTests
+{
+    // Appends instructions to a node, for tests that need a program without going through the compiler
+    class FNodeBuilder
+    {
+    public:
+        FNodeBuilder(Yarn::Program& Program, const char* NodeName);
+
+        FNodeBuilder& Line(const char* LineID);
+        FNodeBuilder& Command(const char* Text);
+        FNodeBuilder& PushFloat(float Value);
+        FNodeBuilder& PushVariable(const char* Name);
+        FNodeBuilder& StoreVariable(const char* Name);
+        FNodeBuilder& Pop();
+        // Pushes the parameter count and calls the function; the parameters must already be on the stack
+        FNodeBuilder& CallFunction(const char* Name, int32 NumParams);
+        // Labels the next instruction added
+        FNodeBuilder& Label(const char* Name);
+        FNodeBuilder& JumpTo(const char* Label);
+        FNodeBuilder& JumpIfFalse(const char* Label);
+        FNodeBuilder& Stop();
+
+    private:
+        Yarn::Node& Node;
+
+        Yarn::Instruction& Add(Yarn::Instruction_OpCode OpCode);
+    };
+
+
+    /**
+     * A dialogue runner for Program in a game instance and world of its own.  Lines are recorded rather than presented,
+     * and the dialogue waits at each one until the test calls ContinueDialogue.  Neither time nor frames pass unless
+     * the test advances them.
+     */
+    class FTestDialogue : public IYarnDialogueListener
+    {
+    public:
+        // Configure is called on the runner before it initializes
+        explicit FTestDialogue(const Yarn::Program& Program, TFunction<void(ADialogueRunner&)> Configure = nullptr);
+        virtual ~FTestDialogue() override;
+
+        ADialogueRunner& GetRunner() const { return *Runner; }
+        UYarnSubsystem& GetSubsystem() const;
+
+        // The IDs of the lines delivered so far, comma separated
+        FString GetLines() const { return FString::Join(Lines, TEXT(",")); }
+        TOptional<Yarn::Value> FindVariable(const FString& Name) const;
+
+        // Runs the dialogue timers forward, a frame's worth at a time
+        void AdvanceTime(double Seconds);
+        // Ticks the subsystem on a new frame, which resumes dialogue that yielded on an earlier one
+        void NextFrame();
+
+        virtual bool HandleLine(ADialogueRunner& InRunner, const FYarnLineView& Line) override;
+
+    private:
+        UGameInstance* GameInstance = nullptr;
+        UWorld* World = nullptr;
+        ADialogueRunner* Runner = nullptr;
+        TArray<FString> Lines;
+    };
+
+
+    // Sets a console variable until it goes out of scope
+    class FScopedConsoleVariable
+    {
+    public:
+        FScopedConsoleVariable(const TCHAR* Name, int32 Value);
+        ~FScopedConsoleVariable();
+
+    private:
+        IConsoleVariable* Variable;
+        FString OldValue;
+    };
+}
+
+
+#endif
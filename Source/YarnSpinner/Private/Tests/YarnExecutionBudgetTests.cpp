@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnDialogueTestHelpers.h"
+
+#include "DialogueRunner.h"
+#include "YarnSubsystem.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+using namespace YarnTests;
+
+
+namespace
+{
+    // Counts $i up to Count with no content in between, about 13 instructions a time round, then runs a line
+    Yarn::Program MakeCountingProgram(int32 Count)
+    {
+        Yarn::Program Program;
+        FNodeBuilder(Program, "Start")
+            .PushFloat(0).StoreVariable("$i").Pop()
+            .Label("loop")
+            .PushVariable("$i").PushFloat(1).CallFunction("Number.Add", 2).StoreVariable("$i").Pop()
+            .PushVariable("$i").PushFloat(Count).CallFunction("Number.LessThan", 2).JumpIfFalse("done").Pop()
+            .JumpTo("loop")
+            .Label("done")
+            .Pop()
+            .Line("line:done")
+            .Stop();
+        return Program;
+    }
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnInstructionBudgetTest, "YarnSpinner.ExecutionBudget.InstructionBudget", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnInstructionBudgetTest::RunTest(const FString& Parameters)
+{
+    FScopedConsoleVariable InstructionBudget(TEXT("yarn.InstructionBudget"), 500);
+    FTestDialogue Dialogue(MakeCountingProgram(500));
+
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    TestEqual(TEXT("Yielded before finishing the loop"), Dialogue.GetLines(), TEXT(""));
+
+    // Yielded dialogue waits for the next frame, however often the subsystem ticks in this one
+    Dialogue.GetSubsystem().Tick(0);
+    const TOptional<Yarn::Value> Counted = Dialogue.FindVariable(TEXT("$i"));
+    TestTrue(TEXT("Counted part of the way on the first frame"), Counted.IsSet() && Counted->GetNumberValue() > 0 && Counted->GetNumberValue() < 500);
+
+    int32 Frames = 0;
+    while (Dialogue.GetLines().IsEmpty() && Frames < 100)
+    {
+        Dialogue.NextFrame();
+        Frames++;
+    }
+
+    // About 6500 instructions at 500 a frame
+    TestEqual(TEXT("Line after the loop"), Dialogue.GetLines(), TEXT("line:done"));
+    TestTrue(*FString::Printf(TEXT("Spread over enough frames (%d)"), Frames), Frames >= 12 && Frames <= 14);
+    const TOptional<Yarn::Value> Total = Dialogue.FindVariable(TEXT("$i"));
+    TestTrue(TEXT("Counted all the way"), Total.IsSet() && Total->GetNumberValue() == 500);
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnRunawayLimitTest, "YarnSpinner.ExecutionBudget.RunawayLimit", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnRunawayLimitTest::RunTest(const FString& Parameters)
+{
+    AddExpectedError(TEXT("without delivering any content"), EAutomationExpectedErrorFlags::Contains, 1);
+    AddExpectedError(TEXT("VirtualMachine encountered an error"), EAutomationExpectedErrorFlags::Contains, 1);
+
+    // The count carries over yields, so a loop spread over several frames is still caught
+    FScopedConsoleVariable InstructionBudget(TEXT("yarn.InstructionBudget"), 300);
+    FScopedConsoleVariable RunawayLimit(TEXT("yarn.RunawayInstructionLimit"), 1000);
+
+    Yarn::Program Program;
+    FNodeBuilder(Program, "Start").Label("loop").JumpTo("loop").Stop();
+    FTestDialogue Dialogue(Program);
+
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    for (int32 Frame = 0; Frame < 10; Frame++)
+    {
+        Dialogue.NextFrame();
+    }
+    TestEqual(TEXT("Lines"), Dialogue.GetLines(), TEXT(""));
+    return true;
+}
+
+
+#endif
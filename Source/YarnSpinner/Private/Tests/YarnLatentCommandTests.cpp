@@ -0,0 +1,109 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnDialogueTestHelpers.h"
+
+#include "DialogueRunner.h"
+#include "YarnSubsystem.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+using namespace YarnTests;
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnLatentCommandDelayTest, "YarnSpinner.LatentCommands.Delay", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnLatentCommandDelayTest::RunTest(const FString& Parameters)
+{
+    Yarn::Program Program;
+    FNodeBuilder(Program, "Start").Command("wait 1").Line("line:after").Stop();
+    FTestDialogue Dialogue(Program);
+
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    TestEqual(TEXT("Waiting to start with"), Dialogue.GetLines(), TEXT(""));
+    Dialogue.AdvanceTime(0.9);
+    TestEqual(TEXT("Still waiting before the delay is up"), Dialogue.GetLines(), TEXT(""));
+    Dialogue.AdvanceTime(0.2);
+    TestEqual(TEXT("Carried on once the delay is up"), Dialogue.GetLines(), TEXT("line:after"));
+    TestEqual(TEXT("Timers left"), Dialogue.GetSubsystem().GetTimerWheel().Num(), 0);
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnLatentCommandJoinTest, "YarnSpinner.LatentCommands.Join", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnLatentCommandJoinTest::RunTest(const FString& Parameters)
+{
+    Yarn::Program Program;
+    FNodeBuilder(Program, "Start")
+        .Command("parallel")
+        .Command("wait 1")
+        .Command("wait 2")
+        .Line("line:during")
+        .Command("join")
+        .Line("line:after")
+        .Stop();
+    FTestDialogue Dialogue(Program);
+
+    // Parallel commands don't hold up the line after them
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    TestEqual(TEXT("Ran on past the parallel commands"), Dialogue.GetLines(), TEXT("line:during"));
+
+    // But the join waits for the longest of them
+    Dialogue.GetRunner().ContinueDialogue();
+    Dialogue.AdvanceTime(1.1);
+    TestEqual(TEXT("Still joining after the first command finished"), Dialogue.GetLines(), TEXT("line:during"));
+    Dialogue.AdvanceTime(0.8);
+    TestEqual(TEXT("Still joining just before the second finished"), Dialogue.GetLines(), TEXT("line:during"));
+    Dialogue.AdvanceTime(0.2);
+    TestEqual(TEXT("Carried on once both finished"), Dialogue.GetLines(), TEXT("line:during,line:after"));
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnLatentCommandTimeoutTest, "YarnSpinner.LatentCommands.Timeout", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnLatentCommandTimeoutTest::RunTest(const FString& Parameters)
+{
+    AddExpectedError(TEXT("didn't complete within"), EAutomationExpectedErrorFlags::Contains, 1);
+
+    Yarn::Program Program;
+    FNodeBuilder(Program, "Start").Command("wait 5").Line("line:after").Stop();
+    FTestDialogue Dialogue(Program, [](ADialogueRunner& Runner) { Runner.LatentCommandTimeout = 1; });
+
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    Dialogue.AdvanceTime(0.9);
+    TestEqual(TEXT("Waiting before the timeout"), Dialogue.GetLines(), TEXT(""));
+    Dialogue.AdvanceTime(0.2);
+    TestEqual(TEXT("Carried on at the timeout"), Dialogue.GetLines(), TEXT("line:after"));
+
+    // The cancelled command's own timer went with it
+    TestEqual(TEXT("Timers left"), Dialogue.GetSubsystem().GetTimerWheel().Num(), 0);
+    Dialogue.AdvanceTime(5);
+    TestEqual(TEXT("Nothing more once the command would have finished"), Dialogue.GetLines(), TEXT("line:after"));
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnLatentCommandStopTest, "YarnSpinner.LatentCommands.Stop", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnLatentCommandStopTest::RunTest(const FString& Parameters)
+{
+    Yarn::Program Program;
+    FNodeBuilder(Program, "Start").Command("wait 1").Line("line:after").Stop();
+    FTestDialogue Dialogue(Program);
+
+    Dialogue.GetRunner().StartDialogue(TEXT("Start"));
+    TestEqual(TEXT("Timers while waiting"), Dialogue.GetSubsystem().GetTimerWheel().Num(), 1);
+    Dialogue.GetRunner().StopDialogue();
+    TestEqual(TEXT("Timers once stopped"), Dialogue.GetSubsystem().GetTimerWheel().Num(), 0);
+
+    Dialogue.AdvanceTime(2);
+    TestEqual(TEXT("Stopped dialogue doesn't carry on"), Dialogue.GetLines(), TEXT(""));
+    return true;
+}
+
+
+#endif
@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnNodeIndex.h"
+
+#include "Misc/AutomationTest.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "YarnSpinnerCore/yarn_spinner.pb.h"
+THIRD_PARTY_INCLUDES_END
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace
+{
+    void AddNode(Yarn::Program& Program, const char* Name, std::initializer_list<const char*> Tags, std::initializer_list<std::pair<const char*, const char*>> Headers)
+    {
+        Yarn::Node& Node = (*Program.mutable_nodes())[Name];
+        Node.set_name(Name);
+        for (const char* Tag : Tags)
+        {
+            Node.add_tags(Tag);
+        }
+        for (const auto& Header : Headers)
+        {
+            Yarn::Header* Added = Node.add_headers();
+            Added->set_key(Header.first);
+            Added->set_value(Header.second);
+        }
+    }
+
+
+    TArray<FString> SortedNodeNames(const Yarn::Program& Program)
+    {
+        TArray<FString> Names;
+        for (const auto& Node : Program.nodes())
+        {
+            Names.Add(UTF8_TO_TCHAR(Node.first.c_str()));
+        }
+        Names.Sort();
+        return Names;
+    }
+
+
+    // The names of the nodes found, comma separated
+    FString FindNodeNames(const FYarnNodeIndex& Index, const TArray<FString>& NodeNames, TArrayView<const FStringView> Tags, TArrayView<const TPair<FStringView, FStringView>> Headers = {})
+    {
+        TArray<int32> Found;
+        Index.FindNodes(Tags, Headers, Found);
+        TArray<FString> Names;
+        for (const int32 NodeIndex : Found)
+        {
+            Names.Add(NodeNames[NodeIndex]);
+        }
+        return FString::Join(Names, TEXT(","));
+    }
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnNodeIndexMixedCaseTest, "YarnSpinner.NodeIndex.MixedCaseTags", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnNodeIndexMixedCaseTest::RunTest(const FString& Parameters)
+{
+    // The capitalised spellings come first, so a case-insensitive index would file the lowercase ones under them
+    Yarn::Program Program;
+    AddNode(Program, "A", {"Bark"}, {{"speaker", "Guard"}});
+    AddNode(Program, "B", {"bark"}, {{"speaker", "guard"}});
+    AddNode(Program, "C", {}, {{"tags", "bark BARK"}, {"speaker", "guard"}});
+    AddNode(Program, "D", {"ambient"}, {});
+
+    const TArray<FString> NodeNames = SortedNodeNames(Program);
+    FYarnNodeIndex Index;
+    Index.Build(Program, NodeNames);
+    TestEqual(TEXT("Node count"), Index.NumNodes(), 4);
+
+    const FStringView LowerBark[] = {TEXTVIEW("bark")};
+    const FStringView UpperBark[] = {TEXTVIEW("Bark")};
+    const FStringView ShoutedBark[] = {TEXTVIEW("BARK")};
+    const FStringView NoSuchCase[] = {TEXTVIEW("bArK")};
+    TestEqual(TEXT("bark"), FindNodeNames(Index, NodeNames, LowerBark), TEXT("B,C"));
+    TestEqual(TEXT("Bark"), FindNodeNames(Index, NodeNames, UpperBark), TEXT("A"));
+    TestEqual(TEXT("BARK"), FindNodeNames(Index, NodeNames, ShoutedBark), TEXT("C"));
+    TestEqual(TEXT("bArK"), FindNodeNames(Index, NodeNames, NoSuchCase), TEXT(""));
+
+    const TPair<FStringView, FStringView> LowerGuard[] = {TPair<FStringView, FStringView>(TEXTVIEW("speaker"), TEXTVIEW("guard"))};
+    const TPair<FStringView, FStringView> UpperGuard[] = {TPair<FStringView, FStringView>(TEXTVIEW("speaker"), TEXTVIEW("Guard"))};
+    TestEqual(TEXT("bark + speaker: guard"), FindNodeNames(Index, NodeNames, LowerBark, LowerGuard), TEXT("B,C"));
+    TestEqual(TEXT("Bark + speaker: Guard"), FindNodeNames(Index, NodeNames, UpperBark, UpperGuard), TEXT("A"));
+    TestEqual(TEXT("Bark + speaker: guard"), FindNodeNames(Index, NodeNames, UpperBark, LowerGuard), TEXT(""));
+
+    TestEqual(TEXT("No terms"), FindNodeNames(Index, NodeNames, {}), TEXT("A,B,C,D"));
+    return true;
+}
+
+
+#endif
@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnPluralRules.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace
+{
+    struct FOperandCase
+    {
+        const TCHAR* Condition;
+        const TCHAR* Number;
+        bool bMatches;
+    };
+
+    // One rule at a time, so each case checks a single operand the way CLDR defines it
+    const FOperandCase OperandCases[] = {
+        // n: the absolute value, fraction included
+        {TEXT("n = 3"), TEXT("3"), true},
+        {TEXT("n = 3"), TEXT("3.0"), true},
+        {TEXT("n = 3"), TEXT("-3"), true},
+        {TEXT("n = 3"), TEXT("3.5"), false},
+        {TEXT("n % 10 = 3"), TEXT("13.0"), true},
+        {TEXT("n % 10 = 3"), TEXT("13.5"), false},
+
+        // i: the integer digits
+        {TEXT("i = 3"), TEXT("3.7"), true},
+        {TEXT("i = 3"), TEXT("-3"), true},
+        {TEXT("i = 3"), TEXT("4"), false},
+
+        // v: fraction digits, trailing zeros included
+        {TEXT("v = 0"), TEXT("1"), true},
+        {TEXT("v = 0"), TEXT("1.0"), false},
+        {TEXT("v = 2"), TEXT("1.50"), true},
+        {TEXT("v = 2"), TEXT("1.5"), false},
+
+        // w: fraction digits without trailing zeros
+        {TEXT("w = 1"), TEXT("1.50"), true},
+        {TEXT("w = 1"), TEXT("1.05"), false},
+
+        // f: the fraction digits, trailing zeros included
+        {TEXT("f = 50"), TEXT("1.50"), true},
+        {TEXT("f = 50"), TEXT("1.5"), false},
+        {TEXT("f = 0"), TEXT("1"), true},
+
+        // t: the fraction digits without trailing zeros
+        {TEXT("t = 5"), TEXT("1.50"), true},
+        {TEXT("t = 5"), TEXT("1.5"), true},
+        {TEXT("t = 5"), TEXT("1.05"), true},
+        {TEXT("t = 5"), TEXT("1.25"), false},
+        {TEXT("t != 0"), TEXT("1.0"), false},
+        {TEXT("t != 0"), TEXT("1.2"), true},
+
+        // e: always 0
+        {TEXT("e = 0"), TEXT("5"), true},
+
+        // Ranges and lists
+        {TEXT("i = 1..3,7"), TEXT("2"), true},
+        {TEXT("i = 1..3,7"), TEXT("7"), true},
+        {TEXT("i = 1..3,7"), TEXT("5"), false},
+        {TEXT("i != 1..3,7"), TEXT("5"), true},
+
+        // "and" binds tighter than "or"
+        {TEXT("i = 1 and v = 0 or i = 5"), TEXT("5.5"), true},
+        {TEXT("i = 1 and v = 0 or i = 5"), TEXT("1.5"), false},
+
+        // Samples aren't part of the condition
+        {TEXT("i = 1 @integer 1"), TEXT("1"), true},
+
+        // Anything that isn't a number is Other
+        {TEXT("n = 1"), TEXT("one"), false},
+        {TEXT("n = 1"), TEXT("1e3"), false},
+        {TEXT("n = 1"), TEXT(""), false},
+    };
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnPluralRulesOperandsTest, "YarnSpinner.PluralRules.Operands", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnPluralRulesOperandsTest::RunTest(const FString& Parameters)
+{
+    for (const FOperandCase& Case : OperandCases)
+    {
+        FYarnPluralRules Rules;
+        if (!TestTrue(*FString::Printf(TEXT("\"%s\" compiles"), Case.Condition), Rules.AddRule(EYarnPluralCategory::One, Case.Condition)))
+        {
+            continue;
+        }
+        const EYarnPluralCategory Expected = Case.bMatches ? EYarnPluralCategory::One : EYarnPluralCategory::Other;
+        TestEqual(*FString::Printf(TEXT("\"%s\" for %s"), Case.Condition, Case.Number),
+            FYarnCultureRules::GetCategoryName(Rules.Evaluate(Case.Number)),
+            FYarnCultureRules::GetCategoryName(Expected));
+    }
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnPluralRulesOrderTest, "YarnSpinner.PluralRules.CategoryOrder", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnPluralRulesOrderTest::RunTest(const FString& Parameters)
+{
+    // The first category whose condition holds wins, even when a later one holds too
+    FYarnPluralRules Rules;
+    Rules.AddRule(EYarnPluralCategory::Two, TEXT("n = 2"));
+    Rules.AddRule(EYarnPluralCategory::Few, TEXT("n = 2..4"));
+    TestEqual(TEXT("2"), FYarnCultureRules::GetCategoryName(Rules.Evaluate(TEXT("2"))), TEXT("two"));
+    TestEqual(TEXT("3"), FYarnCultureRules::GetCategoryName(Rules.Evaluate(TEXT("3"))), TEXT("few"));
+    TestEqual(TEXT("5"), FYarnCultureRules::GetCategoryName(Rules.Evaluate(TEXT("5"))), TEXT("other"));
+
+    // An empty condition adds nothing
+    FYarnPluralRules Empty;
+    TestTrue(TEXT("Empty condition"), Empty.AddRule(EYarnPluralCategory::Other, TEXT("")));
+    TestTrue(TEXT("Rules left empty"), Empty.IsEmpty());
+    TestEqual(TEXT("Empty rules"), FYarnCultureRules::GetCategoryName(Empty.Evaluate(TEXT("1"))), TEXT("other"));
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnPluralRulesInvalidTest, "YarnSpinner.PluralRules.InvalidRules", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnPluralRulesInvalidTest::RunTest(const FString& Parameters)
+{
+    const TCHAR* Invalid[] = {TEXT("n ="), TEXT("x = 1"), TEXT("n % 0 = 1"), TEXT("n = 1 and"), TEXT("n = 1 2"), TEXT("n < 1")};
+    AddExpectedError(TEXT("Couldn't compile the plural rule"), EAutomationExpectedErrorFlags::Contains, UE_ARRAY_COUNT(Invalid));
+
+    // A rule that doesn't parse leaves the rules as they were
+    FYarnPluralRules Rules;
+    Rules.AddRule(EYarnPluralCategory::One, TEXT("n = 1"));
+    for (const TCHAR* Condition : Invalid)
+    {
+        TestFalse(*FString::Printf(TEXT("\"%s\" compiles"), Condition), Rules.AddRule(EYarnPluralCategory::Few, Condition));
+    }
+    TestEqual(TEXT("1"), FYarnCultureRules::GetCategoryName(Rules.Evaluate(TEXT("1"))), TEXT("one"));
+    TestEqual(TEXT("2"), FYarnCultureRules::GetCategoryName(Rules.Evaluate(TEXT("2"))), TEXT("other"));
+    return true;
+}
+
+
+#endif
@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnTimerWheel.h"
+
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace
+{
+    // Ticks the wheel one tick at a time, so no rounding in the accumulator can move a deadline
+    void AdvanceTicks(FYarnTimerWheel& Wheel, int64 NumTicks)
+    {
+        for (int64 I = 0; I < NumTicks; I++)
+        {
+            Wheel.Advance(FYarnTimerWheel::TickSeconds);
+        }
+    }
+
+
+    // A delay the wheel rounds up to exactly NumTicks ticks
+    double TickDelay(int64 NumTicks)
+    {
+        return (NumTicks - 0.5) * FYarnTimerWheel::TickSeconds;
+    }
+
+
+    FYarnTimerHandle ScheduleNamed(FYarnTimerWheel& Wheel, double DelaySeconds, TArray<FString>& Fired, const TCHAR* Name, const UObject* Owner = nullptr)
+    {
+        return Wheel.Schedule(DelaySeconds, [&Fired, Name = FString(Name)]() { Fired.Add(Name); }, Owner);
+    }
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnTimerWheelCascadeTest, "YarnSpinner.TimerWheel.Cascade", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnTimerWheelCascadeTest::RunTest(const FString& Parameters)
+{
+    // One timer for each level: under 256 ticks, under 64 * 256, under 64 * 64 * 256, and beyond that.  Each must fire
+    // on exactly its own tick, however many times it was moved down a level on the way.
+    const int64 Delays[] = {100, 10000, 300000, 1200000};
+    const TCHAR* Names[] = {TEXT("level0"), TEXT("level1"), TEXT("level2"), TEXT("level3")};
+
+    FYarnTimerWheel Wheel;
+    TArray<FString> Fired;
+    for (int32 Index = 0; Index < UE_ARRAY_COUNT(Delays); Index++)
+    {
+        ScheduleNamed(Wheel, TickDelay(Delays[Index]), Fired, Names[Index]);
+    }
+
+    int64 Elapsed = 0;
+    for (int32 Index = 0; Index < UE_ARRAY_COUNT(Delays); Index++)
+    {
+        const int64 Due = Delays[Index];
+        AdvanceTicks(Wheel, Due - 1 - Elapsed);
+        TestEqual(*FString::Printf(TEXT("%s hasn't fired a tick early"), Names[Index]), Fired.Num(), Index);
+        AdvanceTicks(Wheel, 1);
+        Elapsed = Due;
+        TestEqual(*FString::Printf(TEXT("%s fired on its tick"), Names[Index]), Fired.Num(), Index + 1);
+        if (Fired.Num() == Index + 1)
+        {
+            TestEqual(TEXT("Timer that fired"), Fired.Last(), FString(Names[Index]));
+        }
+    }
+    TestEqual(TEXT("Timers left"), Wheel.Num(), 0);
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnTimerWheelOrderTest, "YarnSpinner.TimerWheel.SameDeadlineOrder", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnTimerWheelOrderTest::RunTest(const FString& Parameters)
+{
+    FYarnTimerWheel Wheel;
+    TArray<FString> Fired;
+
+    // Timers due on the same tick fire in the order they were scheduled
+    ScheduleNamed(Wheel, TickDelay(50), Fired, TEXT("a"));
+    ScheduleNamed(Wheel, TickDelay(50), Fired, TEXT("b"));
+    ScheduleNamed(Wheel, TickDelay(50), Fired, TEXT("c"));
+    AdvanceTicks(Wheel, 50);
+    TestEqual(TEXT("Timers scheduled together"), FString::Join(Fired, TEXT(",")), TEXT("a,b,c"));
+
+    // Including when the older ones were filed in a higher level and cascade down after a newer one went straight into
+    // the first level
+    Fired.Reset();
+    ScheduleNamed(Wheel, TickDelay(400), Fired, TEXT("far1"));
+    ScheduleNamed(Wheel, TickDelay(400), Fired, TEXT("far2"));
+    AdvanceTicks(Wheel, 200);
+    ScheduleNamed(Wheel, TickDelay(200), Fired, TEXT("near"));
+    AdvanceTicks(Wheel, 199);
+    TestEqual(TEXT("Nothing due yet"), Fired.Num(), 0);
+    AdvanceTicks(Wheel, 1);
+    TestEqual(TEXT("Timers filed in different levels"), FString::Join(Fired, TEXT(",")), TEXT("far1,far2,near"));
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnTimerWheelCancelTest, "YarnSpinner.TimerWheel.Cancel", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnTimerWheelCancelTest::RunTest(const FString& Parameters)
+{
+    FYarnTimerWheel Wheel;
+    TArray<FString> Fired;
+    const UObject* Owner = GetTransientPackage();
+
+    FYarnTimerHandle Near = ScheduleNamed(Wheel, TickDelay(50), Fired, TEXT("near"));
+    FYarnTimerHandle Far = ScheduleNamed(Wheel, TickDelay(10000), Fired, TEXT("far"));
+    ScheduleNamed(Wheel, TickDelay(50), Fired, TEXT("kept"));
+    ScheduleNamed(Wheel, TickDelay(50), Fired, TEXT("owned1"), Owner);
+    ScheduleNamed(Wheel, TickDelay(10000), Fired, TEXT("owned2"), Owner);
+    TestEqual(TEXT("Timers scheduled"), Wheel.Num(), 5);
+
+    TestTrue(TEXT("Cancelling a pending timer"), Wheel.Cancel(Near));
+    TestFalse(TEXT("Handle is invalidated"), Near.IsValid());
+    TestFalse(TEXT("Cancelling it again"), Wheel.Cancel(Near));
+    TestTrue(TEXT("Cancelling a timer in a higher level"), Wheel.Cancel(Far));
+    TestEqual(TEXT("Timers cancelled by owner"), Wheel.CancelAll(Owner), 2);
+    TestEqual(TEXT("Timers left"), Wheel.Num(), 1);
+
+    AdvanceTicks(Wheel, 10000);
+    TestEqual(TEXT("Only the timer left fired"), FString::Join(Fired, TEXT(",")), TEXT("kept"));
+
+    // A handle stays safe after its timer fires, even once the slot is reused
+    FYarnTimerHandle Done = ScheduleNamed(Wheel, TickDelay(10), Fired, TEXT("done"));
+    AdvanceTicks(Wheel, 10);
+    FYarnTimerHandle Reused = ScheduleNamed(Wheel, TickDelay(10), Fired, TEXT("reused"));
+    TestTrue(TEXT("Fired timer's remaining time"), Wheel.GetRemaining(Done) < 0);
+    TestFalse(TEXT("Cancelling a timer that fired"), Wheel.Cancel(Done));
+    TestTrue(TEXT("The new timer is still scheduled"), Wheel.GetRemaining(Reused) > 0);
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnTimerWheelDilationTest, "YarnSpinner.TimerWheel.TimeDilation", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnTimerWheelDilationTest::RunTest(const FString& Parameters)
+{
+    FYarnTimerWheel Wheel;
+    TArray<FString> Fired;
+
+    // Twice as fast: a 100 tick timer fires after 50 ticks of real time
+    Wheel.SetTimeDilation(2);
+    ScheduleNamed(Wheel, TickDelay(100), Fired, TEXT("fast"));
+    AdvanceTicks(Wheel, 49);
+    TestEqual(TEXT("Not due before half the time"), Fired.Num(), 0);
+    AdvanceTicks(Wheel, 1);
+    TestEqual(TEXT("Due after half the time"), Fired.Num(), 1);
+
+    // Half as fast: it takes 200
+    Wheel.SetTimeDilation(0.5);
+    ScheduleNamed(Wheel, TickDelay(100), Fired, TEXT("slow"));
+    AdvanceTicks(Wheel, 199);
+    TestEqual(TEXT("Not due before twice the time"), Fired.Num(), 1);
+    AdvanceTicks(Wheel, 1);
+    TestEqual(TEXT("Due after twice the time"), Fired.Num(), 2);
+
+    // Negative dilation is clamped rather than running time backwards
+    Wheel.SetTimeDilation(-1);
+    TestEqual(TEXT("Clamped dilation"), Wheel.GetTimeDilation(), 0.0);
+    ScheduleNamed(Wheel, TickDelay(10), Fired, TEXT("stopped"));
+    AdvanceTicks(Wheel, 1000);
+    TestEqual(TEXT("Nothing fires at zero dilation"), Fired.Num(), 2);
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnTimerWheelPauseTest, "YarnSpinner.TimerWheel.Pause", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnTimerWheelPauseTest::RunTest(const FString& Parameters)
+{
+    FYarnTimerWheel Wheel;
+    TArray<FString> Fired;
+    ScheduleNamed(Wheel, TickDelay(100), Fired, TEXT("timer"));
+    AdvanceTicks(Wheel, 99);
+
+    // The caller's pause holds whatever the world does, which is how the subsystem updates it every tick
+    Wheel.SetPaused(true);
+    Wheel.SetWorldPaused(false);
+    TestTrue(TEXT("Paused by the caller"), Wheel.IsPaused());
+    AdvanceTicks(Wheel, 1000);
+    TestEqual(TEXT("Nothing fires while the caller has it paused"), Fired.Num(), 0);
+
+    // And the world's pause holds when the caller unpauses
+    Wheel.SetWorldPaused(true);
+    Wheel.SetPaused(false);
+    TestTrue(TEXT("Paused by the world"), Wheel.IsPaused());
+    AdvanceTicks(Wheel, 1000);
+    TestEqual(TEXT("Nothing fires while the world is paused"), Fired.Num(), 0);
+
+    Wheel.SetWorldPaused(false);
+    TestFalse(TEXT("Unpaused"), Wheel.IsPaused());
+    AdvanceTicks(Wheel, 1);
+    TestEqual(TEXT("Fires on the tick it had left"), Fired.Num(), 1);
+    return true;
+}
+
+
+#endif
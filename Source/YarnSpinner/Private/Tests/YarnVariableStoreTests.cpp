@@ -0,0 +1,280 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnVariableStore.h"
+
+#include "Async/Async.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace
+{
+    constexpr int32 NumWriters = 8;
+    constexpr int32 NumReaders = 8;
+    constexpr int32 NumIterations = 20000;
+
+
+    FString WriterVariable(int32 Writer, int32 Slot)
+    {
+        return FString::Printf(TEXT("$writer_%d_%d"), Writer, Slot);
+    }
+
+
+    // Runs every job on its own thread, releases them together so they overlap as much as possible, and waits for all
+    // of them.  Returns the number of jobs that reported a failure.
+    int32 RunTogether(TArray<TFunction<bool()>> Jobs)
+    {
+        std::atomic<bool> bGo{false};
+        TArray<TFuture<bool>> Results;
+        for (TFunction<bool()>& Job : Jobs)
+        {
+            Results.Add(Async(EAsyncExecution::Thread, [&bGo, Job = MoveTemp(Job)]()
+            {
+                while (!bGo.load(std::memory_order_acquire))
+                {
+                    FPlatformProcess::Yield();
+                }
+                return Job();
+            }));
+        }
+        bGo.store(true, std::memory_order_release);
+
+        int32 Failures = 0;
+        for (TFuture<bool>& Result : Results)
+        {
+            Failures += Result.Get() ? 0 : 1;
+        }
+        return Failures;
+    }
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnVariableStoreConcurrentAccessTest, "YarnSpinner.VariableStore.ConcurrentReadsAndWrites", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnVariableStoreConcurrentAccessTest::RunTest(const FString& Parameters)
+{
+    // Each writer counts up its own variables while readers look them up; a reader must never see a counter go
+    // backwards, or a value of the wrong type
+    constexpr int32 SlotsPerWriter = 4;
+    FYarnVariableStore Store;
+
+    TArray<TFunction<bool()>> Jobs;
+    for (int32 Writer = 0; Writer < NumWriters; Writer++)
+    {
+        Jobs.Add([&Store, Writer]()
+        {
+            for (int32 I = 1; I <= NumIterations; I++)
+            {
+                Store.Set(WriterVariable(Writer, I % SlotsPerWriter), Yarn::Value(I));
+                // Writers also fight over a shared variable, and remove it, to exercise the same shard from every thread
+                if (I % 64 == 0)
+                {
+                    Store.Remove(TEXT("$shared"));
+                }
+                else
+                {
+                    Store.Set(TEXT("$shared"), Yarn::Value(Writer));
+                }
+            }
+            Store.Remove(TEXT("$shared"));
+            return true;
+        });
+    }
+    for (int32 Reader = 0; Reader < NumReaders; Reader++)
+    {
+        Jobs.Add([&Store, Reader]()
+        {
+            TArray<float> Highest;
+            Highest.Init(0, NumWriters * SlotsPerWriter);
+            uint64 LastVersion = 0;
+            for (int32 I = 0; I < NumIterations; I++)
+            {
+                const int32 Writer = (I + Reader) % NumWriters;
+                const int32 Slot = I % SlotsPerWriter;
+                const TOptional<Yarn::Value> Value = Store.Find(WriterVariable(Writer, Slot));
+                if (Value.IsSet())
+                {
+                    if (!Value->IsNumber() || Value->GetNumberValue() < Highest[Writer * SlotsPerWriter + Slot])
+                    {
+                        return false;
+                    }
+                    Highest[Writer * SlotsPerWriter + Slot] = Value->GetNumberValue();
+                }
+
+                const TOptional<Yarn::Value> Shared = Store.Find(TEXT("$shared"));
+                if (Shared.IsSet() && (!Shared->IsNumber() || Shared->GetNumberValue() < 0 || Shared->GetNumberValue() >= NumWriters))
+                {
+                    return false;
+                }
+
+                const uint64 Version = Store.GetVersion();
+                if (Version < LastVersion)
+                {
+                    return false;
+                }
+                LastVersion = Version;
+            }
+            return true;
+        });
+    }
+
+    TestEqual(TEXT("Threads that saw an inconsistent value"), RunTogether(MoveTemp(Jobs)), 0);
+
+    // Every writer's last write to each slot is the one that stuck
+    for (int32 Writer = 0; Writer < NumWriters; Writer++)
+    {
+        for (int32 Slot = 0; Slot < SlotsPerWriter; Slot++)
+        {
+            const int32 LastWrite = NumIterations - ((NumIterations - Slot) % SlotsPerWriter);
+            const TOptional<Yarn::Value> Value = Store.Find(WriterVariable(Writer, Slot));
+            TestTrue(*FString::Printf(TEXT("%s is set"), *WriterVariable(Writer, Slot)), Value.IsSet());
+            if (Value.IsSet())
+            {
+                TestEqual(*WriterVariable(Writer, Slot), Value->GetNumberValue(), static_cast<float>(LastWrite));
+            }
+        }
+    }
+    // Every writer removes the shared variable when it's done
+    TestFalse(TEXT("$shared was removed last"), Store.Contains(TEXT("$shared")));
+    TestEqual(TEXT("Variable count"), Store.Num(), NumWriters * SlotsPerWriter);
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnVariableStoreConsistentSnapshotTest, "YarnSpinner.VariableStore.ConsistentSnapshots", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnVariableStoreConsistentSnapshotTest::RunTest(const FString& Parameters)
+{
+    // Writers apply batches that keep $a, $b and $c equal; a snapshot that wasn't atomic with the batches could catch
+    // one part way through
+    constexpr int32 BatchesPerWriter = NumIterations / 10;
+    FYarnVariableStore Store;
+    Store.Set(TEXT("$a"), Yarn::Value(0));
+    Store.Set(TEXT("$b"), Yarn::Value(0));
+    Store.Set(TEXT("$c"), Yarn::Value(0));
+
+    TArray<TFunction<bool()>> Jobs;
+    for (int32 Writer = 0; Writer < NumWriters; Writer++)
+    {
+        Jobs.Add([&Store, Writer]()
+        {
+            TArray<TPair<FString, TOptional<Yarn::Value>>> Batch;
+            for (int32 I = 0; I < BatchesPerWriter; I++)
+            {
+                const Yarn::Value Value(Writer * BatchesPerWriter + I);
+                Batch.Reset();
+                Batch.Emplace(TEXT("$a"), Value);
+                Batch.Emplace(TEXT("$b"), Value);
+                Batch.Emplace(TEXT("$c"), Value);
+                Store.Apply(Batch);
+            }
+            return true;
+        });
+    }
+    for (int32 Reader = 0; Reader < NumReaders; Reader++)
+    {
+        Jobs.Add([&Store]()
+        {
+            uint64 LastVersion = 0;
+            for (int32 I = 0; I < BatchesPerWriter; I++)
+            {
+                const FYarnVariableSnapshotRef Snapshot = Store.Snapshot();
+                const Yarn::Value* A = Snapshot->Values.Find(TEXT("$a"));
+                const Yarn::Value* B = Snapshot->Values.Find(TEXT("$b"));
+                const Yarn::Value* C = Snapshot->Values.Find(TEXT("$c"));
+                if (!A || !B || !C || A->GetNumberValue() != B->GetNumberValue() || B->GetNumberValue() != C->GetNumberValue())
+                {
+                    return false;
+                }
+                if (Snapshot->Version < LastVersion)
+                {
+                    return false;
+                }
+                LastVersion = Snapshot->Version;
+            }
+            return true;
+        });
+    }
+
+    TestEqual(TEXT("Snapshots that saw half a batch"), RunTogether(MoveTemp(Jobs)), 0);
+    TestTrue(TEXT("Version counts every batch"), Store.GetVersion() >= static_cast<uint64>(NumWriters * BatchesPerWriter));
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnVariableSessionConcurrentTest, "YarnSpinner.VariableStore.SessionsOnWorkerThreads", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnVariableSessionConcurrentTest::RunTest(const FString& Parameters)
+{
+    // Sessions on worker threads read from their snapshot and buffer their writes while other threads write to the
+    // store directly; nothing a session writes may reach the store before it's committed on this thread
+    constexpr int32 NumSessions = NumWriters;
+    // A multiple of the 16 variables each session writes, so the last write to each is in the last 16
+    constexpr int32 WritesPerSession = 1024;
+    FYarnVariableStore Store;
+    Store.Set(TEXT("$seed"), Yarn::Value(42));
+
+    TArray<TUniquePtr<FYarnVariableSession>> Sessions;
+    for (int32 Index = 0; Index < NumSessions; Index++)
+    {
+        Sessions.Add(MakeUnique<FYarnVariableSession>(Store));
+    }
+
+    TArray<TFunction<bool()>> Jobs;
+    for (int32 Index = 0; Index < NumSessions; Index++)
+    {
+        Jobs.Add([Session = Sessions[Index].Get(), Index]()
+        {
+            for (int32 I = 0; I < WritesPerSession; I++)
+            {
+                const std::string Name = TCHAR_TO_UTF8(*FString::Printf(TEXT("$session_%d_%d"), Index, I % 16));
+                Session->SetValue(Name, static_cast<float>(I));
+                // Reads see the session's own writes, and the snapshot it started with
+                if (Session->GetValue(Name).GetNumberValue() != static_cast<float>(I) || Session->GetValue("$seed").GetNumberValue() != 42.0f)
+                {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+    for (int32 Writer = 0; Writer < NumWriters; Writer++)
+    {
+        Jobs.Add([&Store, Writer]()
+        {
+            for (int32 I = 0; I < NumIterations; I++)
+            {
+                Store.Set(WriterVariable(Writer, I % 8), Yarn::Value(I));
+                if (Store.Contains(TEXT("$session_0_0")))
+                {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+
+    TestEqual(TEXT("Threads that saw uncommitted or inconsistent values"), RunTogether(MoveTemp(Jobs)), 0);
+
+    for (int32 Index = 0; Index < NumSessions; Index++)
+    {
+        TestTrue(TEXT("Session has pending changes"), Sessions[Index]->HasPendingChanges());
+        Sessions[Index]->Commit();
+        TestFalse(TEXT("Session is empty after committing"), Sessions[Index]->HasPendingChanges());
+    }
+    for (int32 Index = 0; Index < NumSessions; Index++)
+    {
+        for (int32 Slot = 0; Slot < 16; Slot++)
+        {
+            const FString Name = FString::Printf(TEXT("$session_%d_%d"), Index, Slot);
+            const TOptional<Yarn::Value> Value = Store.Find(Name);
+            TestTrue(*FString::Printf(TEXT("%s was committed"), *Name), Value.IsSet() && Value->GetNumberValue() == static_cast<float>(WritesPerSession - 16 + Slot));
+        }
+    }
+    return true;
+}
+
+
+#endif
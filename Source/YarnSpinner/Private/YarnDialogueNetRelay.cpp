@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnDialogueNetRelay.h"
+
+#include "DialogueRunner.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/YSLogging.h"
+
+
+UYarnDialogueNetRelay::UYarnDialogueNetRelay()
+{
+    SetIsReplicatedByDefault(true);
+}
+
+
+void UYarnDialogueNetRelay::ServerContinueDialogue_Implementation(ADialogueRunner* Runner, int32 Sequence)
+{
+    if (!IsValid(Runner) || !Runner->bServerAuthoritative)
+    {
+        YS_WARN("Ignoring continue request from %s for a dialogue runner that isn't server-authoritative", *GetNameSafe(GetOwner()))
+        return;
+    }
+    Runner->HandleClientContinue(Sequence);
+}
+
+
+void UYarnDialogueNetRelay::ServerSelectOption_Implementation(ADialogueRunner* Runner, int32 Sequence, int32 OptionID)
+{
+    if (!IsValid(Runner) || !Runner->bServerAuthoritative)
+    {
+        YS_WARN("Ignoring option selection from %s for a dialogue runner that isn't server-authoritative", *GetNameSafe(GetOwner()))
+        return;
+    }
+    Runner->HandleClientSelectOption(Sequence, OptionID);
+}
+
+
+UYarnDialogueNetRelay* UYarnDialogueNetRelay::FindLocal(const UWorld* World)
+{
+    const APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+    return PlayerController ? PlayerController->FindComponentByClass<UYarnDialogueNetRelay>() : nullptr;
+}
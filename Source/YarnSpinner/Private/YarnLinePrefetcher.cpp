@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnLinePrefetcher.h"
+
+#include "YarnProject.h"
+#include "Algo/AllOf.h"
+#include "Misc/YSLogging.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "YarnSpinnerCore/yarn_spinner.pb.h"
+THIRD_PARTY_INCLUDES_END
+
+
+namespace
+{
+    // A place in the program to walk forward from
+    struct FWalkState
+    {
+        const Yarn::Node* Node = nullptr;
+        int32 ProgramCounter = 0;
+        int32 Lines = 0;
+        int32 Jumps = 0;
+    };
+
+    // Stops a pathological program from making a single update expensive
+    constexpr int32 MaxWalkStates = 256;
+
+    int32 FindLabel(const Yarn::Node& Node, const std::string& Label)
+    {
+        const auto Found = Node.labels().find(Label);
+        return Found != Node.labels().end() ? Found->second : INDEX_NONE;
+    }
+}
+
+
+FYarnLinePrefetcher::FYarnLinePrefetcher(const UYarnProject* InProject, const Yarn::Program& InProgram)
+    : Project(InProject)
+    , Program(InProgram)
+{
+}
+
+
+FYarnLinePrefetcher::~FYarnLinePrefetcher()
+{
+    ReleaseAll();
+}
+
+
+void FYarnLinePrefetcher::Update(const char* NodeName, int32 ProgramCounter, TArrayView<const std::string> OptionDestinations, int32 KeepLine)
+{
+    const UYarnProject* YarnProject = Project.Get();
+    const auto Node = Program.nodes().find(NodeName);
+    if (!YarnProject || Node == Program.nodes().end())
+    {
+        return;
+    }
+
+    TSet<int32> Window;
+    CollectLines(Node->second, ProgramCounter, OptionDestinations, Window);
+    if (KeepLine != INDEX_NONE && Handles.Contains(KeepLine))
+    {
+        Window.Add(KeepLine);
+    }
+
+    for (auto It = Handles.CreateIterator(); It; ++It)
+    {
+        if (!Window.Contains(It.Key()))
+        {
+            Release(It.Value());
+            It.RemoveCurrent();
+            Stats.LinesReleased++;
+        }
+    }
+
+    for (const int32 LineIndex : Window)
+    {
+        if (Handles.Contains(LineIndex))
+        {
+            continue;
+        }
+
+        // Assets that are already loaded are requested too, so they're held until the line is out of reach
+        TArray<FSoftObjectPath> Paths;
+        for (const TSoftObjectPtr<UObject>& Asset : YarnProject->FindLineAssets(LineIndex))
+        {
+            Paths.Add(Asset.ToSoftObjectPath());
+        }
+        Handles.Add(LineIndex, StreamableManager.RequestAsyncLoad(MoveTemp(Paths), FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority));
+        Stats.LinesRequested++;
+    }
+
+    Stats.LinesInWindow = Handles.Num();
+    YS_LOG_FUNC("Prefetching assets for %d lines ahead of %s", Handles.Num(), UTF8_TO_TCHAR(NodeName))
+}
+
+
+void FYarnLinePrefetcher::RecordLine(int32 LineIndex)
+{
+    const UYarnProject* YarnProject = Project.Get();
+    if (!YarnProject)
+    {
+        return;
+    }
+
+    const TArray<TSoftObjectPtr<UObject>>& Assets = YarnProject->FindLineAssets(LineIndex);
+    if (Assets.Num() == 0)
+    {
+        return;
+    }
+
+    const bool bResident = Algo::AllOf(Assets, [](const TSoftObjectPtr<UObject>& Asset) { return Asset.Get() != nullptr; });
+    (bResident ? Stats.Hits : Stats.Misses)++;
+}
+
+
+void FYarnLinePrefetcher::ReleaseAll()
+{
+    for (TPair<int32, TSharedPtr<FStreamableHandle>>& Entry : Handles)
+    {
+        Release(Entry.Value);
+        Stats.LinesReleased++;
+    }
+    Handles.Reset();
+    Stats.LinesInWindow = 0;
+}
+
+
+FYarnPrefetchStats FYarnLinePrefetcher::GetStats() const
+{
+    FYarnPrefetchStats Result = Stats;
+    Result.AssetsResident = 0;
+    Result.ResidentBytes = 0;
+
+    TSet<UObject*> Counted;
+    TArray<UObject*> Loaded;
+    for (const TPair<int32, TSharedPtr<FStreamableHandle>>& Entry : Handles)
+    {
+        if (!Entry.Value.IsValid())
+        {
+            continue;
+        }
+        Loaded.Reset();
+        Entry.Value->GetLoadedAssets(Loaded);
+        for (UObject* Asset : Loaded)
+        {
+            bool bAlreadyCounted = false;
+            Counted.Add(Asset, &bAlreadyCounted);
+            if (Asset && !bAlreadyCounted)
+            {
+                Result.AssetsResident++;
+                Result.ResidentBytes += Asset->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+            }
+        }
+    }
+    return Result;
+}
+
+
+void FYarnLinePrefetcher::CollectLines(const Yarn::Node& StartNode, int32 ProgramCounter, TArrayView<const std::string> OptionDestinations, TSet<int32>& OutLines) const
+{
+    const UYarnProject* YarnProject = Project.Get();
+
+    TArray<FWalkState, TInlineAllocator<16>> Queue;
+    TSet<TPair<const Yarn::Node*, int32>> Visited;
+    auto Enqueue = [&Queue, &Visited](const Yarn::Node* Node, int32 Start, int32 Lines, int32 Jumps)
+    {
+        bool bAlreadyVisited = false;
+        if (Start != INDEX_NONE && Queue.Num() < MaxWalkStates)
+        {
+            Visited.Add(TPair<const Yarn::Node*, int32>(Node, Start), &bAlreadyVisited);
+            if (!bAlreadyVisited)
+            {
+                Queue.Add({Node, Start, Lines, Jumps});
+            }
+        }
+    };
+    auto AddLine = [YarnProject, &OutLines](const std::string& LineID)
+    {
+        const FUTF8ToTCHAR Converted(LineID.c_str());
+        const int32 LineIndex = YarnProject->LineTable.Find(FStringView(Converted.Get(), Converted.Length()));
+        if (YarnProject->FindLineAssets(LineIndex).Num() > 0)
+        {
+            OutLines.Add(LineIndex);
+        }
+    };
+
+    Enqueue(&StartNode, ProgramCounter, 0, 0);
+    for (const std::string& Destination : OptionDestinations)
+    {
+        Enqueue(&StartNode, FindLabel(StartNode, Destination), 1, 0);
+    }
+
+    // Breadth first, so the nearest lines are found before the walk runs out of states
+    for (int32 QueueIndex = 0; QueueIndex < Queue.Num(); QueueIndex++)
+    {
+        FWalkState State = Queue[QueueIndex];
+        const std::string* PushedString = nullptr;
+        bool bWalking = State.Lines < MaxLines;
+        while (bWalking && State.ProgramCounter >= 0 && State.ProgramCounter < State.Node->instructions_size())
+        {
+            const Yarn::Instruction& Instruction = State.Node->instructions(State.ProgramCounter++);
+            const std::string* LastPushedString = PushedString;
+            PushedString = nullptr;
+
+            switch (Instruction.opcode())
+            {
+            case Yarn::Instruction_OpCode_RUN_LINE:
+                AddLine(Instruction.operands(0).string_value());
+                bWalking = ++State.Lines < MaxLines;
+                break;
+            case Yarn::Instruction_OpCode_ADD_OPTION:
+                AddLine(Instruction.operands(0).string_value());
+                Enqueue(State.Node, FindLabel(*State.Node, Instruction.operands(1).string_value()), State.Lines + 1, State.Jumps);
+                break;
+            case Yarn::Instruction_OpCode_JUMP_IF_FALSE:
+                Enqueue(State.Node, FindLabel(*State.Node, Instruction.operands(0).string_value()), State.Lines, State.Jumps);
+                break;
+            case Yarn::Instruction_OpCode_JUMP_TO:
+                // Carries on from the label as a new state, so loops end up visited
+                Enqueue(State.Node, FindLabel(*State.Node, Instruction.operands(0).string_value()), State.Lines, State.Jumps);
+                bWalking = false;
+                break;
+            case Yarn::Instruction_OpCode_PUSH_STRING:
+                PushedString = &Instruction.operands(0).string_value();
+                break;
+            case Yarn::Instruction_OpCode_RUN_NODE:
+                if (LastPushedString && State.Jumps < MaxNodeJumps)
+                {
+                    const auto Target = Program.nodes().find(*LastPushedString);
+                    if (Target != Program.nodes().end())
+                    {
+                        Enqueue(&Target->second, 0, State.Lines, State.Jumps + 1);
+                    }
+                }
+                bWalking = false;
+                break;
+            case Yarn::Instruction_OpCode_SHOW_OPTIONS:
+            case Yarn::Instruction_OpCode_JUMP:
+            case Yarn::Instruction_OpCode_STOP:
+                // Options were queued as they were added, and a jump to a label from the stack can't be followed
+                bWalking = false;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+
+void FYarnLinePrefetcher::Release(TSharedPtr<FStreamableHandle>& Handle)
+{
+    if (!Handle.IsValid())
+    {
+        return;
+    }
+    if (Handle->IsLoadingInProgress())
+    {
+        Handle->CancelHandle();
+    }
+    else
+    {
+        Handle->ReleaseHandle();
+    }
+    Handle.Reset();
+}
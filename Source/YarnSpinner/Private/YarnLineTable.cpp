@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnLineTable.h"
+
+
+void FYarnLineTable::Build(TArray<TPair<FString, FString>>&& Lines, const FYarnCultureRules* Rules)
+{
+    Lines.Sort([](const TPair<FString, FString>& A, const TPair<FString, FString>& B)
+    {
+        return A.Key.Compare(B.Key, ESearchCase::IgnoreCase) < 0;
+    });
+
+    Reset();
+
+    TArray<FString> LineTexts;
+    LineTexts.Reserve(Lines.Num());
+    for (TPair<FString, FString>& Line : Lines)
+    {
+        LineTexts.Add(MoveTemp(Line.Value));
+    }
+    Markup.Build(LineTexts, Rules);
+
+    int32 IDLength = 0;
+    int32 TextLength = 0;
+    for (int32 Index = 0; Index < Lines.Num(); Index++)
+    {
+        IDLength += Lines[Index].Key.Len();
+        TextLength += LineTexts[Index].Len();
+    }
+
+    IDs.Reserve(IDLength);
+    Text.Reserve(TextLength);
+    IDOffsets.Reserve(Lines.Num() + 1);
+    TextOffsets.Reserve(Lines.Num() + 1);
+
+    for (int32 Index = 0; Index < Lines.Num(); Index++)
+    {
+        IDOffsets.Add(IDs.Len());
+        IDs += Lines[Index].Key;
+        TextOffsets.Add(Text.Len());
+        Text += LineTexts[Index];
+    }
+    IDOffsets.Add(IDs.Len());
+    TextOffsets.Add(Text.Len());
+
+    BuildHash();
+}
+
+
+void FYarnLineTable::Reset()
+{
+    IDs.Reset();
+    IDOffsets.Reset();
+    Text.Reset();
+    TextOffsets.Reset();
+    Markup.Reset();
+    Hash.Reset();
+}
+
+
+void FYarnLineTable::BuildHash()
+{
+    if (Hash.Num() == Num())
+    {
+        return;
+    }
+
+    TArray<FStringView> Keys;
+    Keys.Reserve(Num());
+    for (int32 Index = 0; Index < Num(); Index++)
+    {
+        Keys.Add(GetID(Index));
+    }
+    Hash.Build(Keys, true);
+}
+
+
+int32 FYarnLineTable::Find(FStringView LineID) const
+{
+    if (Hash.IsEmpty())
+    {
+        return BinarySearch(LineID);
+    }
+
+    const int32 Index = Hash.Find(LineID);
+    return GetID(Index).Equals(LineID, ESearchCase::IgnoreCase) ? Index : INDEX_NONE;
+}
+
+
+int32 FYarnLineTable::BinarySearch(FStringView LineID) const
+{
+    int32 Low = 0;
+    int32 High = Num() - 1;
+    while (Low <= High)
+    {
+        const int32 Middle = Low + (High - Low) / 2;
+        const int32 Comparison = GetID(Middle).Compare(LineID, ESearchCase::IgnoreCase);
+        if (Comparison == 0)
+        {
+            return Middle;
+        }
+        if (Comparison < 0)
+        {
+            Low = Middle + 1;
+        }
+        else
+        {
+            High = Middle - 1;
+        }
+    }
+    return INDEX_NONE;
+}
+
+
+int32 FYarnLineTable::Find(FName LineID) const
+{
+    TStringBuilder<64> Builder;
+    LineID.AppendString(Builder);
+    return Find(Builder.ToView());
+}
+
+
+FStringView FYarnLineTable::GetID(int32 Index) const
+{
+    if (!IsValidIndex(Index))
+    {
+        return FStringView();
+    }
+    return FStringView(*IDs + IDOffsets[Index], IDOffsets[Index + 1] - IDOffsets[Index]);
+}
+
+
+FStringView FYarnLineTable::GetText(int32 Index) const
+{
+    if (!IsValidIndex(Index) || !HasText())
+    {
+        return FStringView();
+    }
+    return FStringView(*Text + TextOffsets[Index], TextOffsets[Index + 1] - TextOffsets[Index]);
+}
+
+
+void FYarnLineTable::StripText()
+{
+    Text.Empty();
+    TextOffsets.Empty();
+    Markup.Reset();
+}
+
+
+SIZE_T FYarnLineTable::GetAllocatedSize() const
+{
+    return IDs.GetAllocatedSize() + IDOffsets.GetAllocatedSize() + Text.GetAllocatedSize() + TextOffsets.GetAllocatedSize() + Markup.GetAllocatedSize() + Hash.GetAllocatedSize();
+}
@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnLocalizedStrings.h"
+
+
+FStringView UYarnLocalizedStrings::GetLine(int32 LineIndex) const
+{
+    if (LineIndex < 0 || LineIndex >= Num())
+    {
+        return FStringView();
+    }
+    return FStringView(*Text + Offsets[LineIndex], Offsets[LineIndex + 1] - Offsets[LineIndex]);
+}
+
+
+bool UYarnLocalizedStrings::SetLines(FName InCulture, TArrayView<const FString> Lines, const FYarnCultureRules* Rules)
+{
+    TArray<FString> LineTexts(Lines);
+    FYarnMarkupTable NewMarkup;
+    NewMarkup.Build(LineTexts, Rules);
+
+    int32 TotalLength = 0;
+    for (const FString& Line : LineTexts)
+    {
+        TotalLength += Line.Len();
+    }
+
+    FString NewText;
+    NewText.Reserve(TotalLength);
+    TArray<int32> NewOffsets;
+    NewOffsets.Reserve(Lines.Num() + 1);
+    for (const FString& Line : LineTexts)
+    {
+        NewOffsets.Add(NewText.Len());
+        NewText += Line;
+    }
+    NewOffsets.Add(NewText.Len());
+
+    if (Culture == InCulture && Offsets == NewOffsets && Text.Equals(NewText, ESearchCase::CaseSensitive) && Markup == NewMarkup)
+    {
+        return false;
+    }
+
+    Culture = InCulture;
+    Text = MoveTemp(NewText);
+    Offsets = MoveTemp(NewOffsets);
+    Markup = MoveTemp(NewMarkup);
+    return true;
+}
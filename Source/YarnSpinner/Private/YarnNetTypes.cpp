@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnNetTypes.h"
+
+
+namespace
+{
+    // Packed ints can't hold INDEX_NONE, so indices are sent shifted up by one
+    void SerializeIndex(FArchive& Ar, int32& Index)
+    {
+        uint32 Packed = Index + 1;
+        Ar.SerializeIntPacked(Packed);
+        Index = static_cast<int32>(Packed) - 1;
+    }
+
+
+    // Lines never have anywhere near this many substitutions; anything above it is a corrupt or hostile packet
+    constexpr uint32 MaxSubstitutions = 64;
+
+
+    void SerializeBool(FArchive& Ar, bool& bValue)
+    {
+        uint8 Bit = bValue ? 1 : 0;
+        Ar.SerializeBits(&Bit, 1);
+        bValue = Bit != 0;
+    }
+
+
+    void SerializeStrings(FArchive& Ar, TArray<FString>& Strings)
+    {
+        uint32 Count = Strings.Num();
+        Ar.SerializeIntPacked(Count);
+        if (Ar.IsLoading())
+        {
+            if (Count > MaxSubstitutions)
+            {
+                Ar.SetError();
+                return;
+            }
+            Strings.SetNum(Count);
+        }
+        for (FString& String : Strings)
+        {
+            Ar << String;
+        }
+    }
+}
+
+
+FYarnNetValue::FYarnNetValue(const Yarn::Value& Value)
+    : Type(Value.GetType())
+{
+    switch (Type)
+    {
+    case Yarn::Value::STRING:
+        String = UTF8_TO_TCHAR(Value.stringValue.c_str());
+        break;
+    case Yarn::Value::NUMBER:
+        Number = Value.number;
+        break;
+    case Yarn::Value::BOOL:
+        bBoolean = Value.boolean;
+        break;
+    }
+}
+
+
+Yarn::Value FYarnNetValue::ToValue() const
+{
+    switch (Type)
+    {
+    case Yarn::Value::STRING:
+        return Yarn::Value(std::string(TCHAR_TO_UTF8(*String)));
+    case Yarn::Value::BOOL:
+        return Yarn::Value(bBoolean);
+    default:
+        return Yarn::Value(Number);
+    }
+}
+
+
+bool FYarnNetValue::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    // Tag: 0 string, 1 float, 2 false, 3 true, 4 whole number (packed)
+    uint8 Tag = 0;
+    uint32 Whole = 0;
+    if (Ar.IsSaving())
+    {
+        switch (Type)
+        {
+        case Yarn::Value::STRING:
+            Tag = 0;
+            break;
+        case Yarn::Value::BOOL:
+            Tag = bBoolean ? 3 : 2;
+            break;
+        case Yarn::Value::NUMBER:
+            if (Number >= 0 && Number <= MAX_uint32 && FMath::TruncToDouble(Number) == Number)
+            {
+                Tag = 4;
+                Whole = static_cast<uint32>(Number);
+            }
+            else
+            {
+                Tag = 1;
+            }
+            break;
+        }
+    }
+
+    Ar.SerializeBits(&Tag, 3);
+    switch (Tag)
+    {
+    case 0:
+        Type = Yarn::Value::STRING;
+        Ar << String;
+        break;
+    case 1:
+        Type = Yarn::Value::NUMBER;
+        Ar << Number;
+        break;
+    case 2:
+    case 3:
+        Type = Yarn::Value::BOOL;
+        bBoolean = Tag == 3;
+        break;
+    case 4:
+        Type = Yarn::Value::NUMBER;
+        Ar.SerializeIntPacked(Whole);
+        Number = Whole;
+        break;
+    default:
+        Ar.SetError();
+        break;
+    }
+
+    bOutSuccess = !Ar.IsError();
+    return true;
+}
+
+
+bool FYarnNetLine::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    SerializeIndex(Ar, LineIndex);
+    SerializeStrings(Ar, Substitutions);
+    bOutSuccess = !Ar.IsError();
+    return true;
+}
+
+
+bool FYarnNetOption::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    Line.NetSerialize(Ar, Map, bOutSuccess);
+    uint32 PackedID = OptionID;
+    Ar.SerializeIntPacked(PackedID);
+    OptionID = PackedID;
+    SerializeBool(Ar, bIsAvailable);
+    bOutSuccess = !Ar.IsError();
+    return true;
+}
+
+
+bool FYarnNetVariableDelta::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    SerializeIndex(Ar, VariableIndex);
+    if (VariableIndex == INDEX_NONE)
+    {
+        Ar << Name;
+    }
+    SerializeBool(Ar, bCleared);
+    if (!bCleared)
+    {
+        Value.NetSerialize(Ar, Map, bOutSuccess);
+    }
+    bOutSuccess = !Ar.IsError();
+    return true;
+}
@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnNodeIndex.h"
+
+#include "Algo/BinarySearch.h"
+#include "Misc/YSLogging.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "YarnSpinnerCore/yarn_spinner.pb.h"
+THIRD_PARTY_INCLUDES_END
+
+
+namespace
+{
+    // TMap's FString keys ignore case, but tags and header values don't
+    struct FCaseSensitiveKeyFuncs : TDefaultMapKeyFuncs<FString, TArray<int32>, false>
+    {
+        static bool Matches(const FString& A, const FString& B) { return A.Equals(B, ESearchCase::CaseSensitive); }
+        static uint32 GetKeyHash(const FString& Key) { return FCrc::StrCrc32(*Key); }
+    };
+
+
+    FString MakeTagTerm(FStringView Tag)
+    {
+        FString Term(TEXT("#"));
+        Term.Append(Tag.GetData(), Tag.Len());
+        return Term;
+    }
+
+
+    FString MakeHeaderTerm(FStringView Key, FStringView Value)
+    {
+        FString Term;
+        Term.Reserve(Key.Len() + Value.Len() + 1);
+        Term.Append(Key.GetData(), Key.Len());
+        Term.AppendChar(TEXT(':'));
+        Term.Append(Value.GetData(), Value.Len());
+        return Term;
+    }
+}
+
+
+void FYarnNodeIndex::Build(const Yarn::Program& Program, const TArray<FString>& NodeNames)
+{
+    Reset();
+    NodeCount = NodeNames.Num();
+
+    // Nodes are visited in index order, so each posting list comes out sorted
+    TMap<FString, TArray<int32>, FDefaultSetAllocator, FCaseSensitiveKeyFuncs> Lists;
+    auto AddTerm = [&Lists](FString&& Term, int32 NodeIndex)
+    {
+        TArray<int32>& List = Lists.FindOrAdd(MoveTemp(Term));
+        if (List.Num() == 0 || List.Last() != NodeIndex)
+        {
+            List.Add(NodeIndex);
+        }
+    };
+
+    for (int32 NodeIndex = 0; NodeIndex < NodeNames.Num(); NodeIndex++)
+    {
+        const auto Found = Program.nodes().find(TCHAR_TO_UTF8(*NodeNames[NodeIndex]));
+        if (Found == Program.nodes().end())
+        {
+            continue;
+        }
+        const Yarn::Node& Node = Found->second;
+
+        for (const std::string& Tag : Node.tags())
+        {
+            AddTerm(MakeTagTerm(FString(UTF8_TO_TCHAR(Tag.c_str()))), NodeIndex);
+        }
+        for (const Yarn::Header& Header : Node.headers())
+        {
+            const FString Key = UTF8_TO_TCHAR(Header.key().c_str());
+            FString Value = UTF8_TO_TCHAR(Header.value().c_str());
+            Value.TrimStartAndEndInline();
+            if (Key.Equals(TEXT("tags"), ESearchCase::CaseSensitive))
+            {
+                TArray<FString> Tags;
+                Value.ParseIntoArrayWS(Tags);
+                for (const FString& Tag : Tags)
+                {
+                    AddTerm(MakeTagTerm(Tag), NodeIndex);
+                }
+            }
+            AddTerm(MakeHeaderTerm(Key, Value), NodeIndex);
+        }
+    }
+
+    // Case-sensitive, to match the fallback search in FindTerm
+    Lists.KeySort([](const FString& A, const FString& B) { return FCString::Strcmp(*A, *B) < 0; });
+    Terms.Reserve(Lists.Num());
+    PostingOffsets.Reserve(Lists.Num() + 1);
+    for (TPair<FString, TArray<int32>>& List : Lists)
+    {
+        Terms.Add(MoveTemp(List.Key));
+        PostingOffsets.Add(Postings.Num());
+        Postings.Append(List.Value);
+    }
+    PostingOffsets.Add(Postings.Num());
+
+    const TArray<FStringView> Keys(Terms);
+    if (!TermHash.Build(Keys, false))
+    {
+        YS_WARN("Couldn't build the node tag and header hash; queries will search the terms instead")
+    }
+}
+
+
+void FYarnNodeIndex::Reset()
+{
+    Terms.Reset();
+    TermHash.Reset();
+    PostingOffsets.Reset();
+    Postings.Reset();
+    NodeCount = 0;
+}
+
+
+void FYarnNodeIndex::FindNodes(TArrayView<const FStringView> Tags, TArrayView<const TPair<FStringView, FStringView>> Headers, TArray<int32>& OutNodeIndices) const
+{
+    TArray<TArrayView<const int32>, TInlineAllocator<8>> Lists;
+    for (const FStringView Tag : Tags)
+    {
+        Lists.Add(FindTag(Tag));
+    }
+    for (const TPair<FStringView, FStringView>& Header : Headers)
+    {
+        Lists.Add(FindHeader(Header.Key, Header.Value));
+    }
+
+    if (Lists.Num() == 0)
+    {
+        for (int32 NodeIndex = 0; NodeIndex < NodeCount; NodeIndex++)
+        {
+            OutNodeIndices.Add(NodeIndex);
+        }
+        return;
+    }
+
+    // Shortest first: nothing can be in the result that isn't in it, and each probe into a longer list is a binary search
+    Lists.Sort([](const TArrayView<const int32>& A, const TArrayView<const int32>& B) { return A.Num() < B.Num(); });
+    for (const int32 NodeIndex : Lists[0])
+    {
+        bool bInAll = true;
+        for (int32 ListIndex = 1; ListIndex < Lists.Num() && bInAll; ListIndex++)
+        {
+            bInAll = Algo::BinarySearch(Lists[ListIndex], NodeIndex) != INDEX_NONE;
+        }
+        if (bInAll)
+        {
+            OutNodeIndices.Add(NodeIndex);
+        }
+    }
+}
+
+
+TArrayView<const int32> FYarnNodeIndex::FindTag(FStringView Tag) const
+{
+    TStringBuilder<128> Term;
+    Term << TEXT('#') << Tag;
+    return FindTerm(Term.ToView());
+}
+
+
+TArrayView<const int32> FYarnNodeIndex::FindHeader(FStringView Key, FStringView Value) const
+{
+    TStringBuilder<128> Term;
+    Term << Key << TEXT(':') << Value.TrimStartAndEnd();
+    return FindTerm(Term.ToView());
+}
+
+
+SIZE_T FYarnNodeIndex::GetAllocatedSize() const
+{
+    SIZE_T Size = Terms.GetAllocatedSize() + TermHash.GetAllocatedSize() + PostingOffsets.GetAllocatedSize() + Postings.GetAllocatedSize();
+    for (const FString& Term : Terms)
+    {
+        Size += Term.GetAllocatedSize();
+    }
+    return Size;
+}
+
+
+TArrayView<const int32> FYarnNodeIndex::FindTerm(FStringView Term) const
+{
+    int32 TermIndex;
+    if (!TermHash.IsEmpty())
+    {
+        TermIndex = TermHash.Find(Term);
+        if (!Terms.IsValidIndex(TermIndex) || !Term.Equals(Terms[TermIndex]))
+        {
+            return {};
+        }
+    }
+    else
+    {
+        TermIndex = Algo::BinarySearchBy(Terms, Term, [](const FString& Candidate) { return FStringView(Candidate); }, [](FStringView A, FStringView B) { return A.Compare(B) < 0; });
+        if (TermIndex == INDEX_NONE)
+        {
+            return {};
+        }
+    }
+    return TArrayView<const int32>(Postings).Slice(PostingOffsets[TermIndex], PostingOffsets[TermIndex + 1] - PostingOffsets[TermIndex]);
+}
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnPerfectHash.h"
+
+#include "Misc/YSLogging.h"
+
+
+bool FYarnPerfectHash::Build(TArrayView<const FStringView> Keys, bool bInIgnoreCase)
+{
+    Reset();
+    bIgnoreCase = bInIgnoreCase;
+
+    const int32 NumKeys = Keys.Num();
+    if (NumKeys == 0)
+    {
+        return true;
+    }
+
+    TArray<TArray<int32, TInlineAllocator<4>>> Buckets;
+    Buckets.SetNum(NumKeys);
+    for (int32 KeyIndex = 0; KeyIndex < NumKeys; KeyIndex++)
+    {
+        Buckets[Hash(Keys[KeyIndex], 0, bIgnoreCase) % NumKeys].Add(KeyIndex);
+    }
+
+    // Place the biggest buckets first, while there's the most room
+    TArray<int32> BucketOrder;
+    BucketOrder.Reserve(NumKeys);
+    for (int32 Bucket = 0; Bucket < NumKeys; Bucket++)
+    {
+        if (Buckets[Bucket].Num() > 0)
+        {
+            BucketOrder.Add(Bucket);
+        }
+    }
+    BucketOrder.StableSort([&Buckets](int32 A, int32 B) { return Buckets[A].Num() > Buckets[B].Num(); });
+
+    Seeds.Init(0, NumKeys);
+    Slots.Init(INDEX_NONE, NumKeys);
+
+    int32 OrderIndex = 0;
+    TArray<int32, TInlineAllocator<16>> Placed;
+    for (; OrderIndex < BucketOrder.Num() && Buckets[BucketOrder[OrderIndex]].Num() > 1; OrderIndex++)
+    {
+        const int32 Bucket = BucketOrder[OrderIndex];
+        bool bPlaced = false;
+        for (int32 Seed = 1; Seed < (1 << 20) && !bPlaced; Seed++)
+        {
+            Placed.Reset();
+            bPlaced = true;
+            for (const int32 KeyIndex : Buckets[Bucket])
+            {
+                const int32 Slot = Hash(Keys[KeyIndex], Seed, bIgnoreCase) % NumKeys;
+                if (Slots[Slot] != INDEX_NONE || Placed.Contains(Slot))
+                {
+                    bPlaced = false;
+                    break;
+                }
+                Placed.Add(Slot);
+            }
+
+            if (bPlaced)
+            {
+                Seeds[Bucket] = Seed;
+                for (int32 I = 0; I < Placed.Num(); I++)
+                {
+                    Slots[Placed[I]] = Buckets[Bucket][I];
+                }
+            }
+        }
+
+        if (!bPlaced)
+        {
+            // Only happens with duplicate keys, in practice
+            YS_WARN("Couldn't build a perfect hash for %d keys; are there duplicates?", NumKeys)
+            Reset();
+            return false;
+        }
+    }
+
+    // Buckets with a single key go straight into whichever slots are left
+    int32 FreeSlot = 0;
+    for (; OrderIndex < BucketOrder.Num(); OrderIndex++)
+    {
+        const int32 Bucket = BucketOrder[OrderIndex];
+        while (Slots[FreeSlot] != INDEX_NONE)
+        {
+            FreeSlot++;
+        }
+        Seeds[Bucket] = -(FreeSlot + 1);
+        Slots[FreeSlot] = Buckets[Bucket][0];
+    }
+
+    return true;
+}
+
+
+void FYarnPerfectHash::Reset()
+{
+    Seeds.Empty();
+    Slots.Empty();
+}
+
+
+int32 FYarnPerfectHash::Find(FStringView Key) const
+{
+    const int32 NumKeys = Slots.Num();
+    if (NumKeys == 0)
+    {
+        return INDEX_NONE;
+    }
+
+    const int32 Seed = Seeds[Hash(Key, 0, bIgnoreCase) % NumKeys];
+    const int32 Slot = Seed < 0 ? -Seed - 1 : Hash(Key, Seed, bIgnoreCase) % NumKeys;
+    return Slots[Slot];
+}
+
+
+uint32 FYarnPerfectHash::Hash(FStringView Key, uint32 Seed, bool bIgnoreCase)
+{
+    // FNV-1a, seeded, with a final mix so that different seeds give unrelated results
+    uint32 Result = 2166136261u ^ (Seed * 0x9E3779B9u);
+    for (TCHAR Char : Key)
+    {
+        if (bIgnoreCase)
+        {
+            Char = FChar::ToLower(Char);
+        }
+        Result = (Result ^ static_cast<uint32>(Char)) * 16777619u;
+    }
+    Result ^= Result >> 16;
+    Result *= 0x85EBCA6Bu;
+    Result ^= Result >> 13;
+    Result *= 0xC2B2AE35u;
+    Result ^= Result >> 16;
+    return Result;
+}
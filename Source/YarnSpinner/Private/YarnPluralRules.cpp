@@ -0,0 +1,319 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnPluralRules.h"
+
+#include "Misc/YSLogging.h"
+
+
+namespace
+{
+    // CLDR's operands; see https://unicode.org/reports/tr35/tr35-numbers.html#Operands
+    enum EOperand : int32
+    {
+        N, // absolute value
+        I, // integer digits
+        V, // number of visible fraction digits, with trailing zeros
+        W, // number of visible fraction digits, without trailing zeros
+        F, // visible fraction digits, with trailing zeros
+        T, // visible fraction digits, without trailing zeros
+        E, // exponent; always 0, as substitutions aren't written in compact form
+    };
+
+    constexpr int32 NotEqual = 0x10;
+
+    struct FOperands
+    {
+        double N = 0;
+        int64 Values[E + 1] = {};
+    };
+
+    bool ReadOperands(FStringView Number, FOperands& Out)
+    {
+        Number = Number.TrimStartAndEnd();
+        if (Number.StartsWith(TEXT('-')) || Number.StartsWith(TEXT('+')))
+        {
+            Number.RightChopInline(1);
+        }
+
+        int32 Index = 0;
+        int64 Integer = 0;
+        for (; Index < Number.Len() && FChar::IsDigit(Number[Index]); Index++)
+        {
+            // Saturates rather than overflowing; nothing in CLDR cares about numbers this big
+            Integer = Integer < (MAX_int64 - 9) / 10 ? Integer * 10 + (Number[Index] - TEXT('0')) : MAX_int64;
+        }
+        if (Index == 0)
+        {
+            return false;
+        }
+
+        int32 Digits = 0;
+        int64 Fraction = 0;
+        int32 SignificantDigits = 0;
+        int64 SignificantFraction = 0;
+        if (Index < Number.Len() && Number[Index] == TEXT('.'))
+        {
+            for (Index++; Index < Number.Len() && FChar::IsDigit(Number[Index]) && Digits < 18; Index++)
+            {
+                Digits++;
+                Fraction = Fraction * 10 + (Number[Index] - TEXT('0'));
+                if (Number[Index] != TEXT('0'))
+                {
+                    SignificantDigits = Digits;
+                    SignificantFraction = Fraction;
+                }
+            }
+        }
+        if (Index != Number.Len())
+        {
+            return false;
+        }
+
+        Out.Values[I] = Integer;
+        Out.Values[V] = Digits;
+        Out.Values[W] = SignificantDigits;
+        Out.Values[F] = Fraction;
+        Out.Values[T] = SignificantFraction;
+        Out.Values[E] = 0;
+        Out.N = static_cast<double>(Integer) + (Digits > 0 ? static_cast<double>(Fraction) / FMath::Pow(10.0, Digits) : 0.0);
+        return true;
+    }
+
+    // Minimal tokenizer for CLDR rule conditions
+    struct FConditionReader
+    {
+        FStringView Text;
+        int32 Index = 0;
+
+        void SkipWhitespace()
+        {
+            while (Index < Text.Len() && FChar::IsWhitespace(Text[Index]))
+            {
+                Index++;
+            }
+        }
+
+        bool AtEnd()
+        {
+            SkipWhitespace();
+            return Index >= Text.Len();
+        }
+
+        bool Match(FStringView Token)
+        {
+            SkipWhitespace();
+            if (Text.Mid(Index).StartsWith(Token))
+            {
+                Index += Token.Len();
+                return true;
+            }
+            return false;
+        }
+
+        bool ReadInt(int32& Out)
+        {
+            SkipWhitespace();
+            const int32 Start = Index;
+            int64 Value = 0;
+            while (Index < Text.Len() && FChar::IsDigit(Text[Index]) && Value <= MAX_int32)
+            {
+                Value = Value * 10 + (Text[Index++] - TEXT('0'));
+            }
+            Out = static_cast<int32>(FMath::Min<int64>(Value, MAX_int32));
+            return Index > Start;
+        }
+
+        bool ReadOperand(int32& Out)
+        {
+            SkipWhitespace();
+            if (Index >= Text.Len())
+            {
+                return false;
+            }
+            switch (Text[Index++])
+            {
+            case TEXT('n'): Out = N; return true;
+            case TEXT('i'): Out = I; return true;
+            case TEXT('v'): Out = V; return true;
+            case TEXT('w'): Out = W; return true;
+            case TEXT('f'): Out = F; return true;
+            case TEXT('t'): Out = T; return true;
+            case TEXT('c'):
+            case TEXT('e'): Out = E; return true;
+            default: return false;
+            }
+        }
+    };
+
+    // relation = operand ('%' int)? ('=' | '!=') range (',' range)*, where range = int ('..' int)?
+    bool CompileRelation(FConditionReader& Reader, TArray<int32>& Out)
+    {
+        int32 Operand;
+        if (!Reader.ReadOperand(Operand))
+        {
+            return false;
+        }
+        int32 Modulus = 0;
+        if (Reader.Match(TEXT("%")) && (!Reader.ReadInt(Modulus) || Modulus == 0))
+        {
+            return false;
+        }
+        if (Reader.Match(TEXT("!=")))
+        {
+            Operand |= NotEqual;
+        }
+        else if (!Reader.Match(TEXT("=")))
+        {
+            return false;
+        }
+
+        Out.Add(Operand);
+        Out.Add(Modulus);
+        const int32 RangeCountIndex = Out.Add(0);
+        do
+        {
+            int32 Low, High;
+            if (!Reader.ReadInt(Low))
+            {
+                return false;
+            }
+            High = Low;
+            if (Reader.Match(TEXT("..")) && !Reader.ReadInt(High))
+            {
+                return false;
+            }
+            Out.Add(Low);
+            Out.Add(High);
+            Out[RangeCountIndex]++;
+        }
+        while (Reader.Match(TEXT(",")));
+        return true;
+    }
+
+    bool EvaluateRelation(const FOperands& Operands, const int32*& Code)
+    {
+        const int32 Operand = Code[0] & ~NotEqual;
+        const bool bNegate = (Code[0] & NotEqual) != 0;
+        const int32 Modulus = Code[1];
+        const int32 NumRanges = Code[2];
+        const int32* Ranges = Code + 3;
+        Code += 3 + NumRanges * 2;
+
+        // n can have a fraction, which never equals an integer in a range; the other operands are always integers
+        double Value = Operand == N ? Operands.N : static_cast<double>(Operands.Values[Operand]);
+        if (Modulus != 0)
+        {
+            Value = Operand == N ? FMath::Fmod(Value, static_cast<double>(Modulus)) : static_cast<double>(Operands.Values[Operand] % Modulus);
+        }
+
+        bool bInRange = false;
+        if (Value == FMath::FloorToDouble(Value))
+        {
+            for (int32 Range = 0; Range < NumRanges && !bInRange; Range++)
+            {
+                bInRange = Value >= Ranges[Range * 2] && Value <= Ranges[Range * 2 + 1];
+            }
+        }
+        return bInRange != bNegate;
+    }
+}
+
+
+bool FYarnPluralRules::AddRule(EYarnPluralCategory Category, FStringView Condition)
+{
+    // Samples ("@integer 1, 21, 31") aren't part of the condition
+    int32 SampleStart;
+    if (Condition.FindChar(TEXT('@'), SampleStart))
+    {
+        Condition = Condition.Left(SampleStart);
+    }
+
+    TArray<int32> Code;
+    Code.Add(static_cast<int32>(Category));
+    const int32 ClauseCountIndex = Code.Add(0);
+
+    FConditionReader Reader{Condition};
+    if (!Reader.AtEnd())
+    {
+        // condition = and_condition ('or' and_condition)*, where and_condition = relation ('and' relation)*
+        do
+        {
+            const int32 RelationCountIndex = Code.Add(0);
+            do
+            {
+                if (!CompileRelation(Reader, Code))
+                {
+                    YS_WARN("Couldn't compile the plural rule \"%.*s\"", Condition.Len(), Condition.GetData())
+                    return false;
+                }
+                Code[RelationCountIndex]++;
+            }
+            while (Reader.Match(TEXT("and")));
+            Code[ClauseCountIndex]++;
+        }
+        while (Reader.Match(TEXT("or")));
+    }
+
+    if (!Reader.AtEnd())
+    {
+        YS_WARN("Couldn't compile the plural rule \"%.*s\"", Condition.Len(), Condition.GetData())
+        return false;
+    }
+
+    // An empty condition is Other, which is what everything that doesn't match is anyway
+    if (Code[ClauseCountIndex] > 0)
+    {
+        Program.Append(Code);
+    }
+    return true;
+}
+
+
+EYarnPluralCategory FYarnPluralRules::Evaluate(FStringView Number) const
+{
+    FOperands Operands;
+    if (Program.Num() == 0 || !ReadOperands(Number, Operands))
+    {
+        return EYarnPluralCategory::Other;
+    }
+
+    const int32* Code = Program.GetData();
+    const int32* End = Code + Program.Num();
+    while (Code < End)
+    {
+        const EYarnPluralCategory Category = static_cast<EYarnPluralCategory>(*Code++);
+        const int32 NumClauses = *Code++;
+        bool bMatched = false;
+        for (int32 Clause = 0; Clause < NumClauses; Clause++)
+        {
+            const int32 NumRelations = *Code++;
+            bool bClause = true;
+            for (int32 Relation = 0; Relation < NumRelations; Relation++)
+            {
+                // Evaluated even once the clause has failed, to step over its code
+                bClause &= EvaluateRelation(Operands, Code);
+            }
+            bMatched |= bClause;
+        }
+        if (bMatched)
+        {
+            return Category;
+        }
+    }
+    return EYarnPluralCategory::Other;
+}
+
+
+const TCHAR* FYarnCultureRules::GetCategoryName(EYarnPluralCategory Category)
+{
+    switch (Category)
+    {
+    case EYarnPluralCategory::Zero: return TEXT("zero");
+    case EYarnPluralCategory::One: return TEXT("one");
+    case EYarnPluralCategory::Two: return TEXT("two");
+    case EYarnPluralCategory::Few: return TEXT("few");
+    case EYarnPluralCategory::Many: return TEXT("many");
+    default: return TEXT("other");
+    }
+}
@@ -6,30 +6,47 @@
 #include "YarnSpinner.h"
 #include "EditorFramework/AssetImportData.h"
 #include "Engine/DataTable.h"
+#include "Internationalization/Internationalization.h"
 #include "Misc/YarnAssetHelpers.h"
 #include "Misc/YSLogging.h"
+#if WITH_EDITOR
+#include "Interfaces/ITargetPlatform.h"
+#include "Library/YarnLibraryIndex.h"
+#include "UObject/ObjectSaveContext.h"
+#endif
+
+THIRD_PARTY_INCLUDES_START
+#include "YarnSpinnerCore/yarn_spinner.pb.h"
+THIRD_PARTY_INCLUDES_END
 
 
 void UYarnProject::Init()
 {
-    // Find related line assets
-    LineAssets.Empty();
-    FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry");
-    FARFilter Filter;
-    Filter.bRecursivePaths = true;
-    Filter.PackagePaths.Add("/Game");
-    TArray<FAssetData> AssetData;
-    AssetRegistryModule.Get().GetAssets(Filter, AssetData);
-    for (auto Asset : AssetData)
+    if (IsRunningDedicatedServer())
     {
-        YS_LOG_FUNC("Found asset: %s", *Asset.AssetName.ToString());
-        auto LineId = FName(TEXT("line:") + Asset.AssetName.ToString());
-        if (Lines.Contains(LineId))
-        {
-            // TODO: if path contains a loc identifier, add to loc table
-            LineAssets.FindOrAdd(LineId).Add(TSoftObjectPtr<UObject>(Asset.ToSoftObjectPath()));
-        }
+        return;
     }
+
+#if WITH_EDITOR
+    // Covers PIE too.  Cooked projects get a fresh index in PreSave, so packaged games never need this.
+    if (GIsEditor && !bLineAssetIndexCurrent)
+    {
+        BuildLineAssetIndex();
+        return;
+    }
+#endif
+
+    if (bLineAssetIndexBuilt)
+    {
+        return;
+    }
+
+#if WITH_EDITOR
+    BuildLineAssetIndex();
+#else
+    YS_WARN("%s was imported before line assets were indexed, so it has none; reimport it to find them", *GetName())
+    bLineAssetIndexBuilt = true;
+#endif
 }
 
 
@@ -61,9 +78,536 @@ UDataTable* UYarnProject::GetLocTextDataTable(const FName Language) const
 
 TArray<TSoftObjectPtr<UObject>> UYarnProject::GetLineAssets(const FName Name)
 {
-    if (!LineAssets.Contains(Name))
-        return {};
-    return LineAssets[Name];
+    return FindLineAssets(Name);
+}
+
+
+const TArray<TSoftObjectPtr<UObject>>& UYarnProject::FindLineAssets(const FName Name) const
+{
+    return FindLineAssets(GetLineIndex(Name));
+}
+
+
+const TArray<TSoftObjectPtr<UObject>>& UYarnProject::FindLineAssets(const int32 LineIndex) const
+{
+    static const TArray<TSoftObjectPtr<UObject>> NoAssets;
+    if (LineIndex == INDEX_NONE)
+    {
+        return NoAssets;
+    }
+    if (!bActiveLineAssetsResolved)
+    {
+        ResolveActiveLineAssets();
+    }
+    for (const FYarnCultureLineAssets* CultureAssets : ActiveLineAssets)
+    {
+        if (const FYarnLineAssetList* List = CultureAssets->Lines.Find(LineIndex))
+        {
+            return List->Assets;
+        }
+    }
+    return NoAssets;
+}
+
+
+#if WITH_EDITOR
+void UYarnProject::BuildLineAssetIndex()
+{
+    const double StartTime = FPlatformTime::Seconds();
+    LineAssetIndex.Reset();
+    bLineAssetIndexBuilt = true;
+    bLineAssetIndexCurrent = true;
+    // The resolved cultures point into the old index
+    bActiveLineAssetsResolved = false;
+
+    FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry");
+    FARFilter Filter;
+    Filter.bRecursivePaths = true;
+    Filter.PackagePaths.Add("/Game");
+    TArray<FAssetData> AssetData;
+    AssetRegistryModule.Get().GetAssets(Filter, AssetData);
+    int32 NumAssets = 0;
+    for (const FAssetData& Asset : AssetData)
+    {
+        NumAssets += AddLineAsset(Asset) ? 1 : 0;
+    }
+
+    // Sorted so rebuilding an unchanged project doesn't dirty it
+    for (TPair<FName, FYarnCultureLineAssets>& Culture : LineAssetIndex)
+    {
+        for (TPair<int32, FYarnLineAssetList>& Line : Culture.Value.Lines)
+        {
+            Line.Value.Assets.Sort([](const TSoftObjectPtr<UObject>& A, const TSoftObjectPtr<UObject>& B) { return A.ToSoftObjectPath().ToString() < B.ToSoftObjectPath().ToString(); });
+        }
+        Culture.Value.Lines.KeySort(TLess<int32>());
+    }
+    LineAssetIndex.KeySort(FNameLexicalLess());
+
+    YS_LOG("Indexed %d line assets in %d cultures for %s, from %d assets in %.2f ms", NumAssets, LineAssetIndex.Num(), *GetName(), AssetData.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0)
+}
+
+
+bool UYarnProject::AddLineAsset(const FAssetData& Asset)
+{
+    const FString LineID = TEXT("line:") + Asset.AssetName.ToString();
+    const int32 LineIndex = LineTable.Find(FStringView(LineID));
+    if (LineIndex == INDEX_NONE)
+    {
+        return false;
+    }
+
+    const TSoftObjectPtr<UObject> AssetPtr(Asset.ToSoftObjectPath());
+    TArray<TSoftObjectPtr<UObject>>& Assets = LineAssetIndex.FindOrAdd(GetLineAssetCulture(Asset.PackagePath)).Lines.FindOrAdd(LineIndex).Assets;
+    if (Assets.Contains(AssetPtr))
+    {
+        return false;
+    }
+    Assets.Add(AssetPtr);
+    bActiveLineAssetsResolved = false;
+    return true;
+}
+
+
+bool UYarnProject::RemoveLineAsset(const FSoftObjectPath& AssetPath)
+{
+    const FString LineID = TEXT("line:") + AssetPath.GetAssetName();
+    const int32 LineIndex = LineTable.Find(FStringView(LineID));
+    if (LineIndex == INDEX_NONE)
+    {
+        return false;
+    }
+
+    const TSoftObjectPtr<UObject> AssetPtr(AssetPath);
+    for (auto It = LineAssetIndex.CreateIterator(); It; ++It)
+    {
+        FYarnLineAssetList* List = It.Value().Lines.Find(LineIndex);
+        if (!List || List->Assets.Remove(AssetPtr) == 0)
+        {
+            continue;
+        }
+        if (List->Assets.Num() == 0)
+        {
+            It.Value().Lines.Remove(LineIndex);
+            if (It.Value().Lines.Num() == 0)
+            {
+                It.RemoveCurrent();
+            }
+        }
+        bActiveLineAssetsResolved = false;
+        return true;
+    }
+    return false;
+}
+
+
+FName UYarnProject::GetLineAssetCulture(const FName PackagePath) const
+{
+    // Localised assets are imported into <project>_Loc/<culture>/
+    const FString LocRoot = GetLocAssetPackage() + TEXT("/");
+    FString Path = PackagePath.ToString();
+    if (!Path.StartsWith(LocRoot))
+    {
+        return NAME_None;
+    }
+    Path.RightChopInline(LocRoot.Len());
+    int32 Slash;
+    if (Path.FindChar(TEXT('/'), Slash))
+    {
+        Path.LeftInline(Slash);
+    }
+    return FName(Path);
+}
+#endif
+
+
+void UYarnProject::BuildSymbolTables()
+{
+	VariableNames.Reset();
+	NodeNames.Reset();
+	Yarn::Program Program;
+	if (Program.ParsePartialFromArray(Data.GetData(), Data.Num()))
+	{
+		for (const auto& InitialValue : Program.initial_values())
+		{
+			VariableNames.Add(UTF8_TO_TCHAR(InitialValue.first.c_str()));
+		}
+		for (const auto& Node : Program.nodes())
+		{
+			NodeNames.Add(UTF8_TO_TCHAR(Node.first.c_str()));
+		}
+	}
+	VariableNames.Sort();
+	NodeNames.Sort();
+	NodeIndex.Build(Program, NodeNames);
+
+	VariableHash.Reset();
+	NodeHash.Reset();
+	BuildSymbolLookups();
+	InvalidateCompiledLines();
+}
+
+
+int32 UYarnProject::GetLineIndex(const FName LineID) const
+{
+	return LineTable.Find(LineID);
+}
+
+
+FName UYarnProject::GetLineIDForIndex(const int32 LineIndex) const
+{
+	return LineTable.IsValidIndex(LineIndex) ? FName(LineTable.GetID(LineIndex)) : NAME_None;
+}
+
+
+int32 UYarnProject::GetVariableIndex(const FString& VariableName) const
+{
+	const int32 Index = VariableHash.Find(VariableName);
+	return VariableNames.IsValidIndex(Index) && VariableNames[Index] == VariableName ? Index : INDEX_NONE;
+}
+
+
+const FString* UYarnProject::GetVariableNameForIndex(const int32 VariableIndex) const
+{
+	return VariableNames.IsValidIndex(VariableIndex) ? &VariableNames[VariableIndex] : nullptr;
+}
+
+
+int32 UYarnProject::GetNodeIndex(const FStringView NodeName) const
+{
+	const int32 Index = NodeHash.Find(NodeName);
+	return NodeNames.IsValidIndex(Index) && NodeNames[Index].Equals(NodeName, ESearchCase::CaseSensitive) ? Index : INDEX_NONE;
+}
+
+
+void UYarnProject::FindNodeIndices(TArrayView<const FStringView> Tags, TArrayView<const TPair<FStringView, FStringView>> Headers, TArray<int32>& OutNodeIndices) const
+{
+	NodeIndex.FindNodes(Tags, Headers, OutNodeIndices);
+}
+
+
+TArray<FName> UYarnProject::FindNodes(const TArray<FString>& Tags, const TMap<FString, FString>& Headers) const
+{
+	const TArray<FStringView, TInlineAllocator<8>> TagViews(Tags);
+	TArray<TPair<FStringView, FStringView>, TInlineAllocator<8>> HeaderViews;
+	for (const TPair<FString, FString>& Header : Headers)
+	{
+		HeaderViews.Emplace(Header.Key, Header.Value);
+	}
+
+	TArray<int32, TInlineAllocator<32>> Found;
+	FindNodeIndices(TagViews, HeaderViews, Found);
+
+	TArray<FName> Result;
+	Result.Reserve(Found.Num());
+	for (const int32 Index : Found)
+	{
+		Result.Add(FName(NodeNames[Index]));
+	}
+	return Result;
+}
+
+
+template <typename LookupType>
+static void BenchmarkLookups(const TCHAR* What, const TArray<FString>& Keys, SIZE_T HashBytes, LookupType&& Lookup)
+{
+	if (Keys.Num() == 0)
+	{
+		return;
+	}
+
+	// The map needs its own copy of every key; the hash doesn't, as it checks against the symbol table's
+	TMap<FString, int32> Map;
+	Map.Reserve(Keys.Num());
+	SIZE_T MapBytes = 0;
+	for (int32 I = 0; I < Keys.Num(); I++)
+	{
+		Map.Add(Keys[I], I);
+		MapBytes += Keys[I].GetAllocatedSize();
+	}
+	MapBytes += Map.GetAllocatedSize();
+
+	const int32 Rounds = FMath::Max(1, 1000000 / Keys.Num());
+	const double Lookups = static_cast<double>(Rounds) * Keys.Num();
+	int64 Checksum = 0;
+
+	double Start = FPlatformTime::Seconds();
+	for (int32 Round = 0; Round < Rounds; Round++)
+	{
+		for (const FString& Key : Keys)
+		{
+			Checksum += Lookup(Key);
+		}
+	}
+	const double HashSeconds = FPlatformTime::Seconds() - Start;
+
+	Start = FPlatformTime::Seconds();
+	for (int32 Round = 0; Round < Rounds; Round++)
+	{
+		for (const FString& Key : Keys)
+		{
+			const int32* Index = Map.Find(Key);
+			Checksum -= Index ? *Index : INDEX_NONE;
+		}
+	}
+	const double MapSeconds = FPlatformTime::Seconds() - Start;
+
+	// The checksum is zero if both found the same indices, and stops the loops being optimised away
+	YS_LOG("%s: %d keys.  Perfect hash %.1f ns/lookup, %llu bytes; TMap %.1f ns/lookup, %llu bytes%s",
+		What, Keys.Num(),
+		HashSeconds * 1e9 / Lookups, static_cast<uint64>(HashBytes),
+		MapSeconds * 1e9 / Lookups, static_cast<uint64>(MapBytes),
+		Checksum == 0 ? TEXT("") : TEXT(" (results differ!)"))
+}
+
+
+void UYarnProject::LogLookupBenchmark() const
+{
+	YS_LOG("Lookup benchmark for %s", *GetName())
+
+	TArray<FString> LineKeys;
+	LineKeys.Reserve(LineTable.Num());
+	for (int32 I = 0; I < LineTable.Num(); I++)
+	{
+		LineKeys.Emplace(LineTable.GetID(I));
+	}
+	// The map is case-sensitive, so the table's case-insensitive comparison makes it a little slower than it could be
+	BenchmarkLookups(TEXT("Lines"), LineKeys, LineTable.GetHashAllocatedSize(), [this](const FString& Key) { return LineTable.Find(FStringView(Key)); });
+	BenchmarkLookups(TEXT("Variables"), VariableNames, VariableHash.GetAllocatedSize(), [this](const FString& Key) { return GetVariableIndex(Key); });
+	BenchmarkLookups(TEXT("Nodes"), NodeNames, NodeHash.GetAllocatedSize(), [this](const FString& Key) { return GetNodeIndex(Key); });
+}
+
+
+void UYarnProject::LogMarkupBenchmark() const
+{
+	const int32 NumLines = LineTable.Num();
+	if (NumLines == 0 || !LineTable.HasText())
+	{
+		return;
+	}
+
+	TArray<FYarnMarkupAttribute> Attributes;
+	FMarkupParseResult Parsed;
+	int32 NumPreParsed = 0;
+	int32 NumAttributes = 0;
+	int64 NumChars = 0;
+	SIZE_T MarkupBytes = 0;
+
+	// Everything GetCompiledLine and the runner do for markup, for every line: copying out the attributes parsed on
+	// import, or parsing lines with substitutions (here without them substituted)
+	const double Start = FPlatformTime::Seconds();
+	for (int32 LineIndex = 0; LineIndex < NumLines; LineIndex++)
+	{
+		FStringView Text;
+		const FYarnMarkupTable* Markup;
+		FindLineText(LineIndex, Text, Markup);
+		NumChars += Text.Len();
+		if (Markup && !FYarnMarkupTable::NeedsRuntimeParse(Text))
+		{
+			Markup->GetAttributes(LineIndex, Attributes);
+			NumAttributes += Attributes.Num();
+			MarkupBytes = Markup->GetAllocatedSize();
+			NumPreParsed++;
+		}
+		else
+		{
+			FMarkupParser::Parse(Text, Parsed);
+			NumAttributes += Parsed.Attributes.Num();
+		}
+	}
+	const double Seconds = FPlatformTime::Seconds() - Start;
+
+	YS_LOG("Markup for %s in %s: %d lines, %lld characters, %d attributes.  %.0f ns per line (%d parsed on import, %d at display time); %llu bytes of markup tables",
+		*GetName(), *FInternationalization::Get().GetCurrentLanguage()->GetName(), NumLines, NumChars, NumAttributes,
+		Seconds * 1e9 / NumLines, NumPreParsed, NumLines - NumPreParsed, static_cast<uint64>(MarkupBytes))
+}
+
+
+bool UYarnProject::FindLineText(const FName LineID, FStringView& OutText) const
+{
+	return FindLineText(GetLineIndex(LineID), OutText);
+}
+
+
+bool UYarnProject::FindLineText(const int32 LineIndex, FStringView& OutText) const
+{
+	const FYarnMarkupTable* Markup;
+	return FindLineText(LineIndex, OutText, Markup);
+}
+
+
+bool UYarnProject::FindLineText(const int32 LineIndex, FStringView& OutText, const FYarnMarkupTable*& OutMarkup) const
+{
+	OutMarkup = nullptr;
+	if (!LineTable.IsValidIndex(LineIndex) || !LineTable.HasText())
+	{
+		return false;
+	}
+
+	if (!bActiveStringsResolved)
+	{
+		ResolveActiveStrings();
+	}
+
+	if (ActiveStrings && LineIndex < ActiveStrings->Num())
+	{
+		OutText = ActiveStrings->GetLine(LineIndex);
+		OutMarkup = ActiveStrings->GetMarkup();
+		return true;
+	}
+
+	OutText = LineTable.GetText(LineIndex);
+	OutMarkup = LineTable.GetMarkup();
+	return true;
+}
+
+
+const FYarnCompiledLine* UYarnProject::GetCompiledLine(const FName LineID) const
+{
+	return GetCompiledLine(GetLineIndex(LineID));
+}
+
+
+const FYarnCompiledLine* UYarnProject::GetCompiledLine(const int32 LineIndex) const
+{
+	if (const FYarnCompiledLine* Compiled = CompiledLines.Find(LineIndex))
+	{
+		return Compiled;
+	}
+
+	FStringView Source;
+	const FYarnMarkupTable* Markup;
+	if (!FindLineText(LineIndex, Source, Markup))
+	{
+		return nullptr;
+	}
+
+	FYarnCompiledLine& Compiled = CompiledLines.Add(LineIndex);
+	// Lines with arguments keep their markup until the runner has substituted them, as the values can contain markup
+	if (FYarnMarkupTable::NeedsRuntimeParse(Source))
+	{
+		Compiled.Text = FText::FromString(FString(Source));
+		Compiled.Format.Emplace(Compiled.Text);
+	}
+	else if (Markup)
+	{
+		Compiled.Text = FText::FromString(FString(Source));
+		Markup->GetAttributes(LineIndex, Compiled.Attributes);
+	}
+	else
+	{
+		// Imported before markup was parsed on import
+		FMarkupParseResult Parsed;
+		FMarkupParser::Parse(Source, Parsed, GetPluralRules());
+		Compiled.Text = FText::FromString(MoveTemp(Parsed.Text));
+		Compiled.Attributes = MoveTemp(Parsed.Attributes);
+	}
+	return &Compiled;
+}
+
+
+const FYarnCultureRules* UYarnProject::GetPluralRules() const
+{
+	if (!bActiveStringsResolved)
+	{
+		ResolveActiveStrings();
+	}
+	return ActiveRules;
+}
+
+
+const FYarnCultureRules* UYarnProject::FindPluralRules(const FName Culture) const
+{
+	return PluralRules.FindByPredicate([Culture](const FYarnCultureRules& Rules) { return Rules.Culture == Culture; });
+}
+
+
+void UYarnProject::InvalidateCompiledLines()
+{
+	CompiledLines.Reset();
+	// Let go of the old culture's strings now; the new culture's are loaded when they're first needed
+	ActiveStrings.Reset();
+	ActiveRules = nullptr;
+	bActiveStringsResolved = false;
+	bActiveLineAssetsResolved = false;
+}
+
+
+void UYarnProject::ResolveActiveStrings() const
+{
+	bActiveStringsResolved = true;
+	ActiveStrings.Reset();
+	ActiveRules = PluralRules.Num() > 0 ? &PluralRules[0] : nullptr;
+	if (LocalizedStrings.Num() == 0)
+	{
+		return;
+	}
+
+	// Most specific first, e.g. pt-BR then pt
+	for (const FString& CultureName : FInternationalization::Get().GetCurrentLanguage()->GetPrioritizedParentCultureNames())
+	{
+		if (const TSoftObjectPtr<UYarnLocalizedStrings>* Strings = LocalizedStrings.Find(FName(CultureName)))
+		{
+			ActiveStrings.Reset(Strings->LoadSynchronous());
+			if (const FYarnCultureRules* Rules = FindPluralRules(FName(CultureName)))
+			{
+				ActiveRules = Rules;
+			}
+			YS_LOG("Using %s line text for %s", *CultureName, *GetName())
+			return;
+		}
+	}
+}
+
+
+void UYarnProject::ResolveActiveLineAssets() const
+{
+	bActiveLineAssetsResolved = true;
+	ActiveLineAssets.Reset();
+	if (LineAssetIndex.Num() == 0)
+	{
+		return;
+	}
+
+	auto AddCulture = [this](const FName Culture)
+	{
+		const FYarnCultureLineAssets* CultureAssets = LineAssetIndex.Find(Culture);
+		if (CultureAssets && !ActiveLineAssets.Contains(CultureAssets))
+		{
+			ActiveLineAssets.Add(CultureAssets);
+		}
+	};
+
+	// The most specific culture that has any assets
+	for (const FString& CultureName : FInternationalization::Get().GetCurrentLanguage()->GetPrioritizedParentCultureNames())
+	{
+		if (LineAssetIndex.Contains(FName(CultureName)))
+		{
+			AddCulture(FName(CultureName));
+			break;
+		}
+	}
+	AddCulture(NAME_None);
+	if (PluralRules.Num() > 0)
+	{
+		AddCulture(PluralRules[0].Culture);
+	}
+}
+
+
+void UYarnProject::BuildSymbolLookups()
+{
+	// Hashes are built on import and saved with the project; this only fills in any that are missing
+	if (VariableHash.Num() != VariableNames.Num())
+	{
+		TArray<FStringView> Keys(VariableNames);
+		VariableHash.Build(Keys, false);
+	}
+	if (NodeHash.Num() != NodeNames.Num())
+	{
+		TArray<FStringView> Keys(NodeNames);
+		NodeHash.Build(Keys, false);
+	}
+	LineTable.BuildHash();
 }
 
 
@@ -80,6 +624,13 @@ void UYarnProject::GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) cons
 #endif
 
 
+void UYarnProject::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(LineTable.GetAllocatedSize() + VariableHash.GetAllocatedSize() + NodeHash.GetAllocatedSize() + NodeIndex.GetAllocatedSize());
+}
+
+
 void UYarnProject::PostInitProperties()
 {
 #if WITH_EDITORONLY_DATA
@@ -90,6 +641,11 @@ void UYarnProject::PostInitProperties()
 	}
 #endif
 	Super::PostInitProperties();
+
+	if (!HasAnyFlags(RF_ClassDefaultObject))
+	{
+		FInternationalization::Get().OnCultureChanged().AddUObject(this, &UYarnProject::InvalidateCompiledLines);
+	}
 }
 
 
@@ -97,6 +653,31 @@ void UYarnProject::PostLoad()
 {
 	Super::PostLoad();
 
+	// Projects imported before the line table existed.  Their line IDs are already in the FName table by now, but
+	// resaving the project stops that happening next time.
+	if (Lines.Num() > 0)
+	{
+		TArray<TPair<FString, FString>> LegacyLines;
+		LegacyLines.Reserve(Lines.Num());
+		for (const TPair<FName, FString>& Line : Lines)
+		{
+			LegacyLines.Emplace(Line.Key.ToString(), Line.Value);
+		}
+		LineTable.Build(MoveTemp(LegacyLines));
+		Lines.Empty();
+		LineIDs.Empty();
+		BuildSymbolTables();
+	}
+	else if ((NodeNames.Num() == 0 || NodeIndex.NumNodes() != NodeNames.Num()) && Data.Num() > 0)
+	{
+		// Imported before the node table or the node index existed, or cooked for a server, which leaves the index out
+		BuildSymbolTables();
+	}
+	else
+	{
+		BuildSymbolLookups();
+	}
+
 #if WITH_EDITORONLY_DATA
 	if (AssetImportData == nullptr)
 	{
@@ -106,6 +687,59 @@ void UYarnProject::PostLoad()
 }
 
 
+#if WITH_EDITOR
+void UYarnProject::PreSave(FObjectPreSaveContext ObjectSaveContext)
+{
+	// Projects imported before the reference existed would otherwise cook without the library index
+	if (LibraryIndex.IsNull())
+	{
+		LibraryIndex = TSoftObjectPtr<UYarnLibraryIndex>(FSoftObjectPath(FYarnAssetHelpers::LibraryIndexObjectPath()));
+	}
+	// Assets can change outside the editor, e.g. in source control, so cooked projects always get a fresh index
+	if (ObjectSaveContext.IsCooking())
+	{
+		BuildLineAssetIndex();
+	}
+
+	const ITargetPlatform* TargetPlatform = ObjectSaveContext.GetTargetPlatform();
+	if (ObjectSaveContext.IsCooking() && bStripPresentationDataForServer && TargetPlatform && TargetPlatform->IsServerOnly())
+	{
+		// Set the presentation data aside until PostSave, so the cooked server asset only carries what the VM needs.
+		// Serialize runs several times per save, so this happens here rather than there.  The line IDs stay, since
+		// server-authoritative dialogue sends lines by index.
+		FYarnPresentationData& Saved = PresentationDataForCook.Emplace();
+		Saved.LineTable = LineTable;
+		LineTable.StripText();
+		Saved.PluralRules = MoveTemp(PluralRules);
+		Saved.LocalizedStrings = MoveTemp(LocalizedStrings);
+		Saved.YarnFiles = MoveTemp(YarnFiles);
+		Saved.LineAssetIndex = MoveTemp(LineAssetIndex);
+		Saved.NodeIndex = NodeIndex;
+		NodeIndex.Reset();
+	}
+	Super::PreSave(ObjectSaveContext);
+}
+
+
+void UYarnProject::PostSave(FObjectPostSaveContext ObjectSaveContext)
+{
+	if (PresentationDataForCook.IsSet())
+	{
+		FYarnPresentationData& Saved = PresentationDataForCook.GetValue();
+		LineTable = MoveTemp(Saved.LineTable);
+		PluralRules = MoveTemp(Saved.PluralRules);
+		LocalizedStrings = MoveTemp(Saved.LocalizedStrings);
+		YarnFiles = MoveTemp(Saved.YarnFiles);
+		LineAssetIndex = MoveTemp(Saved.LineAssetIndex);
+		NodeIndex = MoveTemp(Saved.NodeIndex);
+		PresentationDataForCook.Reset();
+		InvalidateCompiledLines();
+	}
+	Super::PostSave(ObjectSaveContext);
+}
+#endif
+
+
 #if WITH_EDITORONLY_DATA
 void UYarnProject::SetYarnSources(const TArray<FString>& NewYarnSources)
 {
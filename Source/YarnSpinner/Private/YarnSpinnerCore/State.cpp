@@ -1,5 +1,7 @@
 #include "YarnSpinnerCore/State.h"
 
+#include <algorithm>
+
 namespace Yarn
 {
 
@@ -72,6 +74,20 @@ namespace Yarn
         return stack.back();
     }
 
+    const Value *State::PeekValues(size_t count) const
+    {
+        if (count > stack.size())
+        {
+            return nullptr;
+        }
+        return stack.data() + (stack.size() - count);
+    }
+
+    void State::PopValues(size_t count)
+    {
+        stack.resize(stack.size() - std::min(count, stack.size()));
+    }
+
     void State::ClearStack()
     {
     }
@@ -80,7 +80,21 @@ namespace Yarn
 
     bool VirtualMachine::SetNode(const char* nodeName)
     {
-        if (program.nodes().contains(nodeName) == false)
+        const Node* node = nullptr;
+        if (FindNode)
+        {
+            node = FindNode(nodeName);
+        }
+        else
+        {
+            auto found = program.nodes().find(nodeName);
+            if (found != program.nodes().end())
+            {
+                node = &found->second;
+            }
+        }
+
+        if (node == nullptr)
         {
             logger.Log(string_format("No node named %s has been loaded.", nodeName), ILogger::ERROR);
             return false;
@@ -88,11 +102,12 @@ namespace Yarn
 
         logger.Log(string_format("Running node %s", nodeName));
 
-        currentNode = program.nodes().at(nodeName);
+        currentNode = *node;
 
         // Clear our State and return to the Stopped execution state
         state = State();
         SetCurrentExecutionState(ExecutionState::STOPPED);
+        instructionsSinceContent = 0;
 
         state.currentNodeName = nodeName;
 
@@ -126,6 +141,12 @@ namespace Yarn
 
 
     bool VirtualMachine::Continue()
+    {
+        return Continue(ExecutionBudget());
+    }
+
+
+    bool VirtualMachine::Continue(const ExecutionBudget& budget)
     {
         // Perform a safety check to ensure that we're in a ready state to continue
         if (CheckCanContinue() == false)
@@ -146,6 +167,9 @@ namespace Yarn
 
         SetCurrentExecutionState(RUNNING);
 
+        const double startTime = budget.MaxSeconds > 0 ? FPlatformTime::Seconds() : 0;
+        lastInstructionCount = 0;
+
         while (GetCurrentExecutionState() == RUNNING)
         {
             Yarn::Instruction currentInstruction = currentNode.instructions().at(state.programCounter);
@@ -169,8 +193,96 @@ namespace Yarn
                 DialogueCompleteHandler();
                 logger.Log("Run complete.", ILogger::INFO);
             }
+
+            lastInstructionCount++;
+            instructionsSinceContent++;
+
+            if (GetCurrentExecutionState() != RUNNING)
+            {
+                break;
+            }
+
+            if (budget.RunawayInstructionLimit > 0 && instructionsSinceContent > budget.RunawayInstructionLimit)
+            {
+                logger.Log(string_format("Node %s ran %d instructions without delivering any content and was stopped; is it stuck in a loop? (pc %d)", currentNode.name().c_str(), instructionsSinceContent, state.programCounter), ILogger::ERROR);
+                SetCurrentExecutionState(ERROR);
+                return false;
+            }
+
+            // Checking the clock is comparatively expensive, so only do it every few instructions
+            const bool bOutOfInstructions = budget.MaxInstructions > 0 && lastInstructionCount >= budget.MaxInstructions;
+            const bool bOutOfTime = budget.MaxSeconds > 0 && (lastInstructionCount & 31) == 0 && FPlatformTime::Seconds() - startTime >= budget.MaxSeconds;
+            if (bOutOfInstructions || bOutOfTime)
+            {
+                SetCurrentExecutionState(YIELDED);
+            }
+        }
+
+        return true;
+    }
+
+
+    void VirtualMachine::Stop()
+    {
+        if (executionState == STOPPED)
+        {
+            return;
+        }
+        logger.Log("Dialogue stopped.", ILogger::INFO);
+        // Clears the stack, options and program counter too
+        SetCurrentExecutionState(STOPPED);
+        // Nothing to continue until SetNode is called again
+        currentNode = Node();
+        currentNodeName.clear();
+        instructionsSinceContent = 0;
+    }
+
+
+    bool VirtualMachine::WaitOnCommand()
+    {
+        if (executionState != DELIVERING_CONTENT)
+        {
+            logger.Log("WaitOnCommand can only be called while a command is being delivered.", ILogger::ERROR);
+            return false;
         }
+        SetCurrentExecutionState(WAITING_ON_COMMAND);
+        return true;
+    }
+
+
+    void VirtualMachine::CompleteCommand()
+    {
+        if (executionState != WAITING_ON_COMMAND)
+        {
+            logger.Log("CompleteCommand was called, but Dialogue wasn't waiting on a command.", ILogger::WARNING);
+            return;
+        }
+        SetCurrentExecutionState(WAITING_FOR_CONTINUE);
+    }
 
+
+    bool VirtualMachine::WaitOnFunction()
+    {
+        if (executionState != RUNNING)
+        {
+            logger.Log("WaitOnFunction can only be called while a function is being called.", ILogger::ERROR);
+            return false;
+        }
+        SetCurrentExecutionState(WAITING_ON_FUNCTION);
+        return true;
+    }
+
+
+    bool VirtualMachine::ResumeWithValue(Value value)
+    {
+        if (executionState != WAITING_ON_FUNCTION)
+        {
+            logger.Log("ResumeWithValue was called, but Dialogue wasn't waiting on a function.", ILogger::WARNING);
+            return false;
+        }
+        state.PushValue(std::move(value));
+        logger.Log(string_format("Function call returned \"%s\" (type: %d)", state.PeekValue().ConvertToString().c_str(), state.PeekValue().GetType()));
+        SetCurrentExecutionState(WAITING_FOR_CONTINUE);
         return true;
     }
 
@@ -235,6 +347,7 @@ namespace Yarn
 
                 // Mark that we're currently delivering content
                 SetCurrentExecutionState(DELIVERING_CONTENT);
+                instructionsSinceContent = 0;
 
                 // Call the line handler
                 LineHandler(line);
@@ -272,6 +385,7 @@ namespace Yarn
                 }
 
                 SetCurrentExecutionState(DELIVERING_CONTENT);
+                instructionsSinceContent = 0;
 
                 auto command = Command();
                 command.Text = commandText;
@@ -408,6 +522,7 @@ namespace Yarn
                 // We can't continue until our client tell us which
                 // option to pick
                 SetCurrentExecutionState(WAITING_ON_OPTION_SELECTION);
+                instructionsSinceContent = 0;
 
                 // Pass the options set to the client, as well as a
                 // delegate for them to call when the user has made
@@ -462,17 +577,25 @@ namespace Yarn
                     return false;
                 }
 
-                std::vector<Value> parameters;
+                // The parameters are already on the stack in call order, so hand them over in place
+                const Value *parameters = state.PeekValues(actualParamCount);
+                if (actualParamCount < 0 || parameters == nullptr)
+                {
+                    logger.Log(string_format("Function '%s' called with %i parameters, but the stack only holds %i", functionName.c_str(), actualParamCount, (int)state.stack.size()), ILogger::ERROR);
+                    return false;
+                }
+
+                auto result = CallFunction(functionName, parameters, actualParamCount);
+                state.PopValues(actualParamCount);
 
-                for (int param = actualParamCount - 1; param >= 0; param--)
+                if (GetCurrentExecutionState() == WAITING_ON_FUNCTION)
                 {
-                    auto value = state.PopValue();
-                    parameters.push_back(value);
+                    // The result arrives through ResumeWithValue
+                    logger.Log(string_format("Waiting on function '%s'", functionName.c_str()));
+                    break;
                 }
-                std::reverse(parameters.begin(), parameters.end());
 
-                auto result = CallFunction(functionName, parameters);
-                state.PushValue(result);
+                state.PushValue(std::move(result));
 
                 // if (library.HasFunction<std::string>(functionName))
                 // {
@@ -616,12 +739,30 @@ namespace Yarn
 
     bool VirtualMachine::CheckCanContinue()
     {
+        if (executionState == STOPPED && currentNode.name().empty())
+        {
+            logger.Log("Cannot continue running dialogue. It was stopped, or no node has been selected; call SetNode first.", ILogger::Type::ERROR);
+            return false;
+        }
+
         if (executionState == WAITING_ON_OPTION_SELECTION)
         {
             logger.Log("Cannot continue running dialogue. Still waiting on option selection.", ILogger::Type::ERROR);
             return false;
         }
 
+        if (executionState == WAITING_ON_COMMAND)
+        {
+            logger.Log("Cannot continue running dialogue. Still waiting on a command to finish.", ILogger::Type::WARNING);
+            return false;
+        }
+
+        if (executionState == WAITING_ON_FUNCTION)
+        {
+            logger.Log("Cannot continue running dialogue. Still waiting on a function result.", ILogger::Type::WARNING);
+            return false;
+        }
+
         if (!LineHandler)
         {
             logger.Log("Cannot continue dialogue: LineHandler has not been set.", ILogger::Type::ERROR);
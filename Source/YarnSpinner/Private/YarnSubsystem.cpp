@@ -3,8 +3,8 @@
 
 #include "YarnSubsystem.h"
 
+#include "DialogueRunner.h"
 #include "DisplayLine.h"
-#include "Engine/ObjectLibrary.h"
 #include "Library/YarnCommandLibrary.h"
 #include "Library/YarnFunctionLibrary.h"
 #include "Library/YarnLibraryRegistry.h"
@@ -12,146 +12,503 @@
 #include "Misc/OutputDeviceNull.h"
 #include "Misc/YarnAssetHelpers.h"
 #include "Misc/YSLogging.h"
+#include "UObject/UObjectIterator.h"
+#include "Async/Async.h"
+#include "Engine/DataTable.h"
+#include "HAL/IConsoleManager.h"
+#include "YarnProject.h"
+#include "YarnVariableRow.h"
+#include "YarnVariableSerializer.h"
+
+
+static FAutoConsoleCommandWithWorldAndArgs GYarnDumpVariablesCommand(
+    TEXT("yarn.DumpVariables"),
+    TEXT("Logs every Yarn variable and its value.  An optional argument filters by variable name."),
+    FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+    {
+        UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+        UYarnSubsystem* Subsystem = GameInstance ? GameInstance->GetSubsystem<UYarnSubsystem>() : nullptr;
+        if (!Subsystem)
+        {
+            YS_WARN("yarn.DumpVariables: no YarnSubsystem in this world")
+            return;
+        }
+        Subsystem->DumpVariables(Args.Num() > 0 ? Args[0] : FString());
+    }));
+
+
+static FAutoConsoleCommand GYarnBenchmarkLookupsCommand(
+    TEXT("yarn.BenchmarkLookups"),
+    TEXT("Times line, variable and node lookups in every loaded Yarn project against a TMap of the same keys, and logs the memory each uses."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        for (TObjectIterator<UYarnProject> It; It; ++It)
+        {
+            if (!It->HasAnyFlags(RF_ClassDefaultObject))
+            {
+                It->LogLookupBenchmark();
+            }
+        }
+    }));
+
+
+static FAutoConsoleCommand GYarnBenchmarkMarkupCommand(
+    TEXT("yarn.BenchmarkMarkup"),
+    TEXT("Times markup for every line of every loaded Yarn project in the current culture, as it's done at display time."),
+    FConsoleCommandDelegate::CreateLambda([]()
+    {
+        for (TObjectIterator<UYarnProject> It; It; ++It)
+        {
+            if (!It->HasAnyFlags(RF_ClassDefaultObject))
+            {
+                It->LogMarkupBenchmark();
+            }
+        }
+    }));
+
+
+static TAutoConsoleVariable<int32> CVarYarnInstructionBudget(
+    TEXT("yarn.InstructionBudget"),
+    0,
+    TEXT("Instructions a dialogue runner may run before yielding until the next frame.  0 for no limit."));
+
+static TAutoConsoleVariable<float> CVarYarnTimeBudgetUs(
+    TEXT("yarn.TimeBudgetUs"),
+    0,
+    TEXT("Microseconds a dialogue runner may run script for before yielding until the next frame.  0 for no limit."));
+
+static TAutoConsoleVariable<float> CVarYarnFrameBudgetUs(
+    TEXT("yarn.FrameBudgetUs"),
+    0,
+    TEXT("Microseconds all dialogue runners together may spend in Continue each frame, including the handlers it calls.  Runners over it wait for the next frame.  0 for no limit."));
+
+static TAutoConsoleVariable<int32> CVarYarnRunawayInstructionLimit(
+    TEXT("yarn.RunawayInstructionLimit"),
+    1000000,
+    TEXT("Instructions a dialogue may run without delivering a line, options or a command before it's stopped as a runaway loop.  0 to disable."));
 
 
 UYarnSubsystem::UYarnSubsystem()
 {
     YS_LOG_FUNCSIG
+}
+
+
+void UYarnSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+    YS_LOG_FUNCSIG
+    Super::Initialize(Collection);
 
-    YarnFunctionObjectLibrary = UObjectLibrary::CreateLibrary(UYarnFunctionLibrary::StaticClass(), true, true);
-    YarnCommandObjectLibrary = UObjectLibrary::CreateLibrary(UYarnCommandLibrary::StaticClass(), true, true);
-    YarnFunctionObjectLibrary->AddToRoot();
-    YarnCommandObjectLibrary->AddToRoot();
-    YarnFunctionObjectLibrary->bRecursivePaths = true;
-    YarnCommandObjectLibrary->bRecursivePaths = true;
-    YarnFunctionObjectLibrary->LoadAssetDataFromPath(TEXT("/Game"));
-    YarnCommandObjectLibrary->LoadAssetDataFromPath(TEXT("/Game"));
+    // Only the standard library is set up here.  Blueprint libraries are indexed from the .ysls file when the game
+    // instance starts and loaded when a program links against them, so startup doesn't scale with project size.
+    // Each stage logs its own timing: this one, the registry's index, and LinkProgram per dialogue runner.
+    const double StartTime = FPlatformTime::Seconds();
 
     YarnFunctionRegistry = NewObject<UYarnLibraryRegistry>(this, "YarnFunctionRegistry");
+
+    YS_LOG("Yarn subsystem initialized in %.2f ms (standard library and native functions)", (FPlatformTime::Seconds() - StartTime) * 1000.0)
 }
 
 
-void UYarnSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+void UYarnSubsystem::Deinitialize()
 {
     YS_LOG_FUNCSIG
-    Super::Initialize(Collection);
+    Super::Deinitialize();
+}
+
+
+void UYarnSubsystem::SetValue(std::string name, bool value)
+{
+    SetVariable(FString(UTF8_TO_TCHAR(name.c_str())), Yarn::Value(value));
+}
 
-    TArray<TSubclassOf<UYarnFunctionLibrary>> LibRefs;
-    TArray<FAssetData> Blueprints;
 
-    FARFilter Filter;
-#if ENGINE_MAJOR_VERSION >= 5 && ENGINE_MINOR_VERSION >= 1
-    Filter.ClassPaths.Add(UBlueprint::StaticClass()->GetClassPathName());
-    Filter.ClassPaths.Add(UBlueprintGeneratedClass::StaticClass()->GetClassPathName());
-#else
-    Filter.ClassNames.Add(UBlueprint::StaticClass()->GetFName());
-    Filter.ClassNames.Add(UBlueprintGeneratedClass::StaticClass()->GetFName());
-#endif
-    FAssetRegistryModule::GetRegistry().GetAssets(Filter, Blueprints);
+void UYarnSubsystem::SetValue(std::string name, float value)
+{
+    SetVariable(FString(UTF8_TO_TCHAR(name.c_str())), Yarn::Value(value));
+}
 
-    for (auto Asset : Blueprints)
+
+void UYarnSubsystem::SetValue(std::string name, std::string value)
+{
+    SetVariable(FString(UTF8_TO_TCHAR(name.c_str())), Yarn::Value(value));
+}
+
+
+bool UYarnSubsystem::HasValue(std::string name)
+{
+    return Variables.Contains(FString(UTF8_TO_TCHAR(name.c_str())));
+}
+
+
+Yarn::Value UYarnSubsystem::GetValue(std::string name)
+{
+    // Don't add missing variables here; reads must not mutate the store
+    return Variables.Find(FString(UTF8_TO_TCHAR(name.c_str()))).Get(Yarn::Value());
+}
+
+
+void UYarnSubsystem::ClearValue(std::string name)
+{
+    ClearVariable(FString(UTF8_TO_TCHAR(name.c_str())));
+}
+
+
+void UYarnSubsystem::SetVariable(const FString& Name, const Yarn::Value& Value, FName SourceNode)
+{
+    YS_VERBOSE("Setting variable '%s' to '%s'", *Name, UTF8_TO_TCHAR(Value.ConvertToString().c_str()))
+    TOptional<Yarn::Value> OldValue = Variables.Set(Name, Value);
+    RecordChange(Name, MoveTemp(OldValue), Value, SourceNode);
+}
+
+
+void UYarnSubsystem::ClearVariable(const FString& Name, FName SourceNode)
+{
+    YS_VERBOSE("Clearing variable '%s'", *Name)
+    TOptional<Yarn::Value> OldValue = Variables.Remove(Name);
+    if (OldValue.IsSet())
     {
-        if (UObject* BPObj = Cast<UObject>(Asset.GetAsset()))
+        RecordChange(Name, MoveTemp(OldValue), {}, SourceNode);
+    }
+}
+
+
+void UYarnSubsystem::CommitVariableSession(FYarnVariableSession& Session, FName SourceNode)
+{
+    check(IsInGameThread());
+
+    if (Session.HasPendingChanges())
+    {
+        const TArray<TPair<FString, TOptional<Yarn::Value>>>& Changes = Session.GetPendingChanges();
+        TArray<TOptional<Yarn::Value>> OldValues;
+        Variables.Apply(Changes, &OldValues);
+        for (int32 I = 0; I < Changes.Num(); I++)
         {
-            UBlueprint* BP = Cast<UBlueprint>(StaticLoadObject(UBlueprint::StaticClass(), nullptr, *BPObj->GetPathName()));
-            if (BP && BP->GeneratedClass && BP->GeneratedClass->GetDefaultObject())
+            RecordChange(Changes[I].Key, MoveTemp(OldValues[I]), Changes[I].Value, SourceNode);
+        }
+        Session.Discard();
+    }
+    Session.Refresh();
+}
+
+
+FDelegateHandle UYarnSubsystem::AddVariableObserver(const FString& Name, FYarnVariableChangesDelegate::FDelegate Observer)
+{
+    FScopeLock Lock(&JournalLock);
+    const FDelegateHandle Handle = VariableObservers.FindOrAdd(Name).Add(MoveTemp(Observer));
+    UpdateHasVariableObservers();
+    return Handle;
+}
+
+
+void UYarnSubsystem::RemoveVariableObserver(const FString& Name, FDelegateHandle Handle)
+{
+    FScopeLock Lock(&JournalLock);
+    if (FYarnVariableChangesDelegate* Observers = VariableObservers.Find(Name))
+    {
+        Observers->Remove(Handle);
+        if (!Observers->IsBound())
+        {
+            VariableObservers.Remove(Name);
+        }
+    }
+    UpdateHasVariableObservers();
+}
+
+
+FDelegateHandle UYarnSubsystem::AddAnyVariableObserver(FYarnVariableChangesDelegate::FDelegate Observer)
+{
+    FScopeLock Lock(&JournalLock);
+    const FDelegateHandle Handle = AnyVariableChanged.Add(MoveTemp(Observer));
+    UpdateHasVariableObservers();
+    return Handle;
+}
+
+
+void UYarnSubsystem::RemoveAnyVariableObserver(FDelegateHandle Handle)
+{
+    FScopeLock Lock(&JournalLock);
+    AnyVariableChanged.Remove(Handle);
+    UpdateHasVariableObservers();
+}
+
+
+void UYarnSubsystem::RecordChange(FString Name, TOptional<Yarn::Value> OldValue, TOptional<Yarn::Value> NewValue, FName SourceNode)
+{
+    // Nobody to tell, so don't pay for the copy.  Writers can be on any thread, so this reads the flag rather than the
+    // observers themselves.
+    if (!bHasVariableObservers)
+    {
+        return;
+    }
+
+    FScopeLock Lock(&JournalLock);
+    Journal.Add({MoveTemp(Name), MoveTemp(OldValue), MoveTemp(NewValue), SourceNode});
+}
+
+
+void UYarnSubsystem::FlushVariableChanges()
+{
+    TArray<FYarnVariableChange> Changes;
+    {
+        FScopeLock Lock(&JournalLock);
+        Swap(Changes, Journal);
+    }
+    if (Changes.Num() == 0)
+    {
+        return;
+    }
+
+    if (VariableObservers.Num() > 0)
+    {
+        // Group changes by variable so each observer gets a single call, keeping the order the changes were made in
+        TMap<FString, TArray<FYarnVariableChange>> ChangesByName;
+        for (const FYarnVariableChange& Change : Changes)
+        {
+            if (VariableObservers.Contains(Change.Name))
             {
-                // if (BP->GetBlueprintClass()->IsChildOf<AYarnFunctionLibrary>())
-                if (auto YFL = UYarnFunctionLibrary::FromBlueprint(BP))
-                {
-                    YS_LOG_FUNC("FOUNDDDD OOOONNNNEEE")
-                    LibRefs.Add(*BP->GeneratedClass);
-                }
+                ChangesByName.FindOrAdd(Change.Name).Add(Change);
+            }
+        }
+        for (const auto& Entry : ChangesByName)
+        {
+            // Look the observer up again in case an earlier callback removed it
+            if (const FYarnVariableChangesDelegate* Observers = VariableObservers.Find(Entry.Key))
+            {
+                Observers->Broadcast(Entry.Value);
             }
         }
     }
 
-    for (auto Lib : LibRefs)
+    AnyVariableChanged.Broadcast(Changes);
+}
+
+
+TArray<uint8> UYarnSubsystem::SaveVariables(const UYarnProject* Baseline) const
+{
+    TMap<FString, Yarn::Value> InitialValues;
+    if (Baseline)
     {
-        if (Lib->FindFunctionByName(FName("MyQuickActorFunction")))
+        FYarnVariableSerializer::GetInitialValues(Baseline->Data, InitialValues);
+    }
+
+    TArray<uint8> Result;
+    FYarnVariableSerializer::Save(Variables.Snapshot()->Values, InitialValues, Result);
+    return Result;
+}
+
+
+TFuture<TArray<uint8>> UYarnSubsystem::SaveVariablesAsync(const UYarnProject* Baseline) const
+{
+    // Copy everything the worker needs now, so nothing it touches can change or be garbage collected under it
+    FYarnVariableSnapshotRef Snapshot = Variables.Snapshot();
+    TArray<uint8> ProgramData = Baseline ? Baseline->Data : TArray<uint8>();
+
+    return Async(EAsyncExecution::ThreadPool, [Snapshot, ProgramData = MoveTemp(ProgramData)]()
+    {
+        TMap<FString, Yarn::Value> InitialValues;
+        if (ProgramData.Num() > 0)
         {
-            YS_LOG_FUNC("FOUND MyQuickActorFunction")
-            auto YFL = Cast<UYarnFunctionLibrary>(Lib->GetDefaultObject());
-            auto Result1 = YFL->CallFunction("MyQuickActorFunction", {FYarnBlueprintParam{"InParam", Yarn::Value(12.345)}}, {{"OutParam", Yarn::Value(true)}});
-            auto Result2 = YFL->CallFunction("MyQuickActorFunction", {FYarnBlueprintParam{"InParam", Yarn::Value(1234.5)}}, {{"OutParam", Yarn::Value(true)}});
+            FYarnVariableSerializer::GetInitialValues(ProgramData, InitialValues);
+        }
+
+        TArray<uint8> Result;
+        FYarnVariableSerializer::Save(Snapshot->Values, InitialValues, Result);
+        return Result;
+    });
+}
+
+
+bool UYarnSubsystem::LoadVariables(const TArray<uint8>& Data)
+{
+    TMap<FString, Yarn::Value> Loaded;
+    if (!FYarnVariableSerializer::Load(Data, Loaded))
+    {
+        return false;
+    }
+    Variables.Replace(Loaded);
+    YS_LOG("Loaded %d Yarn variables", Loaded.Num())
+    return true;
+}
 
-            YS_LOG_FUNC("Did we succeed? %d, %d", Result1.IsSet() && Result1->GetBooleanValue(), Result2.IsSet() && Result2->GetBooleanValue())
+
+int32 UYarnSubsystem::ImportVariables(const UDataTable* Table, bool bOverwriteExisting)
+{
+    if (!Table || !Table->GetRowStruct() || !Table->GetRowStruct()->IsChildOf(FYarnVariableRow::StaticStruct()))
+    {
+        YS_WARN("Can't import Yarn variables from %s: it must be a data table of FYarnVariableRow", Table ? *Table->GetPathName() : TEXT("null"))
+        return 0;
+    }
+
+    TArray<TPair<FString, TOptional<Yarn::Value>>> Changes;
+    Changes.Reserve(Table->GetRowMap().Num());
+    for (const auto& Row : Table->GetRowMap())
+    {
+        const FYarnVariableRow* VariableRow = reinterpret_cast<const FYarnVariableRow*>(Row.Value);
+        const FString Name = VariableRow->VariableName.IsEmpty() ? Row.Key.ToString() : VariableRow->VariableName;
+        if (!bOverwriteExisting && Variables.Contains(Name))
+        {
+            continue;
         }
-        if (Lib->FindFunctionByName(FName("MyAwesomeFunc")))
+
+        switch (VariableRow->Type)
         {
-            YS_LOG_FUNC("calling YarnFunctionLibrary %s->MyAwesomeFunc()", *Lib->GetName())
-            auto YFL = Cast<UYarnFunctionLibrary>(Lib->GetDefaultObject());
-            auto Result = YFL->CallFunction("MyAwesomeFunc", {FYarnBlueprintParam{"FirstInParam", Yarn::Value(true)}, FYarnBlueprintParam{"SecondInParam", Yarn::Value(12.345)}}, {{"OutParam", Yarn::Value(0.0)}});
-            if (Result.IsSet())
+        case EYarnVariableType::Bool:
+            Changes.Emplace(Name, Yarn::Value(VariableRow->Value.ToBool()));
+            break;
+        case EYarnVariableType::Number:
+            if (!VariableRow->Value.IsNumeric())
             {
-                YS_LOG_FUNC("Function returned: %f", Result->GetNumberValue())
+                YS_WARN("Skipping Yarn variable '%s' from %s: '%s' is not a number", *Name, *Table->GetName(), *VariableRow->Value)
+                continue;
             }
+            Changes.Emplace(Name, Yarn::Value(FCString::Atod(*VariableRow->Value)));
+            break;
+        case EYarnVariableType::String:
+            Changes.Emplace(Name, Yarn::Value(std::string(TCHAR_TO_UTF8(*VariableRow->Value))));
+            break;
         }
     }
 
+    // Journalled like any other change, so observers hear about seeded values
+    TArray<TOptional<Yarn::Value>> OldValues;
+    Variables.Apply(Changes, &OldValues);
+    for (int32 I = 0; I < Changes.Num(); I++)
+    {
+        RecordChange(Changes[I].Key, MoveTemp(OldValues[I]), Changes[I].Value, NAME_None);
+    }
+    YS_LOG("Imported %d Yarn variables from %s", Changes.Num(), *Table->GetName())
+    return Changes.Num();
 }
 
 
-void UYarnSubsystem::Deinitialize()
+void UYarnSubsystem::DumpVariables(const FString& Filter) const
 {
-    YS_LOG_FUNCSIG
-    Super::Deinitialize();
+    TArray<TPair<FString, Yarn::Value>> Sorted = Variables.Snapshot()->Values.Array();
+    Sorted.Sort([](const TPair<FString, Yarn::Value>& A, const TPair<FString, Yarn::Value>& B) { return A.Key < B.Key; });
+
+    YS_LOG("Yarn variables (%d): ", Sorted.Num())
+    FString VariablesString;
+    for (const auto& Var : Sorted)
+    {
+        if (!Filter.IsEmpty() && !Var.Key.Contains(Filter))
+        {
+            continue;
+        }
+        FString Val = UTF8_TO_TCHAR(Var.Value.ConvertToString().c_str());
+        VariablesString += FString::Printf(TEXT("    %s: %s,\n"), *Var.Key, *Val);
+    }
+    YS_LOG_CLEAN("%s", *VariablesString);
 }
 
 
-void UYarnSubsystem::SetValue(std::string name, bool value)
+void UYarnSubsystem::Tick(float DeltaTime)
 {
-    YS_LOG("Setting variable '%s' to '%hs'", UTF8_TO_TCHAR(name.c_str()), value ? "true" : "false")
-    Variables.FindOrAdd(FString(UTF8_TO_TCHAR(name.c_str()))) = Yarn::Value(value);
-    LogVariables();
+    FlushVariableChanges();
+
+    // Ticked even while paused (for the journal), but dialogue timers shouldn't run then.  The world's delta has its
+    // time dilation applied; ours doesn't.
+    const UWorld* World = GetGameInstance() ? GetGameInstance()->GetWorld() : nullptr;
+    TimerWheel.SetWorldPaused(World && World->IsPaused());
+    TimerWheel.Advance(World ? World->GetDeltaSeconds() : DeltaTime);
+
+    ResumeYieldedRunners();
 }
 
 
-void UYarnSubsystem::SetValue(std::string name, float value)
+ETickableTickType UYarnSubsystem::GetTickableTickType() const
 {
-    YS_LOG("Setting variable '%s' to '%f'", UTF8_TO_TCHAR(name.c_str()), value)
-    Variables.FindOrAdd(FString(UTF8_TO_TCHAR(name.c_str()))) = Yarn::Value(value);
-    LogVariables();
+    // The CDO should never tick
+    return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
 }
 
 
-void UYarnSubsystem::SetValue(std::string name, std::string value)
+bool UYarnSubsystem::IsTickable() const
 {
-    YS_LOG("Setting variable '%s' to '%s'", UTF8_TO_TCHAR(name.c_str()), UTF8_TO_TCHAR(value.c_str()))
-    Variables.FindOrAdd(FString(UTF8_TO_TCHAR(name.c_str()))) = Yarn::Value(value);
-    LogVariables();
+    if (TimerWheel.Num() > 0 || YieldedRunners.Num() > 0)
+    {
+        return true;
+    }
+    FScopeLock Lock(&JournalLock);
+    return Journal.Num() > 0;
 }
 
 
-bool UYarnSubsystem::HasValue(std::string name)
+TStatId UYarnSubsystem::GetStatId() const
 {
-    return Variables.Contains(FString(UTF8_TO_TCHAR(name.c_str())));
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UYarnSubsystem, STATGROUP_Tickables);
 }
 
 
-Yarn::Value UYarnSubsystem::GetValue(std::string name)
+bool UYarnSubsystem::GetExecutionBudget(Yarn::VirtualMachine::ExecutionBudget& OutBudget)
 {
-    return Variables.FindOrAdd(FString(UTF8_TO_TCHAR(name.c_str())));
+    OutBudget.MaxInstructions = CVarYarnInstructionBudget.GetValueOnGameThread();
+    OutBudget.MaxSeconds = CVarYarnTimeBudgetUs.GetValueOnGameThread() * 1e-6;
+    OutBudget.RunawayInstructionLimit = CVarYarnRunawayInstructionLimit.GetValueOnGameThread();
+
+    const double FrameBudget = CVarYarnFrameBudgetUs.GetValueOnGameThread() * 1e-6;
+    if (FrameBudget <= 0)
+    {
+        return true;
+    }
+
+    if (FrameBudgetFrame != GFrameCounter)
+    {
+        FrameBudgetFrame = GFrameCounter;
+        FrameBudgetRemaining = FrameBudget;
+    }
+    if (FrameBudgetRemaining <= 0)
+    {
+        return false;
+    }
+
+    OutBudget.MaxSeconds = OutBudget.MaxSeconds > 0 ? FMath::Min(OutBudget.MaxSeconds, FrameBudgetRemaining) : FrameBudgetRemaining;
+    return true;
 }
 
 
-void UYarnSubsystem::ClearValue(std::string name)
+void UYarnSubsystem::ChargeExecutionTime(double Seconds)
 {
-    YS_LOG("Clearing variable '%s'", UTF8_TO_TCHAR(name.c_str()))
-    Variables.Remove(FString(UTF8_TO_TCHAR(name.c_str())));
-    LogVariables();
+    if (FrameBudgetFrame == GFrameCounter)
+    {
+        FrameBudgetRemaining -= Seconds;
+    }
 }
 
-void UYarnSubsystem::LogVariables()
+
+void UYarnSubsystem::QueueYieldedRunner(ADialogueRunner* Runner)
 {
-    YS_LOG("Yarn variables: ")
-    FString VariablesString;
-    for (auto Var : Variables)
+    YieldedRunners.Emplace(Runner, GFrameCounter);
+}
+
+
+void UYarnSubsystem::ResumeYieldedRunners()
+{
+    // Only runners that yielded on an earlier frame; anything queued while resuming goes to the back for next frame
+    int32 NumDue = 0;
+    while (NumDue < YieldedRunners.Num() && YieldedRunners[NumDue].Value != GFrameCounter)
     {
-        FString Val = UTF8_TO_TCHAR(Var.Value.ConvertToString().c_str());
-        VariablesString += FString::Printf(TEXT("    %s: %s,\n"), *Var.Key, *Val);
+        NumDue++;
+    }
+    if (NumDue == 0)
+    {
+        return;
+    }
+
+    TArray<TWeakObjectPtr<ADialogueRunner>, TInlineAllocator<8>> Due;
+    for (int32 i = 0; i < NumDue; i++)
+    {
+        Due.Add(YieldedRunners[i].Key);
+    }
+    YieldedRunners.RemoveAt(0, NumDue);
+
+    for (const TWeakObjectPtr<ADialogueRunner>& WeakRunner : Due)
+    {
+        if (ADialogueRunner* Runner = WeakRunner.Get())
+        {
+            Runner->ResumeAfterYield();
+        }
     }
-    YS_LOG_CLEAN("%s", *VariablesString);
 }
 
 
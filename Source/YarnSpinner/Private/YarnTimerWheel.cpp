@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnTimerWheel.h"
+
+#include "Algo/Sort.h"
+#include "Misc/YSLogging.h"
+
+
+FYarnTimerWheel::FYarnTimerWheel()
+{
+    SlotHeads.Init(INDEX_NONE, NumSlots);
+}
+
+
+FYarnTimerHandle FYarnTimerWheel::Schedule(double DelaySeconds, TFunction<void()> Callback, const UObject* Owner)
+{
+    uint64 DelayTicks = static_cast<uint64>(FMath::CeilToDouble(FMath::Max(DelaySeconds, 0.0) / TickSeconds));
+    if (DelayTicks > MaxDelayTicks)
+    {
+        YS_WARN("Yarn timer of %.0f seconds is longer than the timer wheel's range; clamping it", DelaySeconds)
+        DelayTicks = MaxDelayTicks;
+    }
+
+    FTimer Timer;
+    Timer.Callback = MoveTemp(Callback);
+    Timer.Owner = FObjectKey(Owner);
+    // Never due on the tick that's already been processed
+    Timer.ExpireTick = CurrentTick + FMath::Max<uint64>(DelayTicks, 1);
+    Timer.Serial = NextSerial++;
+
+    FYarnTimerHandle Handle;
+    Handle.Index = Timers.Add(MoveTemp(Timer));
+    Handle.Serial = Timers[Handle.Index].Serial;
+    Link(Handle.Index);
+    return Handle;
+}
+
+
+bool FYarnTimerWheel::Cancel(FYarnTimerHandle& Handle)
+{
+    if (!Find(Handle))
+    {
+        Handle.Invalidate();
+        return false;
+    }
+
+    Unlink(Handle.Index);
+    Timers.RemoveAt(Handle.Index);
+    Handle.Invalidate();
+    return true;
+}
+
+
+int32 FYarnTimerWheel::CancelAll(const UObject* Owner)
+{
+    const FObjectKey OwnerKey(Owner);
+    TArray<int32, TInlineAllocator<16>> Cancelled;
+    for (auto It = Timers.CreateConstIterator(); It; ++It)
+    {
+        if (It->Owner == OwnerKey)
+        {
+            Cancelled.Add(It.GetIndex());
+        }
+    }
+    for (const int32 Index : Cancelled)
+    {
+        Unlink(Index);
+        Timers.RemoveAt(Index);
+    }
+    return Cancelled.Num();
+}
+
+
+void FYarnTimerWheel::Advance(double DeltaSeconds)
+{
+    if (IsPaused() || Timers.Num() == 0)
+    {
+        // Nothing to fire, so there's no point keeping time either; the next timer is relative to now
+        Accumulator = 0;
+        return;
+    }
+
+    Accumulator += DeltaSeconds * TimeDilation;
+    while (Accumulator >= TickSeconds && Timers.Num() > 0)
+    {
+        Accumulator -= TickSeconds;
+        Tick();
+    }
+}
+
+
+double FYarnTimerWheel::GetRemaining(const FYarnTimerHandle& Handle) const
+{
+    const FTimer* Timer = Find(Handle);
+    if (!Timer)
+    {
+        return -1;
+    }
+    return (Timer->ExpireTick - CurrentTick) * TickSeconds - Accumulator;
+}
+
+
+const FYarnTimerWheel::FTimer* FYarnTimerWheel::Find(const FYarnTimerHandle& Handle) const
+{
+    if (!Handle.IsValid() || !Timers.IsValidIndex(Handle.Index) || Timers[Handle.Index].Serial != Handle.Serial)
+    {
+        return nullptr;
+    }
+    return &Timers[Handle.Index];
+}
+
+
+void FYarnTimerWheel::Link(int32 Index)
+{
+    FTimer& Timer = Timers[Index];
+    const uint64 Delta = Timer.ExpireTick - CurrentTick;
+
+    int32 Slot;
+    if (Delta < Level0Slots)
+    {
+        Slot = Timer.ExpireTick & (Level0Slots - 1);
+    }
+    else
+    {
+        int32 Level = 1;
+        while (Level < NumLevels - 1 && Delta >= (uint64(1) << (Level0Bits + Level * LevelNBits)))
+        {
+            Level++;
+        }
+        const int32 Shift = Level0Bits + (Level - 1) * LevelNBits;
+        Slot = Level0Slots + (Level - 1) * LevelNSlots + ((Timer.ExpireTick >> Shift) & (LevelNSlots - 1));
+    }
+
+    Timer.Slot = Slot;
+    Timer.Prev = INDEX_NONE;
+    Timer.Next = SlotHeads[Slot];
+    if (Timer.Next != INDEX_NONE)
+    {
+        Timers[Timer.Next].Prev = Index;
+    }
+    SlotHeads[Slot] = Index;
+}
+
+
+void FYarnTimerWheel::Unlink(int32 Index)
+{
+    FTimer& Timer = Timers[Index];
+    if (Timer.Prev != INDEX_NONE)
+    {
+        Timers[Timer.Prev].Next = Timer.Next;
+    }
+    else
+    {
+        SlotHeads[Timer.Slot] = Timer.Next;
+    }
+    if (Timer.Next != INDEX_NONE)
+    {
+        Timers[Timer.Next].Prev = Timer.Prev;
+    }
+    Timer.Slot = Timer.Prev = Timer.Next = INDEX_NONE;
+}
+
+
+void FYarnTimerWheel::Cascade(int32 Level, int32 SlotInLevel)
+{
+    const int32 Slot = Level0Slots + (Level - 1) * LevelNSlots + SlotInLevel;
+    int32 Index = SlotHeads[Slot];
+    SlotHeads[Slot] = INDEX_NONE;
+    while (Index != INDEX_NONE)
+    {
+        const int32 Next = Timers[Index].Next;
+        Link(Index);
+        Index = Next;
+    }
+}
+
+
+void FYarnTimerWheel::FireSlot(int32 Slot)
+{
+    // Snapshot the slot first: callbacks may schedule or cancel timers, including ones in this slot
+    TArray<TPair<int32, uint32>, TInlineAllocator<16>> Due;
+    for (int32 Index = SlotHeads[Slot]; Index != INDEX_NONE; Index = Timers[Index].Next)
+    {
+        Due.Emplace(Index, Timers[Index].Serial);
+    }
+    // Timers scheduled for the same tick fire in the order they were scheduled.  The slot's list can't be relied on
+    // for that, as cascading re-files timers from the higher levels in front of ones already in the slot.
+    Algo::SortBy(Due, &TPair<int32, uint32>::Value);
+
+    for (const TPair<int32, uint32>& Entry : Due)
+    {
+        const int32 Index = Entry.Key;
+        // Cancelled by an earlier callback
+        if (!Timers.IsValidIndex(Index) || Timers[Index].Serial != Entry.Value)
+        {
+            continue;
+        }
+        Unlink(Index);
+        TFunction<void()> Callback = MoveTemp(Timers[Index].Callback);
+        Timers.RemoveAt(Index);
+        if (Callback)
+        {
+            Callback();
+        }
+    }
+}
+
+
+void FYarnTimerWheel::Tick()
+{
+    CurrentTick++;
+
+    // Each time a level wraps, the next slot up is close enough to be spread over the levels below it
+    const int32 Level0Index = CurrentTick & (Level0Slots - 1);
+    if (Level0Index == 0)
+    {
+        for (int32 Level = 1; Level < NumLevels; Level++)
+        {
+            const int32 Shift = Level0Bits + (Level - 1) * LevelNBits;
+            const int32 LevelIndex = (CurrentTick >> Shift) & (LevelNSlots - 1);
+            Cascade(Level, LevelIndex);
+            if (LevelIndex != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    FireSlot(Level0Index);
+}
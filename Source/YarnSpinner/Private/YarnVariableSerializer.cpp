@@ -0,0 +1,325 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnVariableSerializer.h"
+
+#include "Misc/YSLogging.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace
+{
+    enum class EEntryType : uint8
+    {
+        String,
+        Number,
+        False,
+        True,
+        // Non-negative whole numbers, stored packed instead of as a double
+        Integer,
+    };
+
+
+    std::string ToUTF8(const FString& String)
+    {
+        const FTCHARToUTF8 Converted(*String);
+        return std::string(Converted.Get(), Converted.Length());
+    }
+
+
+    void WriteString(FArchive& Ar, const std::string& String)
+    {
+        uint32 Length = String.size();
+        Ar.SerializeIntPacked(Length);
+        Ar.Serialize(const_cast<char*>(String.data()), Length);
+    }
+
+
+    bool ReadString(FArchive& Ar, std::string& OutString)
+    {
+        uint32 Length = 0;
+        Ar.SerializeIntPacked(Length);
+        if (Ar.IsError() || Length > Ar.TotalSize() - Ar.Tell())
+        {
+            return false;
+        }
+        OutString.resize(Length);
+        Ar.Serialize(&OutString[0], Length);
+        return !Ar.IsError();
+    }
+
+
+    bool IsPackableInteger(double Number)
+    {
+        return Number >= 0 && Number <= MAX_uint32 && FMath::TruncToDouble(Number) == Number;
+    }
+}
+
+
+void FYarnVariableSerializer::GetInitialValues(const Yarn::Program& Program, TMap<FString, Yarn::Value>& OutValues)
+{
+    OutValues.Reserve(OutValues.Num() + Program.initial_values_size());
+    for (const auto& InitialValue : Program.initial_values())
+    {
+        const FString Name = UTF8_TO_TCHAR(InitialValue.first.c_str());
+        const Yarn::Operand& Operand = InitialValue.second;
+        switch (Operand.value_case())
+        {
+        case Yarn::Operand::ValueCase::kBoolValue:
+            OutValues.Add(Name, Yarn::Value(Operand.bool_value()));
+            break;
+        case Yarn::Operand::ValueCase::kStringValue:
+            OutValues.Add(Name, Yarn::Value(Operand.string_value()));
+            break;
+        case Yarn::Operand::ValueCase::kFloatValue:
+            OutValues.Add(Name, Yarn::Value(Operand.float_value()));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+
+bool FYarnVariableSerializer::GetInitialValues(const TArray<uint8>& ProgramData, TMap<FString, Yarn::Value>& OutValues)
+{
+    Yarn::Program Program;
+    if (!Program.ParsePartialFromArray(ProgramData.GetData(), ProgramData.Num()))
+    {
+        YS_WARN("Could not parse Yarn program to read its initial variable values")
+        return false;
+    }
+    GetInitialValues(Program, OutValues);
+    return true;
+}
+
+
+void FYarnVariableSerializer::Save(const TMap<FString, Yarn::Value>& Values, const TMap<FString, Yarn::Value>& Baseline, TArray<uint8>& OutBytes)
+{
+    struct FEntry
+    {
+        uint32 Name;
+        EEntryType Type;
+        uint32 Index;
+        double Number;
+    };
+
+    std::vector<std::string> Strings;
+    std::unordered_map<std::string, uint32> StringIndices;
+    auto Intern = [&Strings, &StringIndices](std::string String) -> uint32
+    {
+        auto Existing = StringIndices.find(String);
+        if (Existing != StringIndices.end())
+        {
+            return Existing->second;
+        }
+        const uint32 Index = Strings.size();
+        StringIndices.emplace(String, Index);
+        Strings.push_back(MoveTemp(String));
+        return Index;
+    };
+
+    TArray<FEntry> Entries;
+    Entries.Reserve(Values.Num());
+    for (const auto& Variable : Values)
+    {
+        const Yarn::Value* Initial = Baseline.Find(Variable.Key);
+        if (Initial && ValuesEqual(*Initial, Variable.Value))
+        {
+            continue;
+        }
+
+        FEntry Entry{Intern(ToUTF8(Variable.Key)), EEntryType::Number, 0, 0};
+        switch (Variable.Value.GetType())
+        {
+        case Yarn::Value::STRING:
+            Entry.Type = EEntryType::String;
+            Entry.Index = Intern(Variable.Value.stringValue);
+            break;
+        case Yarn::Value::BOOL:
+            Entry.Type = Variable.Value.boolean ? EEntryType::True : EEntryType::False;
+            break;
+        case Yarn::Value::NUMBER:
+            if (IsPackableInteger(Variable.Value.number))
+            {
+                Entry.Type = EEntryType::Integer;
+                Entry.Index = static_cast<uint32>(Variable.Value.number);
+            }
+            else
+            {
+                Entry.Number = Variable.Value.number;
+            }
+            break;
+        }
+        Entries.Add(Entry);
+    }
+
+    OutBytes.Reset();
+    FMemoryWriter Ar(OutBytes);
+
+    uint32 Header[2] = {Magic, FormatVersion};
+    Ar << Header[0] << Header[1];
+
+    uint32 NumStrings = Strings.size();
+    Ar.SerializeIntPacked(NumStrings);
+    for (const std::string& String : Strings)
+    {
+        WriteString(Ar, String);
+    }
+
+    uint32 NumEntries = Entries.Num();
+    Ar.SerializeIntPacked(NumEntries);
+    for (FEntry& Entry : Entries)
+    {
+        Ar.SerializeIntPacked(Entry.Name);
+        uint8 Type = static_cast<uint8>(Entry.Type);
+        Ar << Type;
+        switch (Entry.Type)
+        {
+        case EEntryType::String:
+        case EEntryType::Integer:
+            Ar.SerializeIntPacked(Entry.Index);
+            break;
+        case EEntryType::Number:
+            Ar << Entry.Number;
+            break;
+        default:
+            break;
+        }
+    }
+
+    YS_VERBOSE("Saved %d of %d Yarn variables (%d unique strings) in %d bytes", Entries.Num(), Values.Num(), NumStrings, OutBytes.Num())
+}
+
+
+bool FYarnVariableSerializer::Load(const TArray<uint8>& Bytes, TMap<FString, Yarn::Value>& OutValues)
+{
+    OutValues.Reset();
+
+    FMemoryReader Ar(Bytes);
+    uint32 Header[2] = {0, 0};
+    Ar << Header[0] << Header[1];
+    if (Ar.IsError() || Header[0] != Magic)
+    {
+        YS_WARN("Not a Yarn variable save")
+        return false;
+    }
+    if (Header[1] > FormatVersion)
+    {
+        YS_WARN("Yarn variable save has format version %u, but only versions up to %u are supported", Header[1], FormatVersion)
+        return false;
+    }
+
+    // Every string takes at least one byte, so anything larger than the remaining data is corrupt
+    uint32 NumStrings = 0;
+    Ar.SerializeIntPacked(NumStrings);
+    if (Ar.IsError() || NumStrings > Ar.TotalSize() - Ar.Tell())
+    {
+        YS_WARN("Yarn variable save is corrupt (bad string table size)")
+        return false;
+    }
+    std::vector<std::string> Strings(NumStrings);
+    for (std::string& String : Strings)
+    {
+        if (!ReadString(Ar, String))
+        {
+            YS_WARN("Yarn variable save is corrupt (truncated string table)")
+            return false;
+        }
+    }
+
+    uint32 NumEntries = 0;
+    Ar.SerializeIntPacked(NumEntries);
+    if (Ar.IsError() || NumEntries > Ar.TotalSize() - Ar.Tell())
+    {
+        YS_WARN("Yarn variable save is corrupt (bad entry count)")
+        return false;
+    }
+    OutValues.Reserve(NumEntries);
+
+    uint32 NumRead = 0;
+    for (; NumRead < NumEntries; NumRead++)
+    {
+        uint32 Name = 0;
+        uint8 Type = 0;
+        Ar.SerializeIntPacked(Name);
+        Ar << Type;
+        if (Ar.IsError() || Name >= NumStrings)
+        {
+            Ar.SetError();
+            break;
+        }
+
+        Yarn::Value Value;
+        uint32 Index = 0;
+        double Number = 0;
+        switch (static_cast<EEntryType>(Type))
+        {
+        case EEntryType::String:
+            Ar.SerializeIntPacked(Index);
+            if (Index >= NumStrings)
+            {
+                Ar.SetError();
+                break;
+            }
+            Value = Yarn::Value(Strings[Index]);
+            break;
+        case EEntryType::Number:
+            Ar << Number;
+            Value = Yarn::Value(Number);
+            break;
+        case EEntryType::False:
+            Value = Yarn::Value(false);
+            break;
+        case EEntryType::True:
+            Value = Yarn::Value(true);
+            break;
+        case EEntryType::Integer:
+            Ar.SerializeIntPacked(Index);
+            Value = Yarn::Value(static_cast<double>(Index));
+            break;
+        default:
+            Ar.SetError();
+            break;
+        }
+        if (Ar.IsError())
+        {
+            break;
+        }
+
+        OutValues.Add(UTF8_TO_TCHAR(Strings[Name].c_str()), MoveTemp(Value));
+    }
+
+    // Never hand back part of a save; it would replace every variable
+    if (Ar.IsError() || NumRead < NumEntries)
+    {
+        YS_WARN("Yarn variable save is corrupt (bad entry)")
+        OutValues.Reset();
+        return false;
+    }
+    return true;
+}
+
+
+bool FYarnVariableSerializer::ValuesEqual(const Yarn::Value& A, const Yarn::Value& B)
+{
+    if (A.GetType() != B.GetType())
+    {
+        return false;
+    }
+    switch (A.GetType())
+    {
+    case Yarn::Value::STRING:
+        return A.stringValue == B.stringValue;
+    case Yarn::Value::NUMBER:
+        return A.number == B.number;
+    case Yarn::Value::BOOL:
+        return A.boolean == B.boolean;
+    }
+    return false;
+}
@@ -0,0 +1,298 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnVariableStore.h"
+
+#include "Misc/ScopeRWLock.h"
+#include "Misc/YSLogging.h"
+
+
+bool FYarnVariableStore::Contains(const FString& Name) const
+{
+    const FShard& Shard = Shards[ShardIndex(Name)];
+    FReadScopeLock Lock(Shard.Lock);
+    return Shard.Values.Contains(Name);
+}
+
+
+TOptional<Yarn::Value> FYarnVariableStore::Find(const FString& Name) const
+{
+    const FShard& Shard = Shards[ShardIndex(Name)];
+    FReadScopeLock Lock(Shard.Lock);
+    if (const Yarn::Value* Value = Shard.Values.Find(Name))
+    {
+        return *Value;
+    }
+    return {};
+}
+
+
+TOptional<Yarn::Value> FYarnVariableStore::Set(const FString& Name, const Yarn::Value& Value)
+{
+    TOptional<Yarn::Value> OldValue;
+    FShard& Shard = Shards[ShardIndex(Name)];
+    {
+        FWriteScopeLock Lock(Shard.Lock);
+        if (Yarn::Value* Existing = Shard.Values.Find(Name))
+        {
+            OldValue = *Existing;
+            *Existing = Value;
+        }
+        else
+        {
+            Shard.Values.Add(Name, Value);
+        }
+        Version.fetch_add(1, std::memory_order_acq_rel);
+    }
+    return OldValue;
+}
+
+
+TOptional<Yarn::Value> FYarnVariableStore::Remove(const FString& Name)
+{
+    TOptional<Yarn::Value> OldValue;
+    FShard& Shard = Shards[ShardIndex(Name)];
+    {
+        FWriteScopeLock Lock(Shard.Lock);
+        Yarn::Value Removed;
+        if (Shard.Values.RemoveAndCopyValue(Name, Removed))
+        {
+            OldValue = MoveTemp(Removed);
+            Version.fetch_add(1, std::memory_order_acq_rel);
+        }
+    }
+    return OldValue;
+}
+
+
+void FYarnVariableStore::Empty()
+{
+    LockAllForWrite();
+    for (FShard& Shard : Shards)
+    {
+        Shard.Values.Empty();
+    }
+    Version.fetch_add(1, std::memory_order_acq_rel);
+    UnlockAllForWrite();
+}
+
+
+int32 FYarnVariableStore::Num() const
+{
+    int32 Count = 0;
+    for (const FShard& Shard : Shards)
+    {
+        FReadScopeLock Lock(Shard.Lock);
+        Count += Shard.Values.Num();
+    }
+    return Count;
+}
+
+
+FYarnVariableSnapshotRef FYarnVariableStore::Snapshot() const
+{
+    TSharedRef<FYarnVariableSnapshot, ESPMode::ThreadSafe> Result = MakeShared<FYarnVariableSnapshot, ESPMode::ThreadSafe>();
+
+    LockAllForRead();
+    int32 Count = 0;
+    for (const FShard& Shard : Shards)
+    {
+        Count += Shard.Values.Num();
+    }
+    Result->Values.Reserve(Count);
+    for (const FShard& Shard : Shards)
+    {
+        Result->Values.Append(Shard.Values);
+    }
+    Result->Version = GetVersion();
+    UnlockAllForRead();
+
+    return Result;
+}
+
+
+void FYarnVariableStore::Apply(const TArray<TPair<FString, TOptional<Yarn::Value>>>& Changes, TArray<TOptional<Yarn::Value>>* OutOldValues)
+{
+    if (OutOldValues)
+    {
+        OutOldValues->Reset(Changes.Num());
+    }
+    if (Changes.Num() == 0)
+    {
+        return;
+    }
+
+    LockAllForWrite();
+    for (const TPair<FString, TOptional<Yarn::Value>>& Change : Changes)
+    {
+        TMap<FString, Yarn::Value>& Values = Shards[ShardIndex(Change.Key)].Values;
+        TOptional<Yarn::Value> OldValue;
+        if (const Yarn::Value* Existing = Values.Find(Change.Key))
+        {
+            OldValue = *Existing;
+        }
+
+        if (Change.Value.IsSet())
+        {
+            Values.Add(Change.Key, Change.Value.GetValue());
+        }
+        else
+        {
+            Values.Remove(Change.Key);
+        }
+
+        if (OutOldValues)
+        {
+            OutOldValues->Add(MoveTemp(OldValue));
+        }
+    }
+    Version.fetch_add(1, std::memory_order_acq_rel);
+    UnlockAllForWrite();
+}
+
+
+void FYarnVariableStore::Replace(const TMap<FString, Yarn::Value>& NewValues)
+{
+    LockAllForWrite();
+    for (FShard& Shard : Shards)
+    {
+        Shard.Values.Reset();
+    }
+    for (const auto& Entry : NewValues)
+    {
+        Shards[ShardIndex(Entry.Key)].Values.Add(Entry.Key, Entry.Value);
+    }
+    Version.fetch_add(1, std::memory_order_acq_rel);
+    UnlockAllForWrite();
+}
+
+
+void FYarnVariableStore::LockAllForRead() const
+{
+    for (const FShard& Shard : Shards)
+    {
+        Shard.Lock.ReadLock();
+    }
+}
+
+
+void FYarnVariableStore::UnlockAllForRead() const
+{
+    for (int32 I = NumShards - 1; I >= 0; --I)
+    {
+        Shards[I].Lock.ReadUnlock();
+    }
+}
+
+
+void FYarnVariableStore::LockAllForWrite()
+{
+    for (FShard& Shard : Shards)
+    {
+        Shard.Lock.WriteLock();
+    }
+}
+
+
+void FYarnVariableStore::UnlockAllForWrite()
+{
+    for (int32 I = NumShards - 1; I >= 0; --I)
+    {
+        Shards[I].Lock.WriteUnlock();
+    }
+}
+
+
+FYarnVariableSession::FYarnVariableSession(FYarnVariableStore& InStore)
+    : Store(InStore),
+      Snapshot(InStore.Snapshot())
+{
+}
+
+
+void FYarnVariableSession::SetValue(std::string Name, bool bValue)
+{
+    SetPending(FString(UTF8_TO_TCHAR(Name.c_str())), Yarn::Value(bValue));
+}
+
+
+void FYarnVariableSession::SetValue(std::string Name, float Value)
+{
+    SetPending(FString(UTF8_TO_TCHAR(Name.c_str())), Yarn::Value(Value));
+}
+
+
+void FYarnVariableSession::SetValue(std::string Name, std::string Value)
+{
+    SetPending(FString(UTF8_TO_TCHAR(Name.c_str())), Yarn::Value(Value));
+}
+
+
+bool FYarnVariableSession::HasValue(std::string Name)
+{
+    const FString Key(UTF8_TO_TCHAR(Name.c_str()));
+    if (const int32* Index = PendingIndex.Find(Key))
+    {
+        return PendingChanges[*Index].Value.IsSet();
+    }
+    return Snapshot->Values.Contains(Key);
+}
+
+
+Yarn::Value FYarnVariableSession::GetValue(std::string Name)
+{
+    const FString Key(UTF8_TO_TCHAR(Name.c_str()));
+    if (const int32* Index = PendingIndex.Find(Key))
+    {
+        const TOptional<Yarn::Value>& Pending = PendingChanges[*Index].Value;
+        return Pending.IsSet() ? Pending.GetValue() : Yarn::Value();
+    }
+    if (const Yarn::Value* Value = Snapshot->Values.Find(Key))
+    {
+        return *Value;
+    }
+    return Yarn::Value();
+}
+
+
+void FYarnVariableSession::ClearValue(std::string Name)
+{
+    SetPending(FString(UTF8_TO_TCHAR(Name.c_str())), {});
+}
+
+
+void FYarnVariableSession::Commit()
+{
+    check(IsInGameThread());
+
+    if (PendingChanges.Num() > 0)
+    {
+        YS_VERBOSE("Committing %d buffered variable change(s)", PendingChanges.Num())
+        Store.Apply(PendingChanges);
+        Discard();
+    }
+    Refresh();
+}
+
+
+void FYarnVariableSession::Discard()
+{
+    PendingChanges.Reset();
+    PendingIndex.Reset();
+}
+
+
+void FYarnVariableSession::Refresh()
+{
+    if (Store.GetVersion() != Snapshot->Version)
+    {
+        Snapshot = Store.Snapshot();
+    }
+}
+
+
+void FYarnVariableSession::SetPending(const FString& Name, TOptional<Yarn::Value> Value)
+{
+    PendingIndex.Add(Name, PendingChanges.Num());
+    PendingChanges.Emplace(Name, MoveTemp(Value));
+}
@@ -5,6 +5,10 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "YarnProject.h"
+#include "YarnNetTypes.h"
+#include "YarnDialogueListener.h"
+#include "YarnLinePrefetcher.h"
+#include "YarnTimerWheel.h"
 
 THIRD_PARTY_INCLUDES_START
 #include "YarnSpinnerCore/VirtualMachine.h"
@@ -16,6 +20,23 @@ THIRD_PARTY_INCLUDES_END
 
 DECLARE_DELEGATE(FYarnDialogueRunnerContinueDelegate);
 
+struct FYarnPendingFunctionResult;
+
+
+// A line sent to OnRunLineBatch, with the assets OnRunLine would have been given for it
+USTRUCT(BlueprintType)
+struct YARNSPINNER_API FYarnBatchedLine
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    TObjectPtr<class ULine> Line = nullptr;
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    TArray<TSoftObjectPtr<UObject>> LineAssets;
+};
+
+
 UCLASS()
 class YARNSPINNER_API ADialogueRunner : public AActor, public Yarn::ILogger, public Yarn::IVariableStorage
 {
@@ -27,6 +48,7 @@ public:
 
 protected:
     virtual void PreInitializeComponents() override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
     
 public:
     // Called every frame
@@ -41,6 +63,15 @@ public:
     UFUNCTION(BlueprintNativeEvent, Category="Dialogue Runner")
     void OnRunLine(class ULine* Line, const TArray<TSoftObjectPtr<UObject>>& LineAssets);
 
+    /**
+     * Receives consecutive lines together, each with its line assets, when MaxLinesPerBatch is set.  If
+     * bWaitingForContinue the batch filled up (or the frame's Yarn budget ran out) and the dialogue waits for
+     * ContinueDialogue as usual; otherwise it has already moved on to whatever came after the last line, such as
+     * options, a command or the end of the dialogue.
+     */
+    UFUNCTION(BlueprintNativeEvent, Category="Dialogue Runner")
+    void OnRunLineBatch(const TArray<FYarnBatchedLine>& Lines, bool bWaitingForContinue);
+
     UFUNCTION(BlueprintNativeEvent, Category="Dialogue Runner")
     void OnRunOptions(const TArray<class UOption*>& Options);
 
@@ -53,10 +84,32 @@ public:
     UFUNCTION(BlueprintCallable, Category="Dialogue Runner")
     void ContinueDialogue();
 
-    // TODO: add StopDialogue() blueprint callback
+    /** Stops the dialogue where it is, cancels any latent commands and calls OnDialogueEnded. */
+    UFUNCTION(BlueprintCallable, Category="Dialogue Runner")
+    void StopDialogue();
+
+    /**
+     * Call from a command to keep the dialogue waiting until the returned handle is completed, instead of calling
+     * ContinueDialogue.  CommandName is only used for logging; it defaults to the command being run.
+     */
+    UFUNCTION(BlueprintCallable, Category="Dialogue Runner")
+    class UYarnCommandHandle* BeginLatentCommand(FName CommandName = NAME_None);
+
+    // Backs the <<parallel>> and <<join>> commands
+    void BeginParallelCommands();
+    void JoinCommands();
+
+    // Runs gameplay tasks started by command libraries.  Created the first time it's needed.
+    class UGameplayTasksComponent* FindOrAddGameplayTasksComponent();
     
     UFUNCTION(BlueprintCallable, Category="Dialogue Runner")
     void SelectOption(UOption* Option);
+
+    // For native code that handled the options itself.  The selected option isn't run as a line.
+    void SelectOptionByID(int32 OptionID);
+
+    // Gets first refusal on lines and options.  Not owned by the runner; clear it before the listener goes away.
+    void SetDialogueListener(IYarnDialogueListener* Listener) { DialogueListener = Listener; }
     
     UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category="Dialogue Runner")
     UYarnProject* YarnProject;
@@ -64,8 +117,166 @@ public:
     UPROPERTY(EditInstanceOnly, BlueprintReadWrite, Category="Dialogue Runner")
     bool bRunSelectedOptionsAsLines = false;
 
+    // Latent commands still running after this many seconds are cancelled and the dialogue carries on.  0 waits forever.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Dialogue Runner", meta=(ClampMin=0, Units="Seconds"))
+    float LatentCommandTimeout = 0;
+
+    // Lines the dialogue reaches without anything else in between are collected and sent to OnRunLineBatch, up to this
+    // many at a time, instead of to OnRunLine one by one.  Below 2 turns batching off.  Not used by server-authoritative
+    // runners.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Dialogue Runner", meta=(ClampMin=0))
+    int32 MaxLinesPerBatch = 0;
+
+    // Reuse line and option objects instead of creating new ones for every line.  They're recycled once the dialogue
+    // is continued or an option selected, so don't hold on to them past that.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Dialogue Runner")
+    bool bReuseContentObjects = false;
+
+    // Run the VM on the server only.  Clients are sent line indices, option sets, commands and variable changes, and
+    // present them through the usual events; their option selections and continues go back to the server through the
+    // UYarnDialogueNetRelay on their PlayerController.  Clients don't create a VM at all.  Must be set before the runner
+    // initializes.  See "Testing server-authoritative dialogue" in the README for how to check it end to end.
+    UPROPERTY(EditInstanceOnly, BlueprintReadOnly, Category="Dialogue Runner|Networking")
+    bool bServerAuthoritative = false;
+
+    // Keep the assets for up to this many upcoming lines on each path the dialogue could take loaded ahead of time, so
+    // voice-over doesn't stall when it's reached.  0 turns prefetching off.  Only runners that present lines prefetch.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Dialogue Runner|Prefetch", meta=(ClampMin=0))
+    int32 PrefetchLines = 0;
+
+    // How many jumps to other nodes prefetching looks through.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Dialogue Runner|Prefetch", meta=(ClampMin=0))
+    int32 PrefetchNodeJumps = 2;
+
+    // How often lines' assets were already loaded when they were reached, and how much is being held for lines ahead.
+    UFUNCTION(BlueprintPure, Category="Dialogue Runner|Prefetch")
+    FYarnPrefetchStats GetPrefetchStats() const;
+
+protected:
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastDialogueStarted();
+
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastDialogueEnded();
+
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastRunLine(int32 Sequence, const FYarnNetLine& Line);
+
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastRunOptions(int32 Sequence, const TArray<FYarnNetOption>& Options);
+
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastRunCommand(int32 Sequence, const FString& Command, const TArray<FString>& Parameters);
+
+    UFUNCTION(NetMulticast, Reliable)
+    void MulticastVariableDeltas(const TArray<FYarnNetVariableDelta>& Deltas);
+
 private:
+    friend class UYarnDialogueNetRelay;
+    friend class UYarnCommandHandle;
+    friend class UYarnSubsystem;
+
+    // Lines run ahead through but not yet sent to OnRunLineBatch
+    UPROPERTY()
+    TArray<FYarnBatchedLine> LineBatch;
+    // Set by the line handler when it batched a line; ContinueDialogue then runs on to the next line itself
+    bool bRunOnFromBatchedLine = false;
+
+    void BatchLine(const Yarn::Line& Line);
+    void FlushLineBatch(bool bWaitingForContinue);
+
+    IYarnDialogueListener* DialogueListener = nullptr;
+
+    // Objects handed out since the dialogue last moved on, and ones ready for reuse, when bReuseContentObjects is set
+    UPROPERTY()
+    TArray<TObjectPtr<class ULine>> LinesInUse;
+    UPROPERTY()
+    TArray<TObjectPtr<class ULine>> FreeLines;
+    UPROPERTY()
+    TArray<TObjectPtr<class UOption>> OptionsInUse;
+    UPROPERTY()
+    TArray<TObjectPtr<class UOption>> FreeOptions;
+
+    class ULine* AcquireLine();
+    class UOption* AcquireOption();
+    void ReleaseContentObjects();
+
+    FYarnLineView MakeLineView(const Yarn::Line& Line) const;
+    void SelectOptionInternal(int32 OptionID, class ULine* OptionLine);
+
+    // Set while the dialogue is queued to carry on next frame after running out of budget
+    bool bYieldQueued = false;
+
+    void QueueYield();
+    void ResumeAfterYield();
+
+    // Latent commands that haven't completed yet
+    UPROPERTY()
+    TArray<TObjectPtr<class UYarnCommandHandle>> RunningCommands;
+
+    UPROPERTY()
+    TObjectPtr<class UGameplayTasksComponent> GameplayTasksComponent;
+
+    // Bumped by BeginLatentCommand, so the command handler can tell whether a command went latent
+    int32 LatentCommandsStarted = 0;
+    FName CurrentCommandName;
+    bool bRunCommandsInParallel = false;
+    bool bJoiningCommands = false;
+    // Set while a replicated command is being presented; latent commands begun then continue the dialogue when done
+    bool bPresentingNetCommand = false;
+
+    // Whether the VM has to stay parked for the running commands
+    bool IsWaitingOnCommands() const;
+    void ResolveCommandWait(int32 LatentCommandsStartedBefore);
+    void LatentCommandFinished(class UYarnCommandHandle* Handle);
+    void CancelLatentCommands();
+
+    // Identifies the async function result the VM is suspended on; 0 when it isn't waiting for one
+    uint32 AwaitedFunctionSerial = 0;
+    uint32 LastFunctionSerial = 0;
+    FYarnTimerHandle FunctionTimeoutHandle;
+
+    void AwaitFunctionResult(FName FunctionName, FYarnPendingFunctionResult&& Pending);
+    void ResumeFunction(uint32 Serial, const Yarn::Value& Value);
+    void CancelPendingFunction();
+
+    // Server: bumped whenever content is sent, so duplicate or stale client responses can be told apart.
+    // Client: the sequence of the last content received.
+    int32 ContentSequence = 0;
+
+    // Server: the options currently on offer, for running the selected one as a line
+    TArray<FYarnNetOption> CurrentNetOptions;
+
+    // Server: variable changes made by this runner that haven't been sent yet
+    TArray<FYarnNetVariableDelta> PendingVariableDeltas;
+
+    // By net mode rather than role: a runner placed in the level may not have had its role swapped yet when it
+    // initializes, and it decides then whether to create a VM
+    bool IsNetworkedClient() const { return bServerAuthoritative && GetNetMode() == NM_Client; }
+    bool ShouldPresentLocally() const { return GetNetMode() != NM_DedicatedServer; }
+
+    void HandleClientContinue(int32 Sequence);
+    void HandleClientSelectOption(int32 Sequence, int32 OptionID);
+
+    void PresentLine(const Yarn::Line& Line);
+    void PresentOptions(const Yarn::OptionSet& OptionSet);
+    void ApplySelectedOption(int32 OptionID, class ULine* OptionLine);
+
+    FYarnNetLine MakeNetLine(const Yarn::Line& Line) const;
+    Yarn::Line MakeYarnLine(const FYarnNetLine& Line) const;
+    void QueueVariableDelta(const FString& Name, const TOptional<Yarn::Value>& Value);
+    void FlushVariableDeltas();
+
     TUniquePtr<Yarn::VirtualMachine> VirtualMachine;
+    // The VM's nodes in the order of YarnProject->NodeNames, for looking them up through the project's node hash
+    TArray<const Yarn::Node*> NodesByIndex;
+
+    // Reads the VM's program, so must be destroyed before the VM
+    TUniquePtr<FYarnLinePrefetcher> Prefetcher;
+    // Loads the assets for the lines within reach of the given instruction in the current node.  KeepLine is the index
+    // of the line just reached, if any, and Destinations the labels of the options on offer.
+    void UpdatePrefetch(int32 ProgramCounter, int32 KeepLine = INDEX_NONE, TArrayView<const std::string> Destinations = {});
+    void ReleasePrefetch();
 
     TUniquePtr<Yarn::Library> Library;
 
@@ -84,12 +295,17 @@ private:
 
     virtual void ClearValue(std::string Name) override;
 
+    void SetVariable(const FString& Name, const Yarn::Value& Value);
+
     FString GetLine(FName LineID, FName Language);
 
     UPROPERTY()
     FString Blah;
 
     class UYarnSubsystem* YarnSubsystem() const;
+
+    // Name of the node the VM is in, for tagging variable changes
+    FName GetCurrentNodeName() const;
     
     void GetDisplayTextForLine(class ULine* Line, const Yarn::Line& YarnLine);
 };
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Class.h"
+#include "YarnSpinnerCore/Value.h"
+
+
+class FObjectPropertyBase;
+class FProperty;
+struct FYarnBlueprintParam;
+
+
+/**
+ * Everything needed to call one Blueprint function or command: the resolved UFunction, where each Yarn argument goes
+ * in its parameter struct and how to convert it, and a parameter buffer that's reused between calls.
+ *
+ * Plans are built once when a function is registered, so a mismatch between the types in the .ysls file and the
+ * Blueprint's actual parameters is reported then rather than on every call.
+ */
+class YARNSPINNER_API FYarnBlueprintCallPlan
+{
+public:
+    FYarnBlueprintCallPlan() = default;
+    ~FYarnBlueprintCallPlan();
+
+    FYarnBlueprintCallPlan(const FYarnBlueprintCallPlan&) = delete;
+    FYarnBlueprintCallPlan& operator=(const FYarnBlueprintCallPlan&) = delete;
+
+    // Resolves the function and its parameters on the given class.  Logs and returns false if anything doesn't match.
+    // Commands also get their "DialogueRunner" parameter resolved.
+    bool Build(const UClass* Class, FName FunctionName, const TArray<FYarnBlueprintParam>& InParams, const FYarnBlueprintParam* ReturnParam, bool bIsCommand);
+
+    bool IsValid() const { return Function.IsValid(); }
+    int32 GetParamCount() const { return Params.Num(); }
+
+    // Calls the function on Target.  Arguments must be in declaration order.  OutResult is only written if the plan
+    // has a return value.
+    bool Call(UObject* Target, TArrayView<const Yarn::Value> Args, Yarn::Value* OutResult = nullptr, UObject* DialogueRunner = nullptr);
+
+private:
+    enum class EConversion : uint8
+    {
+        Bool,
+        Float,
+        Double,
+        Int,
+        String,
+    };
+
+    struct FParam
+    {
+        FProperty* Property = nullptr;
+        int32 Offset = 0;
+        EConversion Conversion = EConversion::Double;
+    };
+
+    FName Name;
+    TWeakObjectPtr<UFunction> Function;
+    TArray<FParam> Params;
+    TOptional<FParam> Return;
+    FObjectPropertyBase* DialogueRunnerProperty = nullptr;
+
+    // Sized for the function's parameter struct; constructed and destroyed around each call
+    uint8* Buffer = nullptr;
+    bool bBufferInUse = false;
+
+    bool ResolveParam(const UFunction* Func, const FYarnBlueprintParam& Param, FParam& OutParam) const;
+    void Invoke(UObject* Target, UFunction* Func, uint8* Memory, TArrayView<const Yarn::Value> Args, Yarn::Value* OutResult, UObject* DialogueRunner) const;
+};
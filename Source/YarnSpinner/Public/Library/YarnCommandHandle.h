@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Async/Future.h"
+#include "YarnTimerWheel.h"
+#include "YarnCommandHandle.generated.h"
+
+
+class ADialogueRunner;
+class UGameplayTask;
+
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FYarnCommandCancelledDelegate, class UYarnCommandHandle*, Handle);
+
+
+/**
+ * A command that's still running.  Get one from ADialogueRunner::BeginLatentCommand inside a command, and call Complete
+ * when the work is done instead of calling ContinueDialogue.  The dialogue waits for every running command unless they
+ * were started inside a <<parallel>> block, in which case it only waits for them at the next <<join>>.
+ *
+ * Handles are cancelled if the dialogue is stopped or restarted, or if they run longer than the runner's
+ * LatentCommandTimeout.  Completing a handle that's no longer running does nothing.
+ */
+UCLASS(BlueprintType, ClassGroup = (YarnSpinner))
+class YARNSPINNER_API UYarnCommandHandle : public UObject
+{
+    GENERATED_BODY()
+
+public:
+    UFUNCTION(BlueprintCallable, Category="Yarn Command")
+    void Complete();
+
+    UFUNCTION(BlueprintPure, Category="Yarn Command")
+    bool IsRunning() const { return bRunning; }
+
+    // The command's work should stop when this fires; the dialogue has already moved on.
+    UPROPERTY(BlueprintAssignable, Category="Yarn Command")
+    FYarnCommandCancelledDelegate OnCancelled;
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Command")
+    FName CommandName;
+
+    // Completes the handle on the game thread once the future is ready.  Futures can't be cancelled, so cancelling the
+    // handle just ignores the result.
+    void CompleteWhen(TFuture<void>&& Future);
+
+    // Completes the handle after Seconds on the Yarn subsystem's timer wheel, or straight away if Seconds isn't
+    // positive.  Cancelling the handle cancels the timer.
+    void CompleteAfter(float Seconds);
+
+private:
+    friend class ADialogueRunner;
+    friend class UYarnCommandLibrary;
+
+    TWeakObjectPtr<ADialogueRunner> DialogueRunner;
+    TWeakObjectPtr<UGameplayTask> Task;
+    FYarnTimerHandle TimeoutHandle;
+    FYarnTimerHandle CompletionHandle;
+    bool bRunning = false;
+    bool bParallel = false;
+    // Begun while presenting a replicated command, so completing it stands in for ContinueDialogue
+    bool bContinueWhenDone = false;
+
+    void Start(ADialogueRunner* Runner, FName Name, bool bInParallel, float Timeout);
+    void Cancel();
+    // Stops the handle's timers and marks it as done; returns false if it already was
+    bool Finish();
+    class UYarnSubsystem* GetYarnSubsystem() const;
+};
@@ -4,10 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "GameplayTaskOwnerInterface.h"
+#include "YarnSpinnerCore/Value.h"
 #include "YarnCommandLibrary.generated.h"
 
 
-struct FYarnBlueprintParam;
+class FYarnBlueprintCallPlan;
+class UYarnCommandHandle;
 
 
 UCLASS(Blueprintable, ClassGroup = (YarnSpinner))
@@ -21,7 +23,19 @@ public:
 
     static UYarnCommandLibrary* FromBlueprint(const UBlueprint* Blueprint);
 
-    void CallCommand(FName CommandName, TSoftObjectPtr<class ADialogueRunner> DialogueRunner, TArray<FYarnBlueprintParam> Args);
+    // Calls a command through a plan built for this library's class; arguments are in declaration order.
+    void CallCommand(FYarnBlueprintCallPlan& Plan, const TSoftObjectPtr<class ADialogueRunner>& DialogueRunner, TArrayView<const Yarn::Value> Args);
+
+    // Activates a gameplay task created with this library as its owner, and returns a handle that completes when the
+    // task ends.  Stopping the dialogue cancels the task.  Pass the dialogue runner the command was called with.
+    UFUNCTION(BlueprintCallable, Category="Yarn Command")
+    UYarnCommandHandle* RunTask(class UGameplayTask* Task, class ADialogueRunner* DialogueRunner);
+
+    // IGameplayTaskOwnerInterface.  Tasks are run by the tasks component of the dialogue runner whose command is
+    // executing when they're created.
+    virtual UGameplayTasksComponent* GetGameplayTasksComponent(const UGameplayTask& Task) const override;
+    virtual AActor* GetGameplayTaskOwner(const UGameplayTask* Task) const override;
+    virtual void OnGameplayTaskDeactivated(UGameplayTask& Task) override;
 
 protected:
     // Called when the game starts or when spawned
@@ -33,4 +47,9 @@ public:
 
 private:
     static void ContinueDialogue(const TSoftObjectPtr<class ADialogueRunner>& DialogueRunner);
+
+    // The runner whose command is being called right now
+    TWeakObjectPtr<class ADialogueRunner> CallingDialogueRunner;
+
+    TMap<TObjectKey<UGameplayTask>, TWeakObjectPtr<UYarnCommandHandle>> TaskHandles;
 };
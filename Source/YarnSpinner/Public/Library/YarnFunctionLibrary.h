@@ -8,6 +8,7 @@
 #include "YarnFunctionLibrary.generated.h"
 
 
+class FYarnBlueprintCallPlan;
 struct FYarnBlueprintFuncParam;
 
 
@@ -22,7 +23,11 @@ public:
 
     static UYarnFunctionLibrary* FromBlueprint(const UBlueprint* Blueprint);
 
-    TOptional<Yarn::Value> CallFunction(FName FunctionName, TArray<FYarnBlueprintParam> Args, TOptional<FYarnBlueprintParam> ReturnValue);
+    // Calls a function through a plan built for this library's class; arguments are in declaration order.
+    TOptional<Yarn::Value> CallFunction(FYarnBlueprintCallPlan& Plan, TArrayView<const Yarn::Value> Args);
+
+    // Looks the function up by name and builds a one-off plan.  Prefer the plan overload for anything called often.
+    TOptional<Yarn::Value> CallFunction(FName FunctionName, const TArray<FYarnBlueprintParam>& Args, const TOptional<FYarnBlueprintParam>& ReturnValue);
 
 protected:
     // Called when the game starts or when spawned
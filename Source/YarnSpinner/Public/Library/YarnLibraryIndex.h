@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "YarnVariableRow.h"
+#include "YarnLibraryIndex.generated.h"
+
+
+struct FYSLSAction;
+struct FYarnSpinnerLibraryData;
+
+
+USTRUCT()
+struct YARNSPINNER_API FYarnLibraryIndexParam
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    FName Name;
+
+    UPROPERTY()
+    EYarnVariableType Type = EYarnVariableType::Number;
+
+    bool operator==(const FYarnLibraryIndexParam& Other) const { return Name == Other.Name && Type == Other.Type; }
+};
+
+
+// One Blueprint function or command: its Yarn name, the generated class it lives on and its typed signature.
+USTRUCT()
+struct YARNSPINNER_API FYarnLibraryIndexEntry
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    FName Name;
+
+    UPROPERTY()
+    FSoftClassPath LibraryClass;
+
+    UPROPERTY()
+    TArray<FYarnLibraryIndexParam> Params;
+
+    UPROPERTY()
+    EYarnVariableType ReturnType = EYarnVariableType::String;
+
+    bool operator==(const FYarnLibraryIndexEntry& Other) const
+    {
+        return Name == Other.Name && LibraryClass == Other.LibraryClass && Params == Other.Params && ReturnType == Other.ReturnType;
+    }
+
+    static FYarnLibraryIndexEntry FromYSLS(const FYSLSAction& Action);
+};
+
+
+/**
+ * The Blueprint functions and commands from the .ysls file, in binary form.
+ *
+ * The editor saves this next to Library.ysls whenever it rewrites the .ysls file.  At runtime the registry loads it in
+ * a single package load instead of reading and parsing JSON and looking each library up in the asset registry.  Its
+ * soft class references also make sure every library Blueprint is cooked.
+ */
+UCLASS()
+class YARNSPINNER_API UYarnLibraryIndex : public UObject
+{
+    GENERATED_BODY()
+
+public:
+    UPROPERTY()
+    TArray<FYarnLibraryIndexEntry> Functions;
+
+    UPROPERTY()
+    TArray<FYarnLibraryIndexEntry> Commands;
+
+    // The index at FYarnAssetHelpers::LibraryIndexObjectPath, or null if there isn't one.
+    static UYarnLibraryIndex* Load();
+
+    // Replaces the contents with the Blueprint entries in Data.  Returns true if anything changed.
+    bool SetFromYSLS(const FYarnSpinnerLibraryData& Data);
+
+    static EYarnVariableType TypeFromYSLS(const FString& Type);
+};
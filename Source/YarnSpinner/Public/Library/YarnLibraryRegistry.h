@@ -4,11 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "UObject/Object.h"
+#include "Library/YarnBlueprintCallPlan.h"
 #include "YarnSpinnerCore/Value.h"
 #include "YarnLibraryRegistry.generated.h"
 
 
-struct FYSLSAction;
+struct FYarnLibraryIndexEntry;
+namespace Yarn { class Program; }
 const FName GYSFunctionReturnParamName = TEXT("Out");
 
 
@@ -58,7 +60,7 @@ struct YARNSPINNER_API FYarnStdLibFunction
 
     FName Name;
     int32 ExpectedParamCount = 0;
-    TFunction<Yarn::Value(TArray<Yarn::Value> Params)> Function;
+    TFunction<Yarn::Value(TArrayView<const Yarn::Value> Params)> Function;
 };
 
 
@@ -73,6 +75,19 @@ struct YARNSPINNER_API FYarnStdLibCommand
 };
 
 
+// A Blueprint function or command listed in the library index.  Its library isn't loaded until a program links against
+// it or it's first called.
+struct FYarnBlueprintLibEntry
+{
+    FYarnBlueprintLibFunction Detail;
+    FSoftClassPath LibraryClassPath;
+
+    UObject* Library = nullptr;
+    TUniquePtr<FYarnBlueprintCallPlan> Plan;
+    bool bResolveFailed = false;
+};
+
+
 /**
  * 
  */
@@ -88,32 +103,35 @@ public:
     bool HasFunction(const FName& Name) const;
     bool HasCommand(const FName& Name) const;
     int32 GetExpectedFunctionParamCount(const FName& Name) const;
-    Yarn::Value CallFunction(const FName& Name, TArray<Yarn::Value> Parameters) const;
-    void CallCommand(const FName& Name, TSoftObjectPtr<class ADialogueRunner> DialogueRunner, TArray<FString> UnprocessedParamStrings) const;
+    // If the function is async and OutPending is given, the returned value is a placeholder and OutPending receives
+    // the future result instead.
+    Yarn::Value CallFunction(const FName& Name, TArrayView<const Yarn::Value> Parameters, struct FYarnPendingFunctionResult* OutPending = nullptr);
+    void CallCommand(const FName& Name, TSoftObjectPtr<class ADialogueRunner> DialogueRunner, TArray<FString> UnprocessedParamStrings);
+
+    // Loads the libraries for every Blueprint function and command the program uses, so the first call to each doesn't
+    // hitch.  Libraries nothing links against are never loaded.
+    void LinkProgram(const Yarn::Program& Program);
 
 private:
-    // Blueprints that extend YarnFunctionLibrary
-    UPROPERTY()
-    TSet<UBlueprint*> FunctionLibraries; 
+    // Generated classes of the Yarn libraries loaded so far
     UPROPERTY()
-    TSet<UBlueprint*> CommandLibraries;
+    TSet<UClass*> LoadedLibraries;
 
     // A map of blueprints to a list of their function names
     // TMap<UBlueprint*, TArray<FName>> LibFunctions;
     // TMap<UBlueprint*, TArray<FName>> LibCommands;
     // A map of function names to lists of details of implementations
-    TMap<FName, FYarnBlueprintLibFunction> AllFunctions;
+    TMap<FName, FYarnBlueprintLibEntry> AllFunctions;
     TMap<FName, FYarnStdLibFunction> StdFunctions;
-    TMap<FName, FYarnBlueprintLibFunction> AllCommands;
+    TMap<FName, FYarnBlueprintLibEntry> AllCommands;
     TMap<FName, FYarnStdLibCommand> StdCommands;
 
-    FTimerHandle CommandTimerHandle;
+    bool bIndexLoaded = false;
 
-    static UBlueprint* GetYarnFunctionLibraryBlueprint(const FAssetData& AssetData);
-    static UBlueprint* GetYarnCommandLibraryBlueprint(const FAssetData& AssetData);
     void FindFunctionsAndCommands();
-    void AddFunction(const FYSLSAction& Func);
-    void AddCommand(const FYSLSAction& Cmd);
+    static void AddEntry(TMap<FName, FYarnBlueprintLibEntry>& Entries, const FYarnLibraryIndexEntry& IndexEntry);
+    // Loads the entry's library and builds its call plan, if that hasn't been done yet
+    bool ResolveEntry(FYarnBlueprintLibEntry& Entry, bool bIsCommand);
     
     void OnStartGameInstance(UGameInstance* GameInstance);
 
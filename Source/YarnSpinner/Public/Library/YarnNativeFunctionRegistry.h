@@ -0,0 +1,275 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "YarnSpinnerCore/Value.h"
+
+#include <string>
+#include <type_traits>
+#include <utility>
+
+
+struct FYSLSAction;
+
+
+// Conversions between Yarn values and the C++ types native functions can take and return.  Using any other type in a
+// registered function is a compile error.
+template<typename T>
+struct TYarnNativeArg;
+
+template<>
+struct TYarnNativeArg<bool>
+{
+    static constexpr const TCHAR* TypeName = TEXT("boolean");
+    static bool Matches(const Yarn::Value& Value) { return Value.IsBoolean(); }
+    static bool Get(const Yarn::Value& Value) { return Value.boolean; }
+    static Yarn::Value Make(bool bValue) { return Yarn::Value(bValue); }
+};
+
+template<>
+struct TYarnNativeArg<double>
+{
+    static constexpr const TCHAR* TypeName = TEXT("number");
+    static bool Matches(const Yarn::Value& Value) { return Value.IsNumber(); }
+    static double Get(const Yarn::Value& Value) { return Value.number; }
+    static Yarn::Value Make(double Value) { return Yarn::Value(Value); }
+};
+
+template<>
+struct TYarnNativeArg<float>
+{
+    static constexpr const TCHAR* TypeName = TEXT("number");
+    static bool Matches(const Yarn::Value& Value) { return Value.IsNumber(); }
+    static float Get(const Yarn::Value& Value) { return static_cast<float>(Value.number); }
+    static Yarn::Value Make(float Value) { return Yarn::Value(Value); }
+};
+
+template<>
+struct TYarnNativeArg<int32>
+{
+    static constexpr const TCHAR* TypeName = TEXT("number");
+    static bool Matches(const Yarn::Value& Value) { return Value.IsNumber(); }
+    static int32 Get(const Yarn::Value& Value) { return static_cast<int32>(Value.number); }
+    static Yarn::Value Make(int32 Value) { return Yarn::Value(Value); }
+};
+
+// Passed by reference straight from the VM's stack, so taking std::string never copies
+template<>
+struct TYarnNativeArg<std::string>
+{
+    static constexpr const TCHAR* TypeName = TEXT("string");
+    static bool Matches(const Yarn::Value& Value) { return Value.IsString(); }
+    static const std::string& Get(const Yarn::Value& Value) { return Value.stringValue; }
+    static Yarn::Value Make(const std::string& Value) { return Yarn::Value(Value); }
+};
+
+// Convenient, but converts from UTF-8 on every call
+template<>
+struct TYarnNativeArg<FString>
+{
+    static constexpr const TCHAR* TypeName = TEXT("string");
+    static bool Matches(const Yarn::Value& Value) { return Value.IsString(); }
+    static FString Get(const Yarn::Value& Value) { return UTF8_TO_TCHAR(Value.stringValue.c_str()); }
+    static Yarn::Value Make(const FString& Value) { return Yarn::Value(std::string(TCHAR_TO_UTF8(*Value))); }
+};
+
+
+/**
+ * A C++ function callable from Yarn scripts.
+ */
+struct YARNSPINNER_API FYarnNativeFunction
+{
+    FName Name;
+    FString Documentation;
+    TArray<const TCHAR*> ParamTypes;
+    const TCHAR* ReturnType = nullptr;
+
+    // Reads the arguments straight out of the span it's given; returns false if their count or types don't match.
+    TFunction<bool(TArrayView<const Yarn::Value> Args, Yarn::Value& OutResult)> Thunk;
+
+    // Set instead of Thunk for functions that return a TFuture.  The dialogue suspends until the future is ready, or
+    // until Timeout seconds have passed (if it's above 0), in which case TimeoutValue is used instead.
+    TFunction<bool(TArrayView<const Yarn::Value> Args, TFuture<Yarn::Value>& OutPending)> AsyncThunk;
+    float Timeout = 0;
+    Yarn::Value TimeoutValue;
+
+    bool IsAsync() const { return static_cast<bool>(AsyncThunk); }
+};
+
+
+// A function result that hasn't arrived yet, and what to use if it takes too long.
+struct FYarnPendingFunctionResult
+{
+    TFuture<Yarn::Value> Future;
+    float Timeout = 0;
+    Yarn::Value TimeoutValue;
+};
+
+
+namespace YarnNative
+{
+    template<typename R, typename... A, typename F, size_t... I>
+    bool CallWithArgs(F& Func, TArrayView<const Yarn::Value> Args, Yarn::Value& OutResult, std::index_sequence<I...>)
+    {
+        if (Args.Num() != sizeof...(A) || !(true && ... && TYarnNativeArg<A>::Matches(Args[I])))
+        {
+            return false;
+        }
+        OutResult = TYarnNativeArg<R>::Make(Func(TYarnNativeArg<A>::Get(Args[I])...));
+        return true;
+    }
+
+
+    template<typename R, typename... A, typename F, size_t... I>
+    bool CallAsyncWithArgs(F& Func, TArrayView<const Yarn::Value> Args, TFuture<Yarn::Value>& OutPending, std::index_sequence<I...>)
+    {
+        if (Args.Num() != sizeof...(A) || !(true && ... && TYarnNativeArg<A>::Matches(Args[I])))
+        {
+            return false;
+        }
+        OutPending = Func(TYarnNativeArg<A>::Get(Args[I])...).Then([](TFuture<R> Result)
+        {
+            return TYarnNativeArg<R>::Make(Result.Get());
+        });
+        return true;
+    }
+
+
+    template<typename R, typename... A, typename F>
+    FYarnNativeFunction MakeFunction(FName Name, F&& Func)
+    {
+        static_assert(!std::is_void<R>::value, "Yarn functions must return a bool, number or string");
+
+        FYarnNativeFunction Result;
+        Result.Name = Name;
+        (Result.ParamTypes.Add(TYarnNativeArg<A>::TypeName), ...);
+        Result.ReturnType = TYarnNativeArg<R>::TypeName;
+        Result.Thunk = [Func = Forward<F>(Func)](TArrayView<const Yarn::Value> Args, Yarn::Value& OutResult) mutable
+        {
+            return CallWithArgs<R, A...>(Func, Args, OutResult, std::index_sequence_for<A...>());
+        };
+        return Result;
+    }
+
+
+    template<typename R, typename... A, typename F>
+    FYarnNativeFunction MakeAsyncFunction(FName Name, F&& Func)
+    {
+        static_assert(!std::is_void<R>::value, "Yarn functions must return a bool, number or string");
+
+        FYarnNativeFunction Result;
+        Result.Name = Name;
+        (Result.ParamTypes.Add(TYarnNativeArg<A>::TypeName), ...);
+        Result.ReturnType = TYarnNativeArg<R>::TypeName;
+        Result.AsyncThunk = [Func = Forward<F>(Func)](TArrayView<const Yarn::Value> Args, TFuture<Yarn::Value>& OutPending) mutable
+        {
+            return CallAsyncWithArgs<R, A...>(Func, Args, OutPending, std::index_sequence_for<A...>());
+        };
+        return Result;
+    }
+
+
+    // The T in an async function's TFuture<T>
+    template<typename R>
+    struct TAsyncResult;
+
+    template<typename T>
+    struct TAsyncResult<TFuture<T>>
+    {
+        using Type = T;
+    };
+
+
+    // Deduces a callable's return and parameter types, for plain functions and non-generic lambdas
+    template<typename F>
+    struct TSignature : TSignature<decltype(&F::operator())> {};
+
+    template<typename R, typename... A>
+    struct TSignature<R(*)(A...)>
+    {
+        using ReturnType = std::decay_t<R>;
+
+        template<typename F>
+        static FYarnNativeFunction Make(FName Name, F&& Func)
+        {
+            return MakeFunction<std::decay_t<R>, std::decay_t<A>...>(Name, Forward<F>(Func));
+        }
+
+        template<typename F>
+        static FYarnNativeFunction MakeAsync(FName Name, F&& Func)
+        {
+            return MakeAsyncFunction<typename TAsyncResult<std::decay_t<R>>::Type, std::decay_t<A>...>(Name, Forward<F>(Func));
+        }
+    };
+
+    template<typename C, typename R, typename... A>
+    struct TSignature<R(C::*)(A...)> : TSignature<R(*)(A...)> {};
+
+    template<typename C, typename R, typename... A>
+    struct TSignature<R(C::*)(A...) const> : TSignature<R(*)(A...)> {};
+}
+
+
+/**
+ * Registry of Yarn functions written in C++.
+ *
+ * Parameter and return types are deduced from the function itself, so registering is a single call:
+ *
+ *     FYarnNativeFunctionRegistry::Get().Register(TEXT("clamp"), &Clamp);
+ *     FYarnNativeFunctionRegistry::Get().Register(TEXT("is_night"), [](double Hour) { return Hour < 6 || Hour > 20; });
+ *
+ * Calls read their arguments directly from the VM's value stack, with no intermediate array.  Register functions from
+ * your module's StartupModule (before any dialogue runs) and unregister them in ShutdownModule.  The editor adds every
+ * registered function to the .ysls file so they show up in the language server.
+ *
+ * Functions that can't answer straight away return a TFuture instead, and the dialogue waits for it without blocking
+ * the game thread:
+ *
+ *     FYarnNativeFunctionRegistry::Get().RegisterAsync(TEXT("has_save"), [](FString Slot) { return Async(EAsyncExecution::ThreadPool, [Slot] { return DoesSaveExist(Slot); }); }, 2.0f, false);
+ *
+ * Async functions must copy any std::string arguments they hold on to; the arguments only live until they return.
+ */
+class YARNSPINNER_API FYarnNativeFunctionRegistry
+{
+public:
+    static FYarnNativeFunctionRegistry& Get();
+
+    template<typename F>
+    void Register(FName Name, F&& Func, const FString& Documentation = FString())
+    {
+        FYarnNativeFunction Function = YarnNative::TSignature<std::decay_t<F>>::Make(Name, Forward<F>(Func));
+        Function.Documentation = Documentation;
+        Add(MoveTemp(Function));
+    }
+
+    // Registers a function returning TFuture<T>.  If the result takes longer than Timeout seconds (when above 0),
+    // the dialogue carries on with TimeoutValue instead.
+    template<typename F, typename T>
+    void RegisterAsync(FName Name, F&& Func, float Timeout, const T& TimeoutValue, const FString& Documentation = FString())
+    {
+        using FSignature = YarnNative::TSignature<std::decay_t<F>>;
+        using R = typename YarnNative::TAsyncResult<typename FSignature::ReturnType>::Type;
+
+        FYarnNativeFunction Function = FSignature::MakeAsync(Name, Forward<F>(Func));
+        Function.Documentation = Documentation;
+        Function.Timeout = Timeout;
+        Function.TimeoutValue = TYarnNativeArg<R>::Make(TimeoutValue);
+        Add(MoveTemp(Function));
+    }
+
+    void Unregister(FName Name);
+
+    const FYarnNativeFunction* Find(FName Name) const { return Functions.Find(Name); }
+
+    // Signatures of every registered function, in .ysls form.
+    void GetYSLSActions(TArray<FYSLSAction>& OutActions) const;
+
+    static const FString YSLSLanguage;
+
+private:
+    TMap<FName, FYarnNativeFunction> Functions;
+
+    void Add(FYarnNativeFunction&& Function);
+};
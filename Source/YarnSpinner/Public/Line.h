@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+#include "Misc/MarkupParser.h"
 #include "Line.generated.h"
 
 /**
@@ -18,6 +19,22 @@ public:
     UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category="Yarn Spinner")
     FName LineID;
 
+    // The line's text with any markup taken out
     UPROPERTY(BlueprintReadWrite, Category="Yarn Spinner")
     FText DisplayText;
+
+    // The markup taken out of DisplayText, with positions in DisplayText
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    TArray<FYarnMarkupAttribute> Attributes;
+
+    UFUNCTION(BlueprintPure, Category="Yarn Spinner")
+    bool TryGetAttribute(const FString& Name, FYarnMarkupAttribute& OutAttribute) const;
+
+    // The speaker's name, from a "Name: text" line or a [character name="..."] attribute.  Empty if there isn't one.
+    UFUNCTION(BlueprintPure, Category="Yarn Spinner")
+    FString GetCharacterName() const;
+
+    // DisplayText without the speaker's name.
+    UFUNCTION(BlueprintPure, Category="Yarn Spinner")
+    FText GetTextWithoutCharacterName() const;
 };
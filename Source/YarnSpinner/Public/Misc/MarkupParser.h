@@ -0,0 +1,149 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnPluralRules.h"
+#include "MarkupParser.generated.h"
+
+
+USTRUCT(BlueprintType)
+struct YARNSPINNER_API FYarnMarkupProperty
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    FString Name;
+
+    // As written, without quotes
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    FString Value;
+};
+
+
+/**
+ * A markup attribute such as [wave]...[/wave], covering Length characters of the line's text from Position.  Self-closing
+ * attributes like [pause/] have a length of zero.  The speaker's name at the start of a line ("Mae: Hi!") is a
+ * "character" attribute with a "name" property.
+ */
+USTRUCT(BlueprintType)
+struct YARNSPINNER_API FYarnMarkupAttribute
+{
+    GENERATED_BODY()
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    FString Name;
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int32 Position = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int32 Length = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    TArray<FYarnMarkupProperty> Properties;
+
+    const FString* FindProperty(FStringView PropertyName) const;
+};
+
+
+struct FMarkupParseResult
+{
+    // The text with the markup taken out
+    FString Text;
+    TArray<FYarnMarkupAttribute> Attributes;
+};
+
+
+/**
+ * Yarn markup: [name]...[/name] and [name/] attributes with optional properties ([name=value], [name a=1 b="two"]),
+ * [/] to close everything that's open, [nomarkup]...[/nomarkup], and \[, \] and \\ escapes.  Runs in a single pass.
+ *
+ * The replacement markers [select value=... a="..." other="..."/], [plural value=... one="..." other="..."/] and
+ * [ordinal value=... one="%st" two="%nd" other="%th"/] are replaced by the property that matches the value, with any %
+ * in it replaced by the value itself.  Plural and ordinal categories come from the culture's rules; without any,
+ * every number is "other".
+ */
+class YARNSPINNER_API FMarkupParser
+{
+public:
+    // Returns false, with the text copied unchanged and no attributes, if the markup is malformed.
+    static bool Parse(FStringView LineText, FMarkupParseResult& OutResult, const FYarnCultureRules* Rules = nullptr);
+
+    // True if the text has anything Parse would change.
+    static bool HasMarkup(FStringView LineText);
+};
+
+
+USTRUCT()
+struct YARNSPINNER_API FYarnMarkupSpan
+{
+    GENERATED_BODY()
+
+    // Index into the table's strings
+    UPROPERTY()
+    int32 Name = 0;
+
+    UPROPERTY()
+    int32 Position = 0;
+
+    UPROPERTY()
+    int32 Length = 0;
+
+    // Index of the first (name, value) pair in the table's properties
+    UPROPERTY()
+    int32 FirstProperty = 0;
+
+    UPROPERTY()
+    int32 NumProperties = 0;
+
+    bool operator==(const FYarnMarkupSpan& Other) const
+    {
+        return Name == Other.Name && Position == Other.Position && Length == Other.Length && FirstProperty == Other.FirstProperty && NumProperties == Other.NumProperties;
+    }
+};
+
+
+/**
+ * Markup for a whole set of lines, parsed on import.  Lines without substitutions are stored with their markup already
+ * taken out and their attributes kept here; lines with substitutions keep their markup, as it can't be parsed until the
+ * values are in, and have no attributes here.  Names and values are stored once however many lines use them.
+ */
+USTRUCT()
+struct YARNSPINNER_API FYarnMarkupTable
+{
+    GENERATED_BODY()
+
+    // Parses the markup out of every line it can, in place, and records the attributes.  Rules are for the lines' culture.
+    void Build(TArrayView<FString> InOutLines, const FYarnCultureRules* Rules = nullptr);
+    void Reset();
+
+    // Whether the table was built for this many lines.  Lines from a table that wasn't still contain their markup.
+    bool IsBuilt(int32 NumLines) const { return LineSpans.Num() == NumLines + 1; }
+
+    // Whether the line's text is stored with its markup still in, to be parsed after substitution.
+    static bool NeedsRuntimeParse(FStringView LineText);
+
+    int32 NumAttributes(int32 LineIndex) const;
+    void GetAttributes(int32 LineIndex, TArray<FYarnMarkupAttribute>& OutAttributes) const;
+
+    SIZE_T GetAllocatedSize() const;
+
+    bool operator==(const FYarnMarkupTable& Other) const
+    {
+        return LineSpans == Other.LineSpans && Spans == Other.Spans && Properties == Other.Properties && Strings == Other.Strings;
+    }
+
+private:
+    // Where each line's spans start, plus one entry for the end of the last line's
+    UPROPERTY()
+    TArray<int32> LineSpans;
+
+    UPROPERTY()
+    TArray<FYarnMarkupSpan> Spans;
+
+    // Pairs of indices into Strings: name, then value
+    UPROPERTY()
+    TArray<int32> Properties;
+
+    UPROPERTY()
+    TArray<FString> Strings;
+};
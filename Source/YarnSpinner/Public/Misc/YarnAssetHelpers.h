@@ -12,6 +12,17 @@ public:
     {
         return FPaths::Combine(FPaths::ProjectContentDir(), TEXT("YarnSpinner"), TEXT("Library.ysls"));
     }
+
+    // The binary form of the .ysls file's Blueprint entries, saved alongside it
+    static FString LibraryIndexPackageName()
+    {
+        return TEXT("/Game/YarnSpinner/YarnLibraryIndex");
+    }
+
+    static FString LibraryIndexObjectPath()
+    {
+        return LibraryIndexPackageName() + TEXT(".YarnLibraryIndex");
+    }
     
     template <class AssetClass>
     static TArray<FAssetData> FindAssetsInRegistry(const TSubclassOf<UObject> BaseClass = AssetClass::StaticClass());
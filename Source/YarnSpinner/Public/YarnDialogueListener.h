@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/MarkupParser.h"
+
+THIRD_PARTY_INCLUDES_START
+#include <string>
+THIRD_PARTY_INCLUDES_END
+
+
+class ADialogueRunner;
+
+
+/**
+ * A line as the dialogue delivered it.  Points into the runner's and the project's data, so it's only valid for the
+ * duration of the call it's passed to.
+ */
+struct FYarnLineView
+{
+    FName LineID;
+    // Index in the project's LineTable, or INDEX_NONE
+    int32 LineIndex = INDEX_NONE;
+    // The line's text in the current culture before substitutions.  Empty if the project doesn't have it, and always
+    // on dedicated servers.  See Markup.
+    FStringView Text;
+    // The markup parsed out of Text on import; get the line's attributes with Markup->GetAttributes(LineIndex, ...).
+    // Null if Text still contains its markup, as do lines with substitutions: parse those with FMarkupParser once
+    // they're substituted.
+    const FYarnMarkupTable* Markup = nullptr;
+    // UTF-8 values for {0}, {1} and so on
+    TArrayView<const std::string> Substitutions;
+};
+
+
+struct FYarnOptionView
+{
+    int32 OptionID = -1;
+    bool bIsAvailable = true;
+    FYarnLineView Line;
+};
+
+
+/**
+ * Native alternative to the dialogue runner's Blueprint events.  Lines and options it handles reach it as views, with
+ * no ULine or UOption objects created for them; anything it doesn't handle goes to the runner's events as usual.
+ * Continue with ADialogueRunner::ContinueDialogue and choose with ADialogueRunner::SelectOptionByID.
+ */
+class YARNSPINNER_API IYarnDialogueListener
+{
+public:
+    virtual ~IYarnDialogueListener() = default;
+
+    // Return true if the line was handled.
+    virtual bool HandleLine(ADialogueRunner& Runner, const FYarnLineView& Line) { return false; }
+    // Return true if the options were handled.
+    virtual bool HandleOptions(ADialogueRunner& Runner, TArrayView<const FYarnOptionView> Options) { return false; }
+};
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "YarnDialogueNetRelay.generated.h"
+
+
+/**
+ * Carries option selections and continue requests from clients to server-authoritative dialogue runners.
+ *
+ * Clients can only call server RPCs on actors they own, and a dialogue runner is usually shared by every player, so add
+ * this component to your PlayerController class and runners will route client input through it.
+ */
+UCLASS(ClassGroup=(YarnSpinner), meta=(BlueprintSpawnableComponent))
+class YARNSPINNER_API UYarnDialogueNetRelay : public UActorComponent
+{
+    GENERATED_BODY()
+
+public:
+    UYarnDialogueNetRelay();
+
+    UFUNCTION(Server, Reliable)
+    void ServerContinueDialogue(class ADialogueRunner* Runner, int32 Sequence);
+
+    UFUNCTION(Server, Reliable)
+    void ServerSelectOption(class ADialogueRunner* Runner, int32 Sequence, int32 OptionID);
+
+    // The relay on the local player's controller, if it has one.
+    static UYarnDialogueNetRelay* FindLocal(const UWorld* World);
+};
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/StreamableManager.h"
+#include <string>
+#include "YarnLinePrefetcher.generated.h"
+
+
+class UYarnProject;
+
+namespace Yarn
+{
+    class Program;
+    class Node;
+}
+
+
+USTRUCT(BlueprintType)
+struct YARNSPINNER_API FYarnPrefetchStats
+{
+    GENERATED_BODY()
+
+    // Lines with assets that were already loaded when the dialogue reached them
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int32 Hits = 0;
+
+    // Lines with assets that weren't, and will be loaded synchronously if they're used straight away
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int32 Misses = 0;
+
+    // Lines whose assets were requested, and lines whose assets were let go once the dialogue moved away from them
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int32 LinesRequested = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int32 LinesReleased = 0;
+
+    // Lines whose assets are being held now
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int32 LinesInWindow = 0;
+
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int32 AssetsResident = 0;
+
+    // Estimated memory used by the held assets
+    UPROPERTY(BlueprintReadOnly, Category="Yarn Spinner")
+    int64 ResidentBytes = 0;
+};
+
+
+/**
+ * Keeps the assets for the lines the dialogue could reach next loaded, so voice-over is resident before it plays.
+ *
+ * From the VM's position, the prefetcher walks the compiled program forward along every path: through lines, both
+ * sides of each branch, option destinations and jumps to other nodes, until each path has passed MaxLines lines or
+ * MaxNodeJumps jumps.  Assets for the lines it finds are requested asynchronously; assets for lines no longer in reach
+ * are released.  Jumps whose destination is only known at run time aren't followed.
+ */
+class YARNSPINNER_API FYarnLinePrefetcher
+{
+public:
+    // The program must outlive the prefetcher.
+    FYarnLinePrefetcher(const UYarnProject* InProject, const Yarn::Program& InProgram);
+    ~FYarnLinePrefetcher();
+
+    int32 MaxLines = 8;
+    int32 MaxNodeJumps = 2;
+
+    // Recomputes which lines are in reach from the instruction at ProgramCounter in the node, and from each of the
+    // option destinations (labels in the same node), then loads and releases assets to match.  KeepLine is the index
+    // of the line playing now, if any, and stays loaded until the next update.
+    void Update(const char* NodeName, int32 ProgramCounter, TArrayView<const std::string> OptionDestinations, int32 KeepLine);
+
+    // Counts a hit or a miss for a line the dialogue has just reached.
+    void RecordLine(int32 LineIndex);
+
+    void ReleaseAll();
+
+    FYarnPrefetchStats GetStats() const;
+
+private:
+    TWeakObjectPtr<const UYarnProject> Project;
+    const Yarn::Program& Program;
+    FStreamableManager StreamableManager;
+    // By line index
+    TMap<int32, TSharedPtr<FStreamableHandle>> Handles;
+    FYarnPrefetchStats Stats;
+
+    void CollectLines(const Yarn::Node& StartNode, int32 ProgramCounter, TArrayView<const std::string> OptionDestinations, TSet<int32>& OutLines) const;
+    void Release(TSharedPtr<FStreamableHandle>& Handle);
+};
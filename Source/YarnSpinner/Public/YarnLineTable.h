@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnPerfectHash.h"
+#include "Misc/MarkupParser.h"
+#include "YarnLineTable.generated.h"
+
+
+/**
+ * Every line in a Yarn project: the IDs in one buffer and the text in another, with the offset where each entry starts.
+ *
+ * Lines are sorted by ID (ignoring case, as FName does), and a line's position is its index everywhere else, for
+ * example in network messages and localised strings.  Lookups by ID go through a perfect hash built with the table and
+ * check the one ID it points at, so loading a project doesn't add every line ID to the FName table or allocate a string
+ * per line.  Tables saved before the hash existed fall back to a binary search until they're rebuilt.
+ *
+ * Markup is parsed out of the text when the table is built; see FYarnMarkupTable.
+ */
+USTRUCT()
+struct YARNSPINNER_API FYarnLineTable
+{
+    GENERATED_BODY()
+
+    // Replaces the table with the given ID -> text pairs.  Rules are for the text's culture, for its plural markup.
+    void Build(TArray<TPair<FString, FString>>&& Lines, const FYarnCultureRules* Rules = nullptr);
+    void Reset();
+
+    int32 Num() const { return FMath::Max(IDOffsets.Num() - 1, 0); }
+    bool IsValidIndex(int32 Index) const { return Index >= 0 && Index < Num(); }
+
+    // Index of the line, or INDEX_NONE if there's no such line.
+    int32 Find(FStringView LineID) const;
+    int32 Find(FName LineID) const;
+
+    FStringView GetID(int32 Index) const;
+    // Empty if the text was stripped from this build (see UYarnProject::bStripPresentationDataForServer).
+    FStringView GetText(int32 Index) const;
+    bool HasText() const { return TextOffsets.Num() > 0; }
+    // Null if the table was built before markup was parsed on import, in which case the text still contains it.
+    const FYarnMarkupTable* GetMarkup() const { return Markup.IsBuilt(Num()) ? &Markup : nullptr; }
+
+    // Drops the text and markup but keeps the IDs.
+    void StripText();
+    // Builds the hash if the table was saved without one.
+    void BuildHash();
+
+    SIZE_T GetAllocatedSize() const;
+    SIZE_T GetHashAllocatedSize() const { return Hash.GetAllocatedSize(); }
+
+private:
+    UPROPERTY()
+    FString IDs;
+
+    UPROPERTY()
+    TArray<int32> IDOffsets;
+
+    UPROPERTY()
+    FString Text;
+
+    UPROPERTY()
+    TArray<int32> TextOffsets;
+
+    UPROPERTY()
+    FYarnMarkupTable Markup;
+
+    UPROPERTY()
+    FYarnPerfectHash Hash;
+
+    int32 BinarySearch(FStringView LineID) const;
+};
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Misc/MarkupParser.h"
+#include "YarnLocalizedStrings.generated.h"
+
+
+/**
+ * Every line's text in one culture, stored as a single block of characters plus the offset where each line starts.
+ *
+ * Lines are in the order of the project's LineTable.  Lines without a translation were filled in on import from the
+ * culture's parents, and then from the base text, so a lookup never needs a fallback.  A project only loads the
+ * current culture's strings, and changing culture swaps them for the new culture's.  Markup is parsed out of the text on
+ * import, as in the project's LineTable.
+ */
+UCLASS()
+class YARNSPINNER_API UYarnLocalizedStrings : public UObject
+{
+    GENERATED_BODY()
+
+public:
+    UPROPERTY(VisibleAnywhere, Category="Yarn Spinner")
+    FName Culture;
+
+    // Every line's text back to back, without terminators
+    UPROPERTY()
+    FString Text;
+
+    // Where each line starts in Text, plus one entry for the end of the last line
+    UPROPERTY()
+    TArray<int32> Offsets;
+
+    UPROPERTY()
+    FYarnMarkupTable Markup;
+
+    int32 Num() const { return FMath::Max(Offsets.Num() - 1, 0); }
+
+    // The text of the line at LineIndex in the project's LineTable.  Empty if the index is out of range.
+    FStringView GetLine(int32 LineIndex) const;
+
+    // Null if the strings were built before markup was parsed on import, in which case the text still contains it.
+    const FYarnMarkupTable* GetMarkup() const { return Markup.IsBuilt(Num()) ? &Markup : nullptr; }
+
+    // Replaces the contents with the given lines, in project order.  Returns true if anything changed.
+    bool SetLines(FName InCulture, TArrayView<const FString> Lines, const FYarnCultureRules* Rules = nullptr);
+};
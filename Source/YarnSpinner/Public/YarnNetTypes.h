@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnSpinnerCore/Value.h"
+#include "YarnNetTypes.generated.h"
+
+
+/**
+ * A Yarn value in the form it's sent over the network.
+ */
+USTRUCT()
+struct YARNSPINNER_API FYarnNetValue
+{
+    GENERATED_BODY()
+
+    FYarnNetValue() = default;
+    explicit FYarnNetValue(const Yarn::Value& Value);
+
+    Yarn::Value ToValue() const;
+
+    Yarn::Value::ValueType Type = Yarn::Value::NUMBER;
+    FString String;
+    double Number = 0;
+    bool bBoolean = false;
+
+    bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FYarnNetValue> : public TStructOpsTypeTraitsBase2<FYarnNetValue>
+{
+    enum { WithNetSerializer = true };
+};
+
+
+/**
+ * A line sent by index into the project's line symbol table rather than by ID.
+ */
+USTRUCT()
+struct YARNSPINNER_API FYarnNetLine
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    int32 LineIndex = INDEX_NONE;
+
+    UPROPERTY()
+    TArray<FString> Substitutions;
+
+    bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FYarnNetLine> : public TStructOpsTypeTraitsBase2<FYarnNetLine>
+{
+    enum { WithNetSerializer = true };
+};
+
+
+USTRUCT()
+struct YARNSPINNER_API FYarnNetOption
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    FYarnNetLine Line;
+
+    UPROPERTY()
+    int32 OptionID = 0;
+
+    UPROPERTY()
+    bool bIsAvailable = true;
+
+    bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FYarnNetOption> : public TStructOpsTypeTraitsBase2<FYarnNetOption>
+{
+    enum { WithNetSerializer = true };
+};
+
+
+/**
+ * A change to one variable.  Variables declared in the program are sent by index into the project's variable symbol
+ * table; anything else falls back to its name.
+ */
+USTRUCT()
+struct YARNSPINNER_API FYarnNetVariableDelta
+{
+    GENERATED_BODY()
+
+    int32 VariableIndex = INDEX_NONE;
+    FString Name;
+    bool bCleared = false;
+    FYarnNetValue Value;
+
+    bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FYarnNetVariableDelta> : public TStructOpsTypeTraitsBase2<FYarnNetVariableDelta>
+{
+    enum { WithNetSerializer = true };
+};
@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnPerfectHash.h"
+#include "YarnNodeIndex.generated.h"
+
+
+namespace Yarn
+{
+    class Program;
+}
+
+
+/**
+ * Inverted index from node tags and headers to the nodes that have them, built on import and saved with the project.
+ *
+ * Every tag, and every header's key and value, is a term.  Each term has a posting list: the sorted indices, in the
+ * project's NodeNames, of the nodes with that term.  The lists sit back to back in one array, and terms are found
+ * through a perfect hash, so a query is a hash lookup per term and then an intersection of the lists, starting from
+ * the shortest.
+ *
+ * Tags come from both the node's tags and its "tags" header, split on whitespace.
+ */
+USTRUCT()
+struct YARNSPINNER_API FYarnNodeIndex
+{
+    GENERATED_BODY()
+
+    // NodeNames must be the project's sorted node names
+    void Build(const Yarn::Program& Program, const TArray<FString>& NodeNames);
+    void Reset();
+
+    // The number of nodes the index was built for
+    int32 NumNodes() const { return NodeCount; }
+
+    // Appends the indices of the nodes that have every one of the tags and every one of the header values, in order.
+    // With no tags or headers, that's every node.
+    void FindNodes(TArrayView<const FStringView> Tags, TArrayView<const TPair<FStringView, FStringView>> Headers, TArray<int32>& OutNodeIndices) const;
+
+    // The nodes with one term, or an empty view if no node has it.  Sorted.
+    TArrayView<const int32> FindTag(FStringView Tag) const;
+    TArrayView<const int32> FindHeader(FStringView Key, FStringView Value) const;
+
+    SIZE_T GetAllocatedSize() const;
+
+private:
+    // Tag terms are "#tag" and header terms "key:value"; header keys can't start with # or contain a colon
+    UPROPERTY()
+    TArray<FString> Terms;
+
+    UPROPERTY()
+    FYarnPerfectHash TermHash;
+
+    // Term i's list is Postings[PostingOffsets[i]] up to Postings[PostingOffsets[i + 1]]
+    UPROPERTY()
+    TArray<int32> PostingOffsets;
+
+    UPROPERTY()
+    TArray<int32> Postings;
+
+    UPROPERTY()
+    int32 NodeCount = 0;
+
+    TArrayView<const int32> FindTerm(FStringView Term) const;
+};
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnPerfectHash.generated.h"
+
+
+/**
+ * Minimal perfect hash over a fixed set of string keys, built on import and saved with the asset.
+ *
+ * Each key hashes to a bucket; the bucket's seed either picks the key's slot directly or is mixed into a second hash
+ * that does, chosen at build time so that no two keys share a slot.  A lookup is two hashes and two array reads, with
+ * no probing.  The keys themselves aren't stored: Find returns the index a key would have, and the caller compares it
+ * against its own copy, since a key that isn't in the set lands on some other key's index.
+ */
+USTRUCT()
+struct YARNSPINNER_API FYarnPerfectHash
+{
+    GENERATED_BODY()
+
+    // Builds the hash for Keys, which must all be different.  Returns false, leaving the hash empty, if it couldn't.
+    bool Build(TArrayView<const FStringView> Keys, bool bInIgnoreCase);
+    void Reset();
+
+    bool IsEmpty() const { return Slots.Num() == 0; }
+    int32 Num() const { return Slots.Num(); }
+
+    // The index in Keys that this key would have, or INDEX_NONE if the hash is empty.  See the class comment.
+    int32 Find(FStringView Key) const;
+
+    SIZE_T GetAllocatedSize() const { return Seeds.GetAllocatedSize() + Slots.GetAllocatedSize(); }
+
+private:
+    // Per bucket: 0 if unused, a positive seed for the second hash, or -(slot + 1) for a bucket with a single key
+    UPROPERTY()
+    TArray<int32> Seeds;
+
+    // Per slot: the index of the key that hashes there
+    UPROPERTY()
+    TArray<int32> Slots;
+
+    UPROPERTY()
+    bool bIgnoreCase = false;
+
+    static uint32 Hash(FStringView Key, uint32 Seed, bool bIgnoreCase);
+};
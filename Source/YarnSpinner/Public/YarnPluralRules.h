@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnPluralRules.generated.h"
+
+
+UENUM(BlueprintType)
+enum class EYarnPluralCategory : uint8
+{
+    Zero,
+    One,
+    Two,
+    Few,
+    Many,
+    Other,
+};
+
+
+/**
+ * One culture's cardinal or ordinal plural rules as a small decision program.
+ *
+ * Rules are written in CLDR's syntax ("v = 0 and i % 10 = 2..4 and i % 100 != 12..14") and compiled on import, so
+ * choosing a plural form is a walk over a few ints rather than a call into ICU.  Categories are tried in order and the
+ * first whose condition holds wins; a number that matches none is Other.
+ */
+USTRUCT()
+struct YARNSPINNER_API FYarnPluralRules
+{
+    GENERATED_BODY()
+
+    // Adds the condition for a category.  Returns false, leaving the rules as they were, if the condition doesn't parse.
+    bool AddRule(EYarnPluralCategory Category, FStringView Condition);
+
+    // The category for a number written the way it will be shown, e.g. "1", "1.0" or "-2.50".  Trailing zeros count,
+    // as in CLDR: "1" is One in English and "1.0" is Other.  Anything that isn't a number is Other.
+    EYarnPluralCategory Evaluate(FStringView Number) const;
+
+    bool IsEmpty() const { return Program.Num() == 0; }
+
+private:
+    // For each category: the category, the number of "or" clauses, then each clause as the number of "and" relations
+    // followed by each relation as operand (with 0x10 set for !=), modulus (0 for none), range count and the ranges.
+    UPROPERTY()
+    TArray<int32> Program;
+};
+
+
+// Plural rules for one of a project's cultures
+USTRUCT()
+struct YARNSPINNER_API FYarnCultureRules
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    FName Culture;
+
+    // "1 coin", "2 coins"
+    UPROPERTY()
+    FYarnPluralRules Cardinal;
+
+    // "1st", "2nd"
+    UPROPERTY()
+    FYarnPluralRules Ordinal;
+
+    static const TCHAR* GetCategoryName(EYarnPluralCategory Category);
+};
@@ -6,9 +6,19 @@
 #include "UObject/ObjectMacros.h"
 #include "UObject/Object.h"
 #include "UObject/Class.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Misc/MarkupParser.h"
+#include "YarnLineTable.h"
+#include "YarnNodeIndex.h"
+#include "YarnPerfectHash.h"
+#include "YarnPluralRules.h"
+#include "YarnLocalizedStrings.h"
 #include "YarnProject.generated.h"
 
 
+struct FAssetData;
+
+
 USTRUCT()
 struct FYarnSourceMeta
 {
@@ -29,10 +39,55 @@ struct FYarnSourceMeta
 };
 
 
+USTRUCT()
+struct FYarnLineAssetList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TSoftObjectPtr<UObject>> Assets;
+};
+
+
+// The assets for each line in one culture, by line index, so that indexing them doesn't make an FName for every line.
+USTRUCT()
+struct FYarnCultureLineAssets
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TMap<int32, FYarnLineAssetList> Lines;
+};
+
+
+// A line's text ready to display: shared as-is if it takes no arguments, otherwise with its format pattern parsed.
+struct FYarnCompiledLine
+{
+	FText Text;
+	TOptional<FTextFormat> Format;
+	// Markup in Text.  Lines with a Format still contain their markup, as it's parsed after substitution.
+	TArray<FYarnMarkupAttribute> Attributes;
+};
+
+
+#if WITH_EDITOR
+// The parts of a project that only matter for presenting lines
+struct FYarnPresentationData
+{
+	FYarnLineTable LineTable;
+	TArray<FYarnCultureRules> PluralRules;
+	TMap<FName, TSoftObjectPtr<UYarnLocalizedStrings>> LocalizedStrings;
+	TMap<FString, FYarnSourceMeta> YarnFiles;
+	TMap<FName, FYarnCultureLineAssets> LineAssetIndex;
+	FYarnNodeIndex NodeIndex;
+};
+#endif
+
+
 /**
  * 
  */
-UCLASS()
+UCLASS(BlueprintType)
 class YARNSPINNER_API UYarnProject : public UObject
 {
 	GENERATED_BODY()
@@ -41,23 +96,120 @@ public:
 	UPROPERTY()
 	TArray<uint8> Data;
 
-	UPROPERTY(VisibleAnywhere, Category="Yarn Spinner")
+	// Every line's ID and text.  A line's index in the table is how it's referred to elsewhere, e.g. over the network.
+	UPROPERTY()
+	FYarnLineTable LineTable;
+
+	// Only set in projects imported before the line table existed; moved into LineTable on load.
+	UPROPERTY()
 	TMap<FName, FString> Lines;
+	UPROPERTY()
+	TArray<FName> LineIDs;
+
+	// Every variable declared in the program, in lexical order.
+	UPROPERTY()
+	TArray<FString> VariableNames;
+
+	// Every node in the program, in lexical order.
+	UPROPERTY()
+	TArray<FString> NodeNames;
+
+	// Plural and ordinal rules for the base language, first, and then each translated culture.  Compiled on import.
+	UPROPERTY()
+	TArray<FYarnCultureRules> PluralRules;
+
+	// Line text for each translated culture, built on import.  Only the current culture's is loaded.
+	UPROPERTY()
+	TMap<FName, TSoftObjectPtr<UYarnLocalizedStrings>> LocalizedStrings;
+
+	// The Blueprint function and command index.  Nothing loads it through here; the reference just makes sure it's
+	// cooked along with any Yarn project.
+	UPROPERTY()
+	TSoftObjectPtr<class UYarnLibraryIndex> LibraryIndex;
+
+	// Leave line text, plural rules and other presentation-only data out of server-only cooks.  Servers keep the program
+	// and symbol tables, and rebuild the node index from the program when they load the project.
+	UPROPERTY(EditAnywhere, Category="Cooking")
+	bool bStripPresentationDataForServer = true;
 
 	// Yarn files that were imported into this project, relative to the .yarnproject file, mapped to file metadata.
 	UPROPERTY(VisibleAnywhere, Category="File Path")
 	TMap<FString, FYarnSourceMeta> YarnFiles;
 
+    // Call before running the project's dialogue.  Rebuilds the line asset index for projects imported before it
+    // existed, and in the editor once after each load, as assets may have changed while the project wasn't loaded.
     void Init();
 
     FString GetLocAssetPackage() const;
     FString GetLocAssetPackage(FName Language) const;
     class UDataTable* GetLocTextDataTable(FName Language) const;
 
+    // The line's assets for the current culture.  Falls back to assets that aren't in any culture's folder, then to
+    // the base language's.
     TArray<TSoftObjectPtr<UObject>> GetLineAssets(FName Name);
+    // As GetLineAssets, without the copy.  Returns an empty array for lines with no assets.
+    const TArray<TSoftObjectPtr<UObject>>& FindLineAssets(FName Name) const;
+    const TArray<TSoftObjectPtr<UObject>>& FindLineAssets(int32 LineIndex) const;
+
+#if WITH_EDITOR
+	// Finds every asset named after one of the project's lines (an asset called "abc" belongs to line:abc) and
+	// records it under its culture.  Called on import and cook; AddLineAsset and RemoveLineAsset keep it up to date
+	// in between.
+	void BuildLineAssetIndex();
+	// Return true if the index changed.
+	bool AddLineAsset(const FAssetData& Asset);
+	bool RemoveLineAsset(const FSoftObjectPath& AssetPath);
+#endif
+
+	// Rebuilds VariableNames, NodeNames and their hashes from Data.  Called on import, after LineTable is filled in.
+	void BuildSymbolTables();
+
+	// Index of a line, variable or node in the symbol tables, or INDEX_NONE if it isn't in the project.
+	int32 GetLineIndex(FName LineID) const;
+	FName GetLineIDForIndex(int32 LineIndex) const;
+	int32 GetVariableIndex(const FString& VariableName) const;
+	const FString* GetVariableNameForIndex(int32 VariableIndex) const;
+	int32 GetNodeIndex(FStringView NodeName) const;
+
+	// Appends the indices in NodeNames of the nodes that have all of the tags and all of the header values.  See
+	// FYarnNodeIndex.
+	void FindNodeIndices(TArrayView<const FStringView> Tags, TArrayView<const TPair<FStringView, FStringView>> Headers, TArray<int32>& OutNodeIndices) const;
+
+	// The nodes that have every one of the tags and every one of the header values, e.g. tagged "bark" with
+	// "speaker: guard".  With no tags or headers, every node.
+	UFUNCTION(BlueprintCallable, Category="Yarn Spinner")
+	TArray<FName> FindNodes(const TArray<FString>& Tags, const TMap<FString, FString>& Headers) const;
+
+	// The line's unformatted text in the current culture.  Returns false if the project doesn't have the line.
+	bool FindLineText(FName LineID, FStringView& OutText) const;
+	bool FindLineText(int32 LineIndex, FStringView& OutText) const;
+	// Also gives the markup parsed out of the text on import, or null if the text still contains it.  Lines with
+	// substitutions always still contain theirs; see FYarnMarkupTable::NeedsRuntimeParse.
+	bool FindLineText(int32 LineIndex, FStringView& OutText, const FYarnMarkupTable*& OutMarkup) const;
+
+	// The line's text, compiled on first use and kept until the culture changes.  Null if the project doesn't have it.
+	// Only valid until the next call.
+	const FYarnCompiledLine* GetCompiledLine(FName LineID) const;
+	const FYarnCompiledLine* GetCompiledLine(int32 LineIndex) const;
 
+	// The plural rules for the culture whose text is in use: the current culture's if the project has its text,
+	// otherwise the base language's.  Null if the project has none.
+	const FYarnCultureRules* GetPluralRules() const;
+	const FYarnCultureRules* FindPluralRules(FName Culture) const;
+
+	// Logs how long lookups take through the symbol tables' perfect hashes and through TMaps of the same keys, and how
+	// much memory each uses.  See yarn.BenchmarkLookups.
+	void LogLookupBenchmark() const;
+	// Logs what markup costs per line at display time in the current culture.  See yarn.BenchmarkMarkup.
+	void LogMarkupBenchmark() const;
+
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
 	virtual void PostInitProperties() override;
 	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
+	virtual void PostSave(FObjectPostSaveContext ObjectSaveContext) override;
+#endif
 #if WITH_EDITORONLY_DATA
 	virtual void GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const override;
 	void SetYarnSources(const TArray<FString>& NewYarnSources);
@@ -70,5 +222,49 @@ public:
 #endif
 
 private:
-    TMap<FName, TArray<TSoftObjectPtr<UObject>>> LineAssets;
+	// Assets for each line, by the culture whose folder under GetLocAssetPackage() they're in.  Assets anywhere else
+	// are under NAME_None.
+	UPROPERTY()
+	TMap<FName, FYarnCultureLineAssets> LineAssetIndex;
+	// False in projects imported before the index existed
+	UPROPERTY()
+	bool bLineAssetIndexBuilt = false;
+
+	// Reverse lookups for the variable and node symbol tables
+	UPROPERTY()
+	FYarnPerfectHash VariableHash;
+	UPROPERTY()
+	FYarnPerfectHash NodeHash;
+
+	// Nodes by tag and header
+	UPROPERTY()
+	FYarnNodeIndex NodeIndex;
+
+#if WITH_EDITOR
+	// What PreSave takes out of a server-only cook, until PostSave puts it back
+	TOptional<FYarnPresentationData> PresentationDataForCook;
+#endif
+
+	// By line index
+	mutable TMap<int32, FYarnCompiledLine> CompiledLines;
+
+	// The current culture's strings, or null to use Lines.  Loaded the first time a line is needed after a culture change.
+	mutable TStrongObjectPtr<UYarnLocalizedStrings> ActiveStrings;
+	mutable const FYarnCultureRules* ActiveRules = nullptr;
+	// The index's cultures to look for line assets in, in order
+	mutable TArray<const FYarnCultureLineAssets*, TInlineAllocator<3>> ActiveLineAssets;
+	mutable bool bActiveLineAssetsResolved = false;
+	mutable bool bActiveStringsResolved = false;
+
+	void BuildSymbolLookups();
+	void InvalidateCompiledLines();
+	void ResolveActiveStrings() const;
+	void ResolveActiveLineAssets() const;
+#if WITH_EDITOR
+	// The culture whose folder the asset is in, or NAME_None
+	FName GetLineAssetCulture(FName PackagePath) const;
+	// Set once the index has been rebuilt since the project was loaded.  The synchronizer only keeps loaded projects
+	// up to date, so until then the index can be missing assets that were added or renamed in the meantime.
+	bool bLineAssetIndexCurrent = false;
+#endif
 };
@@ -35,6 +35,10 @@ namespace Yarn
         Value PopValue();
         Value PeekValue();
 
+        // Pointer to the top count values, oldest first, or nullptr if there aren't that many.
+        const Value *PeekValues(size_t count) const;
+        void PopValues(size_t count);
+
         void ClearStack();
     };
 }
@@ -55,7 +55,7 @@ namespace Yarn
             return GetType() == BOOL;
         }
 
-        const std::string GetStringValue()
+        const std::string GetStringValue() const
         {
             if (this->type == STRING)
             {
@@ -67,7 +67,7 @@ namespace Yarn
             }
         }
 
-        float GetNumberValue()
+        float GetNumberValue() const
         {
             if (this->type == NUMBER)
             {
@@ -79,7 +79,7 @@ namespace Yarn
             }
         }
 
-        float ConvertToNumber()
+        float ConvertToNumber() const
         {
             if (type == STRING)
             {
@@ -92,7 +92,7 @@ namespace Yarn
             return number;
         }
 
-        bool GetBooleanValue()
+        bool GetBooleanValue() const
         {
             if (this->type == BOOL)
             {
@@ -104,7 +104,7 @@ namespace Yarn
             }
         }
 
-        const std::string ConvertToString()
+        const std::string ConvertToString() const
         {
             switch (type)
             {
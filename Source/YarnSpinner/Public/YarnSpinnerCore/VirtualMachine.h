@@ -50,10 +50,34 @@ namespace Yarn
             /// The VirtualMachine is in the middle of executing code.
             RUNNING,
 
+            /// The VirtualMachine delivered a command that is still running.
+            /// Call CompleteCommand when it finishes, then Continue.
+            WAITING_ON_COMMAND,
+
+            /// The VirtualMachine called a function whose result isn't ready
+            /// yet. Call ResumeWithValue when it is, then Continue.
+            WAITING_ON_FUNCTION,
+
+            /// The VirtualMachine ran out of its execution budget in the
+            /// middle of a node. Call Continue to carry on.
+            YIELDED,
+
             /// The VirtualMachine has encountered an error and cannot continue executing.
             ERROR
         };
 
+        /// Limits on a single call to Continue. Zero means unlimited.
+        struct ExecutionBudget
+        {
+            int MaxInstructions = 0;
+            double MaxSeconds = 0;
+
+            /// Instructions that can run without delivering any content
+            /// before the script is treated as stuck in a loop and stopped
+            /// with an error.  Counts across yields.
+            int RunawayInstructionLimit = 0;
+        };
+
     private:
         Yarn::Program program;
 
@@ -65,6 +89,10 @@ namespace Yarn
 
         ExecutionState executionState;
 
+        // Instructions run since content was last delivered, for the runaway watchdog
+        int instructionsSinceContent = 0;
+        int lastInstructionCount = 0;
+
         // Library &library;
         ILogger &logger;
         IVariableStorage &variableStorage;
@@ -78,11 +106,31 @@ namespace Yarn
 
         bool SetNode(const char *nodeName);
         const char *GetCurrentNodeName();
+        // The instruction being run in the current node; inside a handler, the one that called it.
+        int GetProgramCounter() const { return state.programCounter; }
 
         ExecutionState GetCurrentExecutionState();
 
         // Begins or continues execution of the virtual machine.
         bool Continue();
+        // As Continue, but yields once the budget runs out.
+        bool Continue(const ExecutionBudget &budget);
+
+        // Instructions run by the last call to Continue.
+        int GetLastInstructionCount() const { return lastInstructionCount; }
+
+        // Stops execution and clears the state.  Safe to call from inside a handler.
+        void Stop();
+
+        // Called from the CommandHandler to keep the VM parked until CompleteCommand is called, rather than until the
+        // next Continue.
+        bool WaitOnCommand();
+        void CompleteCommand();
+
+        // Called from CallFunction when the result will arrive later; whatever CallFunction returns is discarded and
+        // the VM suspends after popping the parameters.  ResumeWithValue pushes the result in its place.
+        bool WaitOnFunction();
+        bool ResumeWithValue(Value value);
 
         std::function<void(Line &)> LineHandler;
         std::function<void(OptionSet &)> OptionsHandler;
@@ -92,7 +140,11 @@ namespace Yarn
         std::function<void()> DialogueCompleteHandler;
         std::function<bool(std::string)> DoesFunctionExist;
         std::function<int(std::string)> GetExpectedFunctionParamCount;
-        std::function<Yarn::Value(std::string, std::vector<Yarn::Value>)> CallFunction;
+        // Parameters point straight into the VM's stack, in call order, and are only valid for the duration of the call.
+        std::function<Yarn::Value(const std::string &, const Yarn::Value *, size_t)> CallFunction;
+        // Optional.  Finds a node in this VM's program without going through the program's own map, e.g. with a
+        // lookup built on import.  Returns null if there's no such node.
+        std::function<const Yarn::Node *(const char *)> FindNode;
 
         void SetSelectedOption(int selectedOptionIndex);
 
@@ -4,7 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "Library/YarnLibraryRegistry.h"
-#include "Engine/ObjectLibrary.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "YarnTimerWheel.h"
+#include "YarnVariableStore.h"
 #include "YarnSpinnerCore/VirtualMachine.h"
 #include "YarnSubsystem.generated.h"
 
@@ -13,7 +16,7 @@
  * 
  */
 UCLASS()
-class YARNSPINNER_API UYarnSubsystem : public UGameInstanceSubsystem, public Yarn::IVariableStorage
+class YARNSPINNER_API UYarnSubsystem : public UGameInstanceSubsystem, public Yarn::IVariableStorage, public FTickableGameObject
 {
     GENERATED_BODY()
 public:
@@ -33,24 +36,98 @@ public:
 
     virtual void ClearValue(std::string name) override;
 
+    // Same as the IVariableStorage setters, but records which node made the change in the change journal.
+    void SetVariable(const FString& Name, const Yarn::Value& Value, FName SourceNode = NAME_None);
+    void ClearVariable(const FString& Name, FName SourceNode = NAME_None);
+    // Commits a session's buffered writes and journals them.  Game thread only.
+    void CommitVariableSession(FYarnVariableSession& Session, FName SourceNode = NAME_None);
+
+    // Observers are called once per frame with every change made to their variable since the last frame.  Add and
+    // remove them on the game thread.
+    FDelegateHandle AddVariableObserver(const FString& Name, FYarnVariableChangesDelegate::FDelegate Observer);
+    void RemoveVariableObserver(const FString& Name, FDelegateHandle Handle);
+    // As AddVariableObserver, for changes to any variable.
+    FDelegateHandle AddAnyVariableObserver(FYarnVariableChangesDelegate::FDelegate Observer);
+    void RemoveAnyVariableObserver(FDelegateHandle Handle);
+
+    // Delivers journalled changes to observers now rather than waiting for the next tick.
+    void FlushVariableChanges();
+
+    // Serializes every variable into a compact binary blob.  Variables still at the Baseline project's initial values
+    // are left out.
+    UFUNCTION(BlueprintCallable, Category="Yarn Variables")
+    TArray<uint8> SaveVariables(const class UYarnProject* Baseline = nullptr) const;
+    // As SaveVariables, but only the snapshot is taken on the calling thread; encoding happens on the thread pool.
+    TFuture<TArray<uint8>> SaveVariablesAsync(const class UYarnProject* Baseline = nullptr) const;
+    // Replaces every variable with the contents of a blob made by SaveVariables.  Observers are not notified.
+    UFUNCTION(BlueprintCallable, Category="Yarn Variables")
+    bool LoadVariables(const TArray<uint8>& Data);
+    // Seeds variables from a table of FYarnVariableRow in one batch.  Observers are notified as for any other change.
+    // Returns the number of variables written.
+    UFUNCTION(BlueprintCallable, Category="Yarn Variables")
+    int32 ImportVariables(const class UDataTable* Table, bool bOverwriteExisting = true);
+
+    // Logs every variable whose name contains Filter (or all of them if it's empty).  Backs yarn.DumpVariables.
+    void DumpVariables(const FString& Filter = FString()) const;
+
+    // FTickableGameObject
+    virtual void Tick(float DeltaTime) override;
+    virtual ETickableTickType GetTickableTickType() const override;
+    virtual bool IsTickable() const override;
+    virtual bool IsTickableWhenPaused() const override { return true; }
+    virtual TStatId GetStatId() const override;
+
     const UYarnLibraryRegistry* GetYarnLibraryRegistry() const { return YarnFunctionRegistry; }
+    UYarnLibraryRegistry* GetYarnLibraryRegistry() { return YarnFunctionRegistry; }
+
+    // Shared by every dialogue runner in the game instance for timed commands.  Advances with the world's (dilated)
+    // time and stops while the game is paused.
+    FYarnTimerWheel& GetTimerWheel() { return TimerWheel; }
+
+    // Limits for a runner's next stretch of script: the per-Continue budget from the yarn.* console variables, capped
+    // by what's left of this frame's budget shared by every runner.  Returns false if that's already used up.
+    bool GetExecutionBudget(Yarn::VirtualMachine::ExecutionBudget& OutBudget);
+    void ChargeExecutionTime(double Seconds);
+    // Resumes the runner's dialogue on a later frame, after any runners queued before it
+    void QueueYieldedRunner(class ADialogueRunner* Runner);
+
+    // Thread-safe access to the variables.  VMs running off the game thread should read and write through an
+    // FYarnVariableSession created from this store and commit it back on the game thread.
+    FYarnVariableStore& GetVariableStore() { return Variables; }
+    const FYarnVariableStore& GetVariableStore() const { return Variables; }
 
 private:
     UPROPERTY()
     UYarnLibraryRegistry* YarnFunctionRegistry;
 
-    UPROPERTY()
-    UObjectLibrary* YarnFunctionObjectLibrary;
-    UPROPERTY()
-    UObjectLibrary* YarnCommandObjectLibrary;
-    
-    TMap<FString, Yarn::Value> Variables;
+    FYarnVariableStore Variables;
+
+    FYarnTimerWheel TimerWheel;
+
+    // Runners whose dialogue yielded, with the frame they yielded on
+    TArray<TPair<TWeakObjectPtr<class ADialogueRunner>, uint64>> YieldedRunners;
+    uint64 FrameBudgetFrame = 0;
+    double FrameBudgetRemaining = 0;
+
+    void ResumeYieldedRunners();
+
+    // Changes not yet delivered to observers
+    mutable FCriticalSection JournalLock;
+    TArray<FYarnVariableChange> Journal;
+
+    TMap<FString, FYarnVariableChangesDelegate> VariableObservers;
+    FYarnVariableChangesDelegate AnyVariableChanged;
     
     FDelegateHandle OnAssetRegistryFilesLoadedHandle;
     FDelegateHandle OnLevelAddedToWorldHandle;
     FDelegateHandle OnWorldInitializedActorsHandle;
 
-    void LogVariables();
+    // Mirrors whether there are any observers, for writers on other threads.  Only changed under JournalLock.
+    std::atomic<bool> bHasVariableObservers{false};
+
+    // Call with JournalLock held, after adding or removing an observer
+    void UpdateHasVariableObservers() { bHasVariableObservers = AnyVariableChanged.IsBound() || VariableObservers.Num() > 0; }
+    void RecordChange(FString Name, TOptional<Yarn::Value> OldValue, TOptional<Yarn::Value> NewValue, FName SourceNode);
 };
 
 
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+
+/**
+ * Identifies a timer scheduled on a FYarnTimerWheel.  Stays safe to use after the timer fires or is cancelled.
+ */
+struct YARNSPINNER_API FYarnTimerHandle
+{
+    int32 Index = INDEX_NONE;
+    uint32 Serial = 0;
+
+    bool IsValid() const { return Index != INDEX_NONE; }
+    void Invalidate() { Index = INDEX_NONE; }
+};
+
+
+/**
+ * Hierarchical timer wheel for dialogue timers such as <<wait>>.
+ *
+ * Time advances in fixed ticks of TickSeconds.  The first level has a slot for each of the next 256 ticks and each of
+ * the three levels above it covers 64 times the span of the one below; timers further out are moved down a level when
+ * the wheel reaches their slot.  Scheduling, cancelling and firing are all O(1) however many timers there are, which
+ * matters when hundreds of runners are waiting at once.  Timers are rounded up to the next tick.
+ *
+ * Not thread-safe; the Yarn subsystem advances its wheel on the game thread.
+ */
+class YARNSPINNER_API FYarnTimerWheel
+{
+public:
+    static constexpr double TickSeconds = 0.01;
+
+    FYarnTimerWheel();
+
+    // Calls Callback after DelaySeconds of wheel time.  If Owner is given, CancelAll(Owner) cancels it.
+    FYarnTimerHandle Schedule(double DelaySeconds, TFunction<void()> Callback, const UObject* Owner = nullptr);
+    // Returns false if the timer had already fired or been cancelled.
+    bool Cancel(FYarnTimerHandle& Handle);
+    int32 CancelAll(const UObject* Owner);
+
+    // Moves wheel time forward by DeltaSeconds (scaled by the time dilation) and fires every timer that's due, in
+    // order.  Does nothing while paused.
+    void Advance(double DeltaSeconds);
+
+    // Pauses the wheel until the caller unpauses it, whether or not the world is paused too
+    void SetPaused(bool bInPaused) { bUserPaused = bInPaused; }
+    // Kept in sync with the world by the Yarn subsystem
+    void SetWorldPaused(bool bInPaused) { bWorldPaused = bInPaused; }
+    bool IsPaused() const { return bUserPaused || bWorldPaused; }
+    void SetTimeDilation(double InTimeDilation) { TimeDilation = FMath::Max(InTimeDilation, 0.0); }
+    double GetTimeDilation() const { return TimeDilation; }
+
+    int32 Num() const { return Timers.Num(); }
+
+    // Seconds until the timer fires, or a negative number if it isn't scheduled.
+    double GetRemaining(const FYarnTimerHandle& Handle) const;
+
+private:
+    static constexpr int32 Level0Bits = 8;
+    static constexpr int32 LevelNBits = 6;
+    static constexpr int32 NumLevels = 4;
+    static constexpr int32 Level0Slots = 1 << Level0Bits;
+    static constexpr int32 LevelNSlots = 1 << LevelNBits;
+    static constexpr int32 NumSlots = Level0Slots + (NumLevels - 1) * LevelNSlots;
+    static constexpr uint64 MaxDelayTicks = (uint64(1) << (Level0Bits + (NumLevels - 1) * LevelNBits)) - 1;
+
+    struct FTimer
+    {
+        TFunction<void()> Callback;
+        FObjectKey Owner;
+        uint64 ExpireTick = 0;
+        uint32 Serial = 0;
+        int32 Slot = INDEX_NONE;
+        int32 Prev = INDEX_NONE;
+        int32 Next = INDEX_NONE;
+    };
+
+    TSparseArray<FTimer> Timers;
+    // Head of each slot's doubly linked list of timers; level 0's slots first, then each level above in turn
+    TArray<int32> SlotHeads;
+
+    uint64 CurrentTick = 0;
+    double Accumulator = 0;
+    double TimeDilation = 1;
+    uint32 NextSerial = 1;
+    bool bUserPaused = false;
+    bool bWorldPaused = false;
+
+    const FTimer* Find(const FYarnTimerHandle& Handle) const;
+    void Link(int32 Index);
+    void Unlink(int32 Index);
+    // Re-files every timer in a higher level's slot now that it's close enough for a finer one
+    void Cascade(int32 Level, int32 SlotInLevel);
+    void FireSlot(int32 Slot);
+    void Tick();
+};
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "Engine/DataTable.h"
+#include "YarnVariableRow.generated.h"
+
+
+UENUM(BlueprintType)
+enum class EYarnVariableType : uint8
+{
+    Bool,
+    Number,
+    String,
+};
+
+
+// A row for seeding Yarn variables from a data table.  The row name is used as the variable name unless VariableName is set.
+USTRUCT(BlueprintType)
+struct YARNSPINNER_API FYarnVariableRow : public FTableRowBase
+{
+    GENERATED_BODY();
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Yarn Variable")
+    FString VariableName;
+
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Yarn Variable")
+    EYarnVariableType Type = EYarnVariableType::Number;
+
+    // Parsed according to Type: "true"/"false" for bools, a decimal number for numbers, anything for strings
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category="Yarn Variable")
+    FString Value;
+};
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnVariableStore.h"
+#include "YarnSpinnerCore/Value.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "YarnSpinnerCore/yarn_spinner.pb.h"
+THIRD_PARTY_INCLUDES_END
+
+
+/**
+ * Compact binary save format for Yarn variables.
+ *
+ * Layout: a small header, a deduplicated table of every variable name and string value (as UTF-8), then one entry per
+ * variable holding its name index, a type tag and the payload.  Variables whose value matches the program's initial
+ * value are left out entirely, since the VM falls back to the initial value for anything that isn't stored.
+ *
+ * Everything here works on plain data, so it's safe to call from any thread.
+ */
+class YARNSPINNER_API FYarnVariableSerializer
+{
+public:
+    static constexpr uint32 Magic = 0x59535653; // 'YSVS'
+    static constexpr uint32 FormatVersion = 1;
+
+    // Collects a program's declared initial values, for use as a delta baseline.
+    static void GetInitialValues(const Yarn::Program& Program, TMap<FString, Yarn::Value>& OutValues);
+    // As above, parsing the program from a UYarnProject's compiled data.
+    static bool GetInitialValues(const TArray<uint8>& ProgramData, TMap<FString, Yarn::Value>& OutValues);
+
+    static void Save(const TMap<FString, Yarn::Value>& Values, const TMap<FString, Yarn::Value>& Baseline, TArray<uint8>& OutBytes);
+    // Returns false (leaving OutValues empty) if the data is truncated, corrupt or from an unknown format version.
+    static bool Load(const TArray<uint8>& Bytes, TMap<FString, Yarn::Value>& OutValues);
+
+    static bool ValuesEqual(const Yarn::Value& A, const Yarn::Value& B);
+};
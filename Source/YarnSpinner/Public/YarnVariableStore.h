@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "YarnSpinnerCore/Value.h"
+#include "YarnSpinnerCore/VirtualMachine.h"
+
+#include <atomic>
+
+
+/**
+ * An immutable copy of every variable in a FYarnVariableStore, taken at a single point in time.
+ */
+struct YARNSPINNER_API FYarnVariableSnapshot
+{
+    // Store version the snapshot was taken at.
+    uint64 Version = 0;
+
+    TMap<FString, Yarn::Value> Values;
+};
+
+using FYarnVariableSnapshotRef = TSharedRef<const FYarnVariableSnapshot, ESPMode::ThreadSafe>;
+
+
+/**
+ * One entry in the variable change journal.
+ */
+struct YARNSPINNER_API FYarnVariableChange
+{
+    FString Name;
+    // Unset if the variable didn't exist before the change.
+    TOptional<Yarn::Value> OldValue;
+    // Unset if the variable was cleared.
+    TOptional<Yarn::Value> NewValue;
+    // Node that was running when the change was made, or NAME_None if it came from outside dialogue.
+    FName SourceNode;
+
+    bool WasCleared() const { return !NewValue.IsSet(); }
+};
+
+// Receives a batch of changes, in the order they were made.
+DECLARE_MULTICAST_DELEGATE_OneParam(FYarnVariableChangesDelegate, TArrayView<const FYarnVariableChange>);
+
+
+/**
+ * Thread-safe storage for Yarn variables.
+ *
+ * Variables are spread over a fixed number of shards, each guarded by its own reader/writer lock.  Reads take their
+ * shard's lock shared, so they aren't lock-free: they never block each other, but they do wait while a writer holds
+ * the same shard.  Writers only contend when they hit the same shard.  Operations that span the whole store (snapshots
+ * and batched writes) lock every shard in index order, which keeps them atomic with respect to each other.  Readers
+ * that can't wait at all should use an FYarnVariableSession, which reads from a snapshot.
+ *
+ * The YarnSpinner.VariableStore automation tests (Private/Tests/YarnVariableStoreTests.cpp) hammer all of this from
+ * many threads at once.
+ */
+class YARNSPINNER_API FYarnVariableStore
+{
+public:
+    static constexpr int32 NumShards = 16;
+
+    bool Contains(const FString& Name) const;
+    TOptional<Yarn::Value> Find(const FString& Name) const;
+
+    // Sets a variable, returning its previous value if it had one.
+    TOptional<Yarn::Value> Set(const FString& Name, const Yarn::Value& Value);
+    // Removes a variable, returning its previous value if it had one.
+    TOptional<Yarn::Value> Remove(const FString& Name);
+    void Empty();
+
+    int32 Num() const;
+    // Incremented on every write; cheap to poll for "has anything changed since".
+    uint64 GetVersion() const { return Version.load(std::memory_order_acquire); }
+
+    // Copies every variable into one consistent map.
+    FYarnVariableSnapshotRef Snapshot() const;
+
+    // Applies a batch of changes atomically; an unset value removes the variable.  Previous values are written to
+    // OutOldValues (if given) in the same order as the changes.
+    void Apply(const TArray<TPair<FString, TOptional<Yarn::Value>>>& Changes, TArray<TOptional<Yarn::Value>>* OutOldValues = nullptr);
+
+    // Atomically replaces the whole contents of the store.
+    void Replace(const TMap<FString, Yarn::Value>& NewValues);
+
+private:
+    struct FShard
+    {
+        mutable FRWLock Lock;
+        TMap<FString, Yarn::Value> Values;
+    };
+
+    FShard Shards[NumShards];
+    std::atomic<uint64> Version{0};
+
+    static int32 ShardIndex(const FString& Name) { return GetTypeHash(Name) % NumShards; }
+    void LockAllForRead() const;
+    void UnlockAllForRead() const;
+    void LockAllForWrite();
+    void UnlockAllForWrite();
+};
+
+
+/**
+ * Variable storage for a virtual machine running off the game thread.
+ *
+ * Reads come from a snapshot of the store (plus this session's own pending writes), so they need no locks and see a
+ * consistent view for as long as the VM runs.  Writes are buffered and only reach the store when Commit() is called on
+ * the game thread; the whole buffer lands atomically.  A session must only be used by one thread at a time.
+ */
+class YARNSPINNER_API FYarnVariableSession : public Yarn::IVariableStorage
+{
+public:
+    explicit FYarnVariableSession(FYarnVariableStore& InStore);
+
+    // IVariableStorage
+    virtual void SetValue(std::string Name, bool bValue) override;
+    virtual void SetValue(std::string Name, float Value) override;
+    virtual void SetValue(std::string Name, std::string Value) override;
+    virtual bool HasValue(std::string Name) override;
+    virtual Yarn::Value GetValue(std::string Name) override;
+    virtual void ClearValue(std::string Name) override;
+
+    bool HasPendingChanges() const { return PendingChanges.Num() > 0; }
+    const TArray<TPair<FString, TOptional<Yarn::Value>>>& GetPendingChanges() const { return PendingChanges; }
+
+    // Writes all pending changes to the store in one atomic batch and refreshes the snapshot.  Game thread only.
+    void Commit();
+    // Drops all pending changes.
+    void Discard();
+    // Re-reads the store if it has changed since the snapshot was taken.  Pending changes are kept.
+    void Refresh();
+
+private:
+    FYarnVariableStore& Store;
+    FYarnVariableSnapshotRef Snapshot;
+
+    // Ordered so that commits replay writes in the order the VM made them
+    TArray<TPair<FString, TOptional<Yarn::Value>>> PendingChanges;
+    // Latest pending change per variable, as an index into PendingChanges
+    TMap<FString, int32> PendingIndex;
+
+    void SetPending(const FString& Name, TOptional<Yarn::Value> Value);
+};
@@ -27,5 +27,11 @@ public class YarnSpinner : ModuleRules
                 "Json",
                 "JsonUtilities",
             });
+
+        if (Target.bBuildEditor)
+        {
+            // Only needed to check the cook target when stripping server data
+            PrivateIncludePathModuleNames.Add("TargetPlatform");
+        }
     }
 }
\ No newline at end of file
@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnCldrPluralRules.h"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+
+namespace
+{
+    struct FPluralCase
+    {
+        const TCHAR* Culture;
+        bool bOrdinal;
+        const TCHAR* Number;
+        EYarnPluralCategory Expected;
+    };
+
+    using EC = EYarnPluralCategory;
+
+    // Checked against the samples in CLDR's plurals.xml and ordinals.xml, with both sides of each boundary
+    const FPluralCase Cases[] = {
+        // English: one only for a plain 1
+        {TEXT("en"), false, TEXT("1"), EC::One},
+        {TEXT("en"), false, TEXT("0"), EC::Other},
+        {TEXT("en"), false, TEXT("2"), EC::Other},
+        {TEXT("en"), false, TEXT("1.0"), EC::Other},
+        {TEXT("en"), false, TEXT("1.5"), EC::Other},
+        {TEXT("en"), true, TEXT("1"), EC::One},
+        {TEXT("en"), true, TEXT("2"), EC::Two},
+        {TEXT("en"), true, TEXT("3"), EC::Few},
+        {TEXT("en"), true, TEXT("4"), EC::Other},
+        {TEXT("en"), true, TEXT("11"), EC::Other},
+        {TEXT("en"), true, TEXT("12"), EC::Other},
+        {TEXT("en"), true, TEXT("13"), EC::Other},
+        {TEXT("en"), true, TEXT("21"), EC::One},
+        {TEXT("en"), true, TEXT("22"), EC::Two},
+        {TEXT("en"), true, TEXT("23"), EC::Few},
+        {TEXT("en"), true, TEXT("101"), EC::One},
+        {TEXT("en"), true, TEXT("111"), EC::Other},
+        {TEXT("en"), true, TEXT("112"), EC::Other},
+
+        // French: 0 and 1 (with any fraction) are one; exact millions are many
+        {TEXT("fr"), false, TEXT("0"), EC::One},
+        {TEXT("fr"), false, TEXT("1"), EC::One},
+        {TEXT("fr"), false, TEXT("0.5"), EC::One},
+        {TEXT("fr"), false, TEXT("1.5"), EC::One},
+        {TEXT("fr"), false, TEXT("2"), EC::Other},
+        {TEXT("fr"), false, TEXT("999999"), EC::Other},
+        {TEXT("fr"), false, TEXT("1000000"), EC::Many},
+        {TEXT("fr"), false, TEXT("2000000"), EC::Many},
+        {TEXT("fr"), false, TEXT("1000001"), EC::Other},
+        {TEXT("fr"), false, TEXT("1000000.0"), EC::Other},
+        {TEXT("fr"), true, TEXT("1"), EC::One},
+        {TEXT("fr"), true, TEXT("2"), EC::Other},
+
+        // Russian: by the last one or two digits of whole numbers; anything with a fraction is other
+        {TEXT("ru"), false, TEXT("1"), EC::One},
+        {TEXT("ru"), false, TEXT("21"), EC::One},
+        {TEXT("ru"), false, TEXT("101"), EC::One},
+        {TEXT("ru"), false, TEXT("11"), EC::Many},
+        {TEXT("ru"), false, TEXT("111"), EC::Many},
+        {TEXT("ru"), false, TEXT("2"), EC::Few},
+        {TEXT("ru"), false, TEXT("4"), EC::Few},
+        {TEXT("ru"), false, TEXT("22"), EC::Few},
+        {TEXT("ru"), false, TEXT("12"), EC::Many},
+        {TEXT("ru"), false, TEXT("14"), EC::Many},
+        {TEXT("ru"), false, TEXT("0"), EC::Many},
+        {TEXT("ru"), false, TEXT("5"), EC::Many},
+        {TEXT("ru"), false, TEXT("10"), EC::Many},
+        {TEXT("ru"), false, TEXT("1.5"), EC::Other},
+        {TEXT("ru"), false, TEXT("2.0"), EC::Other},
+        {TEXT("ru"), true, TEXT("1"), EC::Other},
+
+        // Arabic: all six categories, by n, so decimals that are whole numbers count
+        {TEXT("ar"), false, TEXT("0"), EC::Zero},
+        {TEXT("ar"), false, TEXT("0.0"), EC::Zero},
+        {TEXT("ar"), false, TEXT("1"), EC::One},
+        {TEXT("ar"), false, TEXT("2"), EC::Two},
+        {TEXT("ar"), false, TEXT("3"), EC::Few},
+        {TEXT("ar"), false, TEXT("3.0"), EC::Few},
+        {TEXT("ar"), false, TEXT("10"), EC::Few},
+        {TEXT("ar"), false, TEXT("103"), EC::Few},
+        {TEXT("ar"), false, TEXT("11"), EC::Many},
+        {TEXT("ar"), false, TEXT("99"), EC::Many},
+        {TEXT("ar"), false, TEXT("111"), EC::Many},
+        {TEXT("ar"), false, TEXT("100"), EC::Other},
+        {TEXT("ar"), false, TEXT("102"), EC::Other},
+        {TEXT("ar"), false, TEXT("1.5"), EC::Other},
+
+        // Polish: like Russian, but 1 is one on its own and 21 is many
+        {TEXT("pl"), false, TEXT("1"), EC::One},
+        {TEXT("pl"), false, TEXT("1.0"), EC::Other},
+        {TEXT("pl"), false, TEXT("2"), EC::Few},
+        {TEXT("pl"), false, TEXT("4"), EC::Few},
+        {TEXT("pl"), false, TEXT("22"), EC::Few},
+        {TEXT("pl"), false, TEXT("12"), EC::Many},
+        {TEXT("pl"), false, TEXT("14"), EC::Many},
+        {TEXT("pl"), false, TEXT("0"), EC::Many},
+        {TEXT("pl"), false, TEXT("5"), EC::Many},
+        {TEXT("pl"), false, TEXT("11"), EC::Many},
+        {TEXT("pl"), false, TEXT("21"), EC::Many},
+        {TEXT("pl"), false, TEXT("101"), EC::Many},
+        {TEXT("pl"), false, TEXT("2.5"), EC::Other},
+        {TEXT("pl"), true, TEXT("1"), EC::Other},
+    };
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnCldrPluralRulesTest, "YarnSpinner.PluralRules.Cldr", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnCldrPluralRulesTest::RunTest(const FString& Parameters)
+{
+    for (const FPluralCase& Case : Cases)
+    {
+        FYarnCultureRules Rules;
+        if (!TestTrue(*FString::Printf(TEXT("Rules for %s"), Case.Culture), FYarnCldrPluralRules::Build(Case.Culture, Rules)))
+        {
+            continue;
+        }
+        const FYarnPluralRules& Kind = Case.bOrdinal ? Rules.Ordinal : Rules.Cardinal;
+        TestEqual(*FString::Printf(TEXT("%s %s %s"), Case.Culture, Case.bOrdinal ? TEXT("ordinal") : TEXT("cardinal"), Case.Number),
+            FYarnCultureRules::GetCategoryName(Kind.Evaluate(Case.Number)),
+            FYarnCultureRules::GetCategoryName(Case.Expected));
+    }
+    return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FYarnCldrPluralRulesCultureTest, "YarnSpinner.PluralRules.CldrCultures", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FYarnCldrPluralRulesCultureTest::RunTest(const FString& Parameters)
+{
+    FYarnCultureRules Rules;
+
+    // A region without rules of its own uses its language's
+    TestTrue(TEXT("en-GB"), FYarnCldrPluralRules::Build(TEXT("en-GB"), Rules));
+    TestEqual(TEXT("en-GB culture"), Rules.Culture, FName(TEXT("en-GB")));
+    TestEqual(TEXT("en-GB 1"), FYarnCultureRules::GetCategoryName(Rules.Cardinal.Evaluate(TEXT("1"))), TEXT("one"));
+
+    // One with its own rules uses those: 0 is one in pt, but not in pt-PT
+    TestTrue(TEXT("pt"), FYarnCldrPluralRules::Build(TEXT("pt"), Rules));
+    TestEqual(TEXT("pt 0"), FYarnCultureRules::GetCategoryName(Rules.Cardinal.Evaluate(TEXT("0"))), TEXT("one"));
+    TestTrue(TEXT("pt_PT"), FYarnCldrPluralRules::Build(TEXT("pt_PT"), Rules));
+    TestEqual(TEXT("pt-PT 0"), FYarnCultureRules::GetCategoryName(Rules.Cardinal.Evaluate(TEXT("0"))), TEXT("other"));
+
+    // Languages with no plural forms have empty rules
+    TestTrue(TEXT("ja"), FYarnCldrPluralRules::Build(TEXT("ja"), Rules));
+    TestTrue(TEXT("ja cardinal"), Rules.Cardinal.IsEmpty());
+
+    TestFalse(TEXT("Unknown language"), FYarnCldrPluralRules::Build(TEXT("xx-YY"), Rules));
+    TestTrue(TEXT("Unknown language's rules"), Rules.Cardinal.IsEmpty() && Rules.Ordinal.IsEmpty());
+    return true;
+}
+
+
+#endif
@@ -20,7 +20,14 @@
 #include "ReimportYarnAssetFactory.h"
 #include "SourceControlOperations.h"
 #include "YarnProjectMeta.h"
+#include "YarnCldrPluralRules.h"
 #include "Misc/YSLogging.h"
+#include "Misc/YarnAssetHelpers.h"
+#include "Library/YarnLibraryIndex.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Internationalization/Internationalization.h"
+#include "UObject/SavePackage.h"
+#include "YarnLocalizedStrings.h"
 #include "Serialization/Csv/CsvParser.h"
 
 THIRD_PARTY_INCLUDES_START
@@ -115,12 +122,30 @@ UObject* UYarnAssetFactory::FactoryCreateBinary(UClass* InClass, UObject* InPare
     YarnProject->Data = Output;
 
     // For each line we've received, store it in the Yarn asset
-    for (auto Pair : CompilerOutput.strings())
+    TArray<TPair<FString, FString>> Lines;
+    Lines.Reserve(CompilerOutput.strings().size());
+    SIZE_T TextBytes = 0;
+    for (const auto& Pair : CompilerOutput.strings())
     {
-        FName LineID = FName(Pair.first.c_str());
-        FString LineText = FString(Pair.second.text().c_str());
-        YarnProject->Lines.Add(LineID, LineText);
+        FString LineID = UTF8_TO_TCHAR(Pair.first.c_str());
+        FString LineText = UTF8_TO_TCHAR(Pair.second.text().c_str());
+        TextBytes += (LineID.Len() + LineText.Len()) * sizeof(TCHAR);
+        Lines.Emplace(MoveTemp(LineID), MoveTemp(LineText));
     }
+    YarnProject->Lines.Empty();
+    YarnProject->LineIDs.Empty();
+    BuildPluralRules(YarnProject);
+    const double BuildStart = FPlatformTime::Seconds();
+    YarnProject->LineTable.Build(MoveTemp(Lines), YarnProject->PluralRules.Num() > 0 ? &YarnProject->PluralRules[0] : nullptr);
+    const double BuildSeconds = FPlatformTime::Seconds() - BuildStart;
+
+    const int32 NumLines = YarnProject->LineTable.Num();
+    const SIZE_T TableBytes = YarnProject->LineTable.GetAllocatedSize();
+    YS_LOG("Stored %d lines in %llu bytes (%.1f bytes per line on top of the text itself), parsing their markup in %.2f ms", NumLines, (uint64)TableBytes, NumLines > 0 ? double(TableBytes - FMath::Min(TableBytes, TextBytes)) / NumLines : 0.0, BuildSeconds * 1000.0)
+
+    YarnProject->BuildSymbolTables();
+    YarnProject->BuildLineAssetIndex();
+    YarnProject->LibraryIndex = TSoftObjectPtr<UYarnLibraryIndex>(FSoftObjectPath(FYarnAssetHelpers::LibraryIndexObjectPath()));
 
     // Record where this asset came from so we know how to update it
     if (!CurrentFilename.IsEmpty())
@@ -138,6 +163,7 @@ UObject* UYarnAssetFactory::FactoryCreateBinary(UClass* InClass, UObject* InPare
     }
 
     BuildLocalizationTarget(YarnProject, CompilerOutput);
+    BuildLocalizedStrings(YarnProject, CompilerOutput);
 
     //    YarnAsset->PostEditChange();
     //    YarnAsset->MarkPackageDirty();
@@ -360,52 +386,20 @@ void UYarnAssetFactory::BuildLocalizationTarget(const UYarnProject* YarnProject,
     // Add translations to archives
     for (auto Loc : ProjectMeta->localisation)
     {
-        FString Culture = Loc.Key;
-        FYarnProjectLocalizationData LocData = Loc.Value;
-        FString LocFile = FPaths::Combine(YarnProject->YarnProjectPath(), LocData.strings);
-        FPaths::NormalizeFilename(LocFile);
-        FPaths::CollapseRelativeDirectories(LocFile);
-        FPaths::RemoveDuplicateSlashes(LocFile);
-        FString LocFileData;
-
-        if (!FFileHelper::LoadFileToString(LocFileData, *LocFile))
+        const FString& Culture = Loc.Key;
+        TMap<FString, FString> Translations;
+        if (!ReadStringsFile(YarnProject, Culture, Loc.Value, Translations))
         {
-            YS_WARN("Couldn't load strings file '%s' for locale '%s'", *LocFile, *Culture)
             continue;
         }
 
-        const FCsvParser Parser(LocFileData);
-        const FCsvParser::FRows& Rows = Parser.GetRows();
-        if (Rows.Num() < 2)
+        for (const auto& Translated : Translations)
         {
-            YS_WARN("Empty strings file: %s", *LocFile)
-            continue;
-        }
-
-        const auto& HeaderRow = Rows[0];
-        TMap<FString, int32> HeaderMap;
-        for (int32 I = 0; I < HeaderRow.Num(); ++I)
-        {
-            HeaderMap.Add(WCHAR_TO_TCHAR(HeaderRow[I]), I);
-        }
-        // Test for required columns
-        if (!HeaderMap.Contains(TEXT("text")) || !HeaderMap.Contains(TEXT("id")))
-        {
-            YS_ERR("Missing required column 'id' or 'text' in strings file: %s", *LocFile)
-            continue;
-        }
-
-        for (int32 I = 1; I < Rows.Num(); ++I)
-        {
-            const auto& Row = Rows[I];
-            const FString& LineID = WCHAR_TO_TCHAR(Row[HeaderMap[TEXT("id")]]);
-            const FString& LineText = WCHAR_TO_TCHAR(Row[HeaderMap[TEXT("text")]]);
-            const FString& LineCharacter = HeaderMap.Contains(TEXT("character")) ? WCHAR_TO_TCHAR(Row[HeaderMap[TEXT("character")]]) : TEXT("");
-
+            const FString& LineID = Translated.Key;
             auto Source = LocTextHelper.FindSourceText(NamespaceKey, FLocKey(LineID));
 
             FLocItem SourceText = Source.IsValid() ? Source->Source : FLocItem();
-            FLocItem Translation((!LineCharacter.IsEmpty() ? LineCharacter + TEXT(": ") : TEXT("")) + LineText);
+            FLocItem Translation(Translated.Value);
 
             const auto LocEntry = MakeShared<FArchiveEntry>(NamespaceKey, FLocKey(LineID), SourceText, Translation, nullptr, false);
 
@@ -433,6 +427,190 @@ void UYarnAssetFactory::BuildLocalizationTarget(const UYarnProject* YarnProject,
 }
 
 
+void UYarnAssetFactory::BuildPluralRules(UYarnProject* YarnProject) const
+{
+    YarnProject->PluralRules.Reset();
+
+    TOptional<FYarnProjectMetaData> ProjectMeta = FYarnProjectMetaData::FromAsset(YarnProject);
+    TArray<FString> Cultures;
+    // Yarn's own default when a project doesn't say
+    Cultures.Add(ProjectMeta.IsSet() ? ProjectMeta->baseLanguage : TEXT("en"));
+    if (ProjectMeta.IsSet())
+    {
+        for (const auto& Loc : ProjectMeta->localisation)
+        {
+            Cultures.AddUnique(Loc.Key);
+        }
+    }
+
+    for (const FString& Culture : Cultures)
+    {
+        FYarnCultureRules& Rules = YarnProject->PluralRules.AddDefaulted_GetRef();
+        if (!FYarnCldrPluralRules::Build(Culture, Rules))
+        {
+            YS_WARN("No plural rules for '%s'; its [plural] and [ordinal] markup will always use 'other'", *Culture)
+        }
+    }
+}
+
+
+void UYarnAssetFactory::BuildLocalizedStrings(UYarnProject* YarnProject, const Yarn::CompilerOutput& CompilerOutput) const
+{
+    YarnProject->LocalizedStrings.Reset();
+
+    TOptional<FYarnProjectMetaData> ProjectMeta = FYarnProjectMetaData::FromAsset(YarnProject);
+    if (!ProjectMeta.IsSet())
+    {
+        return;
+    }
+
+    TMap<FString, TMap<FString, FString>> TranslationsByCulture;
+    for (const auto& Loc : ProjectMeta->localisation)
+    {
+        // The base language's text is already in the project
+        if (Loc.Key == ProjectMeta->baseLanguage)
+        {
+            continue;
+        }
+        ReadStringsFile(YarnProject, Loc.Key, Loc.Value, TranslationsByCulture.Add(Loc.Key));
+    }
+
+    for (const auto& CultureTranslations : TranslationsByCulture)
+    {
+        const FString& Culture = CultureTranslations.Key;
+
+        // Resolve each line's fallbacks now, so the runtime never has to: the culture, then its parents, then the base text
+        TArray<const TMap<FString, FString>*> Chain;
+        const FCulturePtr CultureInfo = FInternationalization::Get().GetCulture(Culture);
+        const TArray<FString> ParentNames = CultureInfo.IsValid() ? CultureInfo->GetPrioritizedParentCultureNames() : TArray<FString>{Culture};
+        for (const FString& ParentName : ParentNames)
+        {
+            if (const TMap<FString, FString>* Parent = TranslationsByCulture.Find(ParentName))
+            {
+                Chain.AddUnique(Parent);
+            }
+        }
+
+        const FYarnLineTable& LineTable = YarnProject->LineTable;
+        TArray<FString> LineTexts;
+        LineTexts.Reserve(LineTable.Num());
+        int32 NumUntranslated = 0;
+        for (int32 LineIndex = 0; LineIndex < LineTable.Num(); LineIndex++)
+        {
+            const FString LineID(LineTable.GetID(LineIndex));
+            const FString* Text = nullptr;
+            for (const TMap<FString, FString>* Translations : Chain)
+            {
+                if ((Text = Translations->Find(LineID)) != nullptr)
+                {
+                    break;
+                }
+            }
+            if (Text)
+            {
+                LineTexts.Add(*Text);
+            }
+            else
+            {
+                // The line table's text has had its markup parsed out, so start again from the compiler's
+                const auto BaseText = CompilerOutput.strings().find(TCHAR_TO_UTF8(*LineID));
+                LineTexts.Add(BaseText != CompilerOutput.strings().end() ? FString(UTF8_TO_TCHAR(BaseText->second.text().c_str())) : FString(LineTable.GetText(LineIndex)));
+                NumUntranslated++;
+            }
+        }
+        if (NumUntranslated > 0)
+        {
+            YS_WARN("%d lines have no '%s' translation and will use the base text", NumUntranslated, *Culture)
+        }
+
+        const FString PackageName = YarnProject->GetLocAssetPackage(FName(Culture)) / (YarnProject->GetName() + TEXT("_Strings"));
+        const FName AssetName = FName(FPackageName::GetShortName(PackageName));
+
+        UPackage* Package = FPackageName::DoesPackageExist(PackageName) ? LoadPackage(nullptr, *PackageName, LOAD_NoWarn) : nullptr;
+        UYarnLocalizedStrings* Strings = Package ? FindObject<UYarnLocalizedStrings>(Package, *AssetName.ToString()) : nullptr;
+        const bool bCreated = !Strings;
+        if (bCreated)
+        {
+            Package = CreatePackage(*PackageName);
+            Strings = NewObject<UYarnLocalizedStrings>(Package, AssetName, RF_Public | RF_Standalone);
+        }
+
+        YarnProject->LocalizedStrings.Add(FName(Culture), Strings);
+
+        const double SetStart = FPlatformTime::Seconds();
+        const bool bChanged = Strings->SetLines(FName(Culture), LineTexts, YarnProject->FindPluralRules(FName(Culture)));
+        YS_LOG("Built %s line text for %s, parsing its markup in %.2f ms", *Culture, *YarnProject->GetName(), (FPlatformTime::Seconds() - SetStart) * 1000.0)
+        if (!bChanged && !bCreated)
+        {
+            continue;
+        }
+
+        Package->MarkPackageDirty();
+        const FString FileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
+        FSavePackageArgs SaveArgs;
+        SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+        if (!UPackage::SavePackage(Package, Strings, *FileName, SaveArgs))
+        {
+            YS_WARN("Could not save '%s' strings to %s", *Culture, *FileName)
+            continue;
+        }
+        if (bCreated)
+        {
+            FAssetRegistryModule::AssetCreated(Strings);
+        }
+        YS_LOG("Saved %d '%s' lines to %s", LineTexts.Num(), *Culture, *FileName)
+    }
+}
+
+
+bool UYarnAssetFactory::ReadStringsFile(const UYarnProject* YarnProject, const FString& Culture, const FYarnProjectLocalizationData& LocData, TMap<FString, FString>& OutTranslations)
+{
+    FString LocFile = FPaths::Combine(YarnProject->YarnProjectPath(), LocData.strings);
+    FPaths::NormalizeFilename(LocFile);
+    FPaths::CollapseRelativeDirectories(LocFile);
+    FPaths::RemoveDuplicateSlashes(LocFile);
+    FString LocFileData;
+
+    if (!FFileHelper::LoadFileToString(LocFileData, *LocFile))
+    {
+        YS_WARN("Couldn't load strings file '%s' for locale '%s'", *LocFile, *Culture)
+        return false;
+    }
+
+    const FCsvParser Parser(LocFileData);
+    const FCsvParser::FRows& Rows = Parser.GetRows();
+    if (Rows.Num() < 2)
+    {
+        YS_WARN("Empty strings file: %s", *LocFile)
+        return false;
+    }
+
+    const auto& HeaderRow = Rows[0];
+    TMap<FString, int32> HeaderMap;
+    for (int32 I = 0; I < HeaderRow.Num(); ++I)
+    {
+        HeaderMap.Add(WCHAR_TO_TCHAR(HeaderRow[I]), I);
+    }
+    // Test for required columns
+    if (!HeaderMap.Contains(TEXT("text")) || !HeaderMap.Contains(TEXT("id")))
+    {
+        YS_ERR("Missing required column 'id' or 'text' in strings file: %s", *LocFile)
+        return false;
+    }
+
+    for (int32 I = 1; I < Rows.Num(); ++I)
+    {
+        const auto& Row = Rows[I];
+        const FString& LineID = WCHAR_TO_TCHAR(Row[HeaderMap[TEXT("id")]]);
+        const FString& LineText = WCHAR_TO_TCHAR(Row[HeaderMap[TEXT("text")]]);
+        const FString& LineCharacter = HeaderMap.Contains(TEXT("character")) ? WCHAR_TO_TCHAR(Row[HeaderMap[TEXT("character")]]) : TEXT("");
+
+        OutTranslations.Add(LineID, (!LineCharacter.IsEmpty() ? LineCharacter + TEXT(": ") : TEXT("")) + LineText);
+    }
+    return true;
+}
+
+
 void UYarnAssetFactory::CompileTexts(const ULocalizationTarget* LocalizationTarget)
 {
     // This version launches the text compilation commandlet in a separate process.  To implement this directly instead, see GenerateTextLocalizationResourceCommandlet.cpp
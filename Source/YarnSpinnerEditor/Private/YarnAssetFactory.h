@@ -53,6 +53,12 @@ public:
 private:
     // Set up localization target for the Yarn project
     void BuildLocalizationTarget(const UYarnProject* YarnProject, const Yarn::CompilerOutput& CompilerOutput) const;
+    // Compile the plural rules for the base language and each translated culture into the project
+    void BuildPluralRules(UYarnProject* YarnProject) const;
+    // Save each translated culture's line text as a UYarnLocalizedStrings asset next to its other localised assets
+    void BuildLocalizedStrings(UYarnProject* YarnProject, const Yarn::CompilerOutput& CompilerOutput) const;
+    // Line ID -> translated text (with the character name, if any) from a culture's strings file
+    static bool ReadStringsFile(const UYarnProject* YarnProject, const FString& Culture, const struct FYarnProjectLocalizationData& LocData, TMap<FString, FString>& OutTranslations);
     // Compile all texts
     static void CompileTexts(const ULocalizationTarget* LocalizationTarget);
 };
@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "YarnCldrPluralRules.h"
+
+
+namespace
+{
+    struct FRule
+    {
+        const TCHAR* Language;
+        bool bOrdinal;
+        EYarnPluralCategory Category;
+        // CLDR syntax.  Empty for languages whose only category is Other.
+        const TCHAR* Condition;
+    };
+
+    // From CLDR's plurals.xml and ordinals.xml.  Conditions on the compact exponent (e) are dropped, as it's always 0.
+    const FRule Rules[] = {
+        {TEXT("ar"), false, EYarnPluralCategory::Zero, TEXT("n = 0")},
+        {TEXT("ar"), false, EYarnPluralCategory::One, TEXT("n = 1")},
+        {TEXT("ar"), false, EYarnPluralCategory::Two, TEXT("n = 2")},
+        {TEXT("ar"), false, EYarnPluralCategory::Few, TEXT("n % 100 = 3..10")},
+        {TEXT("ar"), false, EYarnPluralCategory::Many, TEXT("n % 100 = 11..99")},
+
+        {TEXT("bg"), false, EYarnPluralCategory::One, TEXT("n = 1")},
+
+        {TEXT("ca"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("ca"), false, EYarnPluralCategory::Many, TEXT("i != 0 and i % 1000000 = 0 and v = 0")},
+        {TEXT("ca"), true, EYarnPluralCategory::One, TEXT("n = 1,3")},
+        {TEXT("ca"), true, EYarnPluralCategory::Two, TEXT("n = 2")},
+        {TEXT("ca"), true, EYarnPluralCategory::Few, TEXT("n = 4")},
+
+        {TEXT("cs"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("cs"), false, EYarnPluralCategory::Few, TEXT("i = 2..4 and v = 0")},
+        {TEXT("cs"), false, EYarnPluralCategory::Many, TEXT("v != 0")},
+
+        {TEXT("da"), false, EYarnPluralCategory::One, TEXT("n = 1 or t != 0 and i = 0,1")},
+
+        {TEXT("de"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+
+        {TEXT("el"), false, EYarnPluralCategory::One, TEXT("n = 1")},
+
+        {TEXT("en"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("en"), true, EYarnPluralCategory::One, TEXT("n % 10 = 1 and n % 100 != 11")},
+        {TEXT("en"), true, EYarnPluralCategory::Two, TEXT("n % 10 = 2 and n % 100 != 12")},
+        {TEXT("en"), true, EYarnPluralCategory::Few, TEXT("n % 10 = 3 and n % 100 != 13")},
+
+        {TEXT("es"), false, EYarnPluralCategory::One, TEXT("n = 1")},
+        {TEXT("es"), false, EYarnPluralCategory::Many, TEXT("i != 0 and i % 1000000 = 0 and v = 0")},
+
+        {TEXT("et"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+
+        {TEXT("fi"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+
+        {TEXT("fr"), false, EYarnPluralCategory::One, TEXT("i = 0,1")},
+        {TEXT("fr"), false, EYarnPluralCategory::Many, TEXT("i != 0 and i % 1000000 = 0 and v = 0")},
+        {TEXT("fr"), true, EYarnPluralCategory::One, TEXT("n = 1")},
+
+        {TEXT("he"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0 or i = 0 and v != 0")},
+        {TEXT("he"), false, EYarnPluralCategory::Two, TEXT("i = 2 and v = 0")},
+
+        {TEXT("hu"), false, EYarnPluralCategory::One, TEXT("n = 1")},
+        {TEXT("hu"), true, EYarnPluralCategory::One, TEXT("n = 1,5")},
+
+        {TEXT("id"), false, EYarnPluralCategory::Other, TEXT("")},
+
+        {TEXT("it"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("it"), false, EYarnPluralCategory::Many, TEXT("i != 0 and i % 1000000 = 0 and v = 0")},
+        {TEXT("it"), true, EYarnPluralCategory::Many, TEXT("n = 11,8,80,800")},
+
+        {TEXT("ja"), false, EYarnPluralCategory::Other, TEXT("")},
+
+        {TEXT("ko"), false, EYarnPluralCategory::Other, TEXT("")},
+
+        {TEXT("ms"), false, EYarnPluralCategory::Other, TEXT("")},
+        {TEXT("ms"), true, EYarnPluralCategory::One, TEXT("n = 1")},
+
+        {TEXT("nb"), false, EYarnPluralCategory::One, TEXT("n = 1")},
+        {TEXT("no"), false, EYarnPluralCategory::One, TEXT("n = 1")},
+
+        {TEXT("nl"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+
+        {TEXT("pl"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("pl"), false, EYarnPluralCategory::Few, TEXT("v = 0 and i % 10 = 2..4 and i % 100 != 12..14")},
+        {TEXT("pl"), false, EYarnPluralCategory::Many, TEXT("v = 0 and i != 1 and i % 10 = 0..1 or v = 0 and i % 10 = 5..9 or v = 0 and i % 100 = 12..14")},
+
+        {TEXT("pt"), false, EYarnPluralCategory::One, TEXT("i = 0..1")},
+        {TEXT("pt"), false, EYarnPluralCategory::Many, TEXT("i != 0 and i % 1000000 = 0 and v = 0")},
+        {TEXT("pt-PT"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("pt-PT"), false, EYarnPluralCategory::Many, TEXT("i != 0 and i % 1000000 = 0 and v = 0")},
+
+        {TEXT("ro"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("ro"), false, EYarnPluralCategory::Few, TEXT("v != 0 or n = 0 or n != 1 and n % 100 = 1..19")},
+        {TEXT("ro"), true, EYarnPluralCategory::One, TEXT("n = 1")},
+
+        {TEXT("ru"), false, EYarnPluralCategory::One, TEXT("v = 0 and i % 10 = 1 and i % 100 != 11")},
+        {TEXT("ru"), false, EYarnPluralCategory::Few, TEXT("v = 0 and i % 10 = 2..4 and i % 100 != 12..14")},
+        {TEXT("ru"), false, EYarnPluralCategory::Many, TEXT("v = 0 and i % 10 = 0 or v = 0 and i % 10 = 5..9 or v = 0 and i % 100 = 11..14")},
+
+        {TEXT("sk"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("sk"), false, EYarnPluralCategory::Few, TEXT("i = 2..4 and v = 0")},
+        {TEXT("sk"), false, EYarnPluralCategory::Many, TEXT("v != 0")},
+
+        {TEXT("sv"), false, EYarnPluralCategory::One, TEXT("i = 1 and v = 0")},
+        {TEXT("sv"), true, EYarnPluralCategory::One, TEXT("n % 10 = 1,2 and n % 100 != 11,12")},
+
+        {TEXT("th"), false, EYarnPluralCategory::Other, TEXT("")},
+
+        {TEXT("tr"), false, EYarnPluralCategory::One, TEXT("n = 1")},
+
+        {TEXT("uk"), false, EYarnPluralCategory::One, TEXT("v = 0 and i % 10 = 1 and i % 100 != 11")},
+        {TEXT("uk"), false, EYarnPluralCategory::Few, TEXT("v = 0 and i % 10 = 2..4 and i % 100 != 12..14")},
+        {TEXT("uk"), false, EYarnPluralCategory::Many, TEXT("v = 0 and i % 10 = 0 or v = 0 and i % 10 = 5..9 or v = 0 and i % 100 = 11..14")},
+        {TEXT("uk"), true, EYarnPluralCategory::Few, TEXT("n % 10 = 3 and n % 100 != 13")},
+
+        {TEXT("vi"), false, EYarnPluralCategory::Other, TEXT("")},
+        {TEXT("vi"), true, EYarnPluralCategory::One, TEXT("n = 1")},
+
+        {TEXT("zh"), false, EYarnPluralCategory::Other, TEXT("")},
+    };
+
+    bool HasLanguage(const FString& Language)
+    {
+        for (const FRule& Rule : Rules)
+        {
+            if (Language.Equals(Rule.Language, ESearchCase::IgnoreCase))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+
+bool FYarnCldrPluralRules::Build(const FString& Culture, FYarnCultureRules& OutRules)
+{
+    OutRules = FYarnCultureRules();
+    OutRules.Culture = FName(Culture);
+
+    FString Language = Culture.Replace(TEXT("_"), TEXT("-"));
+    if (!HasLanguage(Language))
+    {
+        int32 Dash;
+        if (!Language.FindChar(TEXT('-'), Dash) || !HasLanguage(Language.Left(Dash)))
+        {
+            return false;
+        }
+        Language.LeftInline(Dash);
+    }
+
+    for (const FRule& Rule : Rules)
+    {
+        if (Language.Equals(Rule.Language, ESearchCase::IgnoreCase))
+        {
+            FYarnPluralRules& Target = Rule.bOrdinal ? OutRules.Ordinal : OutRules.Cardinal;
+            Target.AddRule(Rule.Category, Rule.Condition);
+        }
+    }
+    return true;
+}
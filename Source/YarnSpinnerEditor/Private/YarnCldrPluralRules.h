@@ -0,0 +1,18 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "YarnPluralRules.h"
+
+
+/**
+ * CLDR's plural rules for the languages Yarn projects are most often translated into, compiled into FYarnCultureRules
+ * on import.  Only needed in the editor; cooked projects carry the compiled rules for their own cultures.
+ */
+struct FYarnCldrPluralRules
+{
+    // Compiles the rules for the culture, or for its language if there are none for the culture itself (pt-PT has its
+    // own; de-AT uses de's).  Returns false, with Other for everything, if there are no rules for the language.
+    static bool Build(const FString& Culture, FYarnCultureRules& OutRules);
+};
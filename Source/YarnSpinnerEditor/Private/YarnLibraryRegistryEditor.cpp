@@ -3,16 +3,23 @@
 
 #include "YarnLibraryRegistryEditor.h"
 
+#include "JsonObjectConverter.h"
 #include "K2Node_FunctionEntry.h"
 #include "K2Node_FunctionResult.h"
 #include "AssetRegistry/IAssetRegistry.h"
+#include "Engine/Blueprint.h"
 #include "Internationalization/Regex.h"
+#include "UObject/SavePackage.h"
 #include "Library/YarnCommandLibrary.h"
 #include "Library/YarnFunctionLibrary.h"
+#include "Library/YarnLibraryIndex.h"
 #include "Library/YarnLibraryRegistry.h"
+#include "Library/YarnNativeFunctionRegistry.h"
 #include "Library/YarnSpinnerLibraryData.h"
 #include "Misc/DefaultValueHelper.h"
 #include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/SecureHash.h"
 #include "Misc/YarnAssetHelpers.h"
 #include "Misc/YarnValueHelpers.h"
 #include "Misc/YSLogging.h"
@@ -44,91 +51,306 @@ void UYarnLibraryRegistryEditor::BeginDestroy()
     AssetRegistry.OnFilesLoaded().Remove(OnAssetRegistryFilesLoadedHandle);
     AssetRegistry.OnAssetAdded().Remove(OnAssetAddedHandle);
     AssetRegistry.OnAssetRemoved().Remove(OnAssetRemovedHandle);
+    AssetRegistry.OnAssetUpdated().Remove(OnAssetUpdatedHandle);
     AssetRegistry.OnAssetRenamed().Remove(OnAssetRenamedHandle);
 }
 
 
-UBlueprint* UYarnLibraryRegistryEditor::GetYarnFunctionLibraryBlueprint(const FAssetData& AssetData)
+UYarnLibraryRegistryEditor::ELibraryKind UYarnLibraryRegistryEditor::GetLibraryKind(const FAssetData& AssetData)
 {
-    UBlueprint* BP = Cast<UBlueprint>(AssetData.GetAsset());
+    FString NativeParentClassPath;
+    if (!AssetData.GetTagValue(FBlueprintTags::NativeParentClassPath, NativeParentClassPath))
+    {
+        return ELibraryKind::None;
+    }
 
-    if (!BP)
+    // Native classes are always loaded, so this never loads anything
+    const UClass* NativeParentClass = FSoftClassPath(FPackageName::ExportTextPathToObjectPath(NativeParentClassPath)).ResolveClass();
+    if (!NativeParentClass)
     {
-        // YS_LOG_FUNC("Could not cast asset to UBlueprint")
-        return nullptr;
+        return ELibraryKind::None;
     }
-    if (!BP->ParentClass->IsChildOf<UYarnFunctionLibrary>())
+    if (NativeParentClass->IsChildOf<UYarnFunctionLibrary>())
     {
-        // YS_LOG_FUNC("Blueprint is not a child of UYarnFunctionLibrary")
-        return nullptr;
+        return ELibraryKind::Function;
     }
-    if (!BP->GeneratedClass)
+    if (NativeParentClass->IsChildOf<UYarnCommandLibrary>())
     {
-        // YS_LOG_FUNC("Blueprint has no generated class")
-        return nullptr;
+        return ELibraryKind::Command;
     }
+    return ELibraryKind::None;
+}
+
 
-    return BP;
+FString UYarnLibraryRegistryEditor::HashPackage(const FAssetData& AssetData)
+{
+    FString FileName;
+    if (!FPackageName::DoesPackageExist(AssetData.PackageName.ToString(), &FileName))
+    {
+        return FString();
+    }
+    return LexToString(FMD5Hash::HashFile(*FileName));
 }
 
 
-UBlueprint* UYarnLibraryRegistryEditor::GetYarnCommandLibraryBlueprint(const FAssetData& AssetData)
+FString UYarnLibraryRegistryEditor::CacheFilePath()
 {
-    UBlueprint* BP = Cast<UBlueprint>(AssetData.GetAsset());
+    return FPaths::Combine(FPaths::ProjectIntermediateDir(), TEXT("YarnSpinner"), TEXT("LibraryCache.json"));
+}
+
 
-    if (!BP)
+void UYarnLibraryRegistryEditor::SaveYSLS()
+{
+    YS_LOG_FUNCSIG
+    // Native functions aren't found by scanning assets, so refresh them from the registry on every save
+    YSLSData.Functions.RemoveAll([](const FYSLSAction& Action) { return Action.Language == FYarnNativeFunctionRegistry::YSLSLanguage; });
+    FYarnNativeFunctionRegistry::Get().GetYSLSActions(YSLSData.Functions);
+
+    // Write .ysls file, but only if it changed
+    FString YSLSFileContents = YSLSData.ToJsonString();
+    if (YSLSFileContents != LastSavedYSLS)
     {
-        // YS_LOG_FUNC("Could not cast asset to UBlueprint")
-        return nullptr;
+        FFileHelper::SaveStringToFile(YSLSFileContents, *FYarnAssetHelpers::YSLSFilePath());
+        LastSavedYSLS = MoveTemp(YSLSFileContents);
     }
-    if (!BP->ParentClass->IsChildOf<UYarnCommandLibrary>())
+
+    SaveLibraryIndex();
+    SaveCache();
+}
+
+
+void UYarnLibraryRegistryEditor::SaveLibraryIndex()
+{
+    // Never write content in the middle of a cook
+    if (IsRunningCommandlet())
     {
-        // YS_LOG_FUNC("Blueprint is not a child of UYarnCommandLibrary")
-        return nullptr;
+        return;
     }
-    if (!BP->GeneratedClass)
+
+    const FString PackageName = FYarnAssetHelpers::LibraryIndexPackageName();
+    const FName AssetName = FName(FPackageName::GetShortName(PackageName));
+
+    UPackage* Package = FPackageName::DoesPackageExist(PackageName) ? LoadPackage(nullptr, *PackageName, LOAD_NoWarn) : nullptr;
+    UYarnLibraryIndex* Index = Package ? FindObject<UYarnLibraryIndex>(Package, *AssetName.ToString()) : nullptr;
+    const bool bCreated = !Index;
+    if (bCreated)
+    {
+        Package = CreatePackage(*PackageName);
+        Index = NewObject<UYarnLibraryIndex>(Package, AssetName, RF_Public | RF_Standalone);
+    }
+
+    // Only touch the package when the index actually changes, so it doesn't churn in source control
+    if (!Index->SetFromYSLS(YSLSData) && !bCreated)
+    {
+        return;
+    }
+
+    Package->MarkPackageDirty();
+    const FString FileName = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
+    FSavePackageArgs SaveArgs;
+    SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+    const bool bSaved = UPackage::SavePackage(Package, Index, *FileName, SaveArgs);
+    if (!bSaved)
+    {
+        YS_WARN("Could not save Yarn library index to %s", *FileName)
+        return;
+    }
+
+    if (bCreated)
     {
-        // YS_LOG_FUNC("Blueprint has no generated class")
-        return nullptr;
+        FAssetRegistryModule::AssetCreated(Index);
     }
+    YS_LOG("Saved Yarn library index (%d functions, %d commands) to %s", Index->Functions.Num(), Index->Commands.Num(), *FileName)
+}
+
 
-    return BP;
+void UYarnLibraryRegistryEditor::LoadCache()
+{
+    FString CacheJson;
+    if (!FFileHelper::LoadFileToString(CacheJson, *CacheFilePath()) || !FJsonObjectConverter::JsonObjectStringToUStruct(CacheJson, &Cache, 0, 0))
+    {
+        Cache = FYarnLibraryCache();
+    }
+    FFileHelper::LoadFileToString(LastSavedYSLS, *FYarnAssetHelpers::YSLSFilePath());
 }
 
 
-void UYarnLibraryRegistryEditor::SaveYSLS()
+void UYarnLibraryRegistryEditor::SaveCache()
 {
-    YS_LOG_FUNCSIG
-    // Write .ysls file
-    FString YSLSFileContents = YSLSData.ToJsonString();
-    FFileHelper::SaveStringToFile(YSLSFileContents, *FYarnAssetHelpers::YSLSFilePath());
+    if (!bCacheDirty)
+    {
+        return;
+    }
+
+    FString CacheJson;
+    if (FJsonObjectConverter::UStructToJsonObjectString(Cache, CacheJson))
+    {
+        FFileHelper::SaveStringToFile(CacheJson, *CacheFilePath());
+        bCacheDirty = false;
+    }
 }
 
 
 void UYarnLibraryRegistryEditor::FindFunctionsAndCommands()
 {
     YS_LOG_FUNCSIG
-    YS_LOG("Project content dir: %s", *FPaths::ProjectContentDir());
+    const double StartTime = FPlatformTime::Seconds();
+
+    LoadCache();
+    FunctionOwners.Reset();
+    CommandOwners.Reset();
 
-    TArray<FAssetData> ExistingAssets = FYarnAssetHelpers::FindAssetsInRegistryByPackagePath<UBlueprint>(FPaths::GetPath(TEXT("/Game/")));
-    // TArray<FAssetData> ExistingAssets = FYarnAssetHelpers::FindAssetsInRegistryEditor<UBlueprint>();
-    // TArray<FAssetData> ExistingAssets = FYarnAssetHelpers::FindAssetsInRegistryByPackagePath<UBlueprint>(FPaths::ProjectContentDir());
-    // TArray<FAssetData> ExistingAssets = FYarnAssetHelpers::FindAssetsInRegistryByPackagePath<UBlueprint>(FPaths::GetPath(TEXT("/")));
+    FARFilter Filter = FYarnAssetHelpers::GetClassPathFilter<UBlueprint>();
+    Filter.PackagePaths.Add(TEXT("/Game"));
+    Filter.bRecursivePaths = true;
+    const TArray<FAssetData> ExistingAssets = FYarnAssetHelpers::FindAssets(Filter);
 
-    for (auto Asset : ExistingAssets)
+    // Only Yarn libraries are looked at any further, and only changed ones are loaded
+    TSet<FString> FoundLibraries;
+    int32 Extracted = 0;
+    for (const FAssetData& Asset : ExistingAssets)
     {
-        YS_LOG_FUNC("Found Blueprint asset: %s (%s) %s", *Asset.GetFullName(), *Asset.GetPackage()->GetName(), *Asset.GetAsset()->GetPathName())
-        if (UBlueprint* BP = GetYarnFunctionLibraryBlueprint(Asset))
+        if (GetLibraryKind(Asset) == ELibraryKind::None)
+        {
+            continue;
+        }
+
+        const FString ObjectPath = Asset.ToSoftObjectPath().ToString();
+        FoundLibraries.Add(ObjectPath);
+
+        const FYarnLibraryCacheEntry* Cached = Cache.Libraries.Find(ObjectPath);
+        if (Cached && Cached->Hash == HashPackage(Asset))
         {
-            ImportFunctions(BP);
+            SetOwners(ObjectPath, Cached);
+            continue;
         }
-        if (UBlueprint* BP = GetYarnCommandLibraryBlueprint(Asset))
+        RefreshLibrary(Asset, true);
+        Extracted++;
+    }
+
+    // Forget libraries that were deleted while the editor was closed
+    for (auto It = Cache.Libraries.CreateIterator(); It; ++It)
+    {
+        if (!FoundLibraries.Contains(It.Key()))
         {
-            ImportCommands(BP);
+            It.RemoveCurrent();
+            bCacheDirty = true;
         }
     }
 
+    // Rebuild the .ysls data in a stable order
+    Cache.Libraries.KeySort(TLess<FString>());
+    YSLSData.Functions.Reset();
+    YSLSData.Commands.Reset();
+    for (const auto& Library : Cache.Libraries)
+    {
+        YSLSData.Functions.Append(Library.Value.Functions);
+        YSLSData.Commands.Append(Library.Value.Commands);
+    }
+
     SaveYSLS();
+
+    YS_LOG("Found %d Yarn libraries among %d Blueprints in %.2f ms (%d extracted, %d from cache)",
+        FoundLibraries.Num(), ExistingAssets.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0, Extracted, FoundLibraries.Num() - Extracted)
+}
+
+
+bool UYarnLibraryRegistryEditor::RefreshLibrary(const FAssetData& AssetData, bool bForce)
+{
+    const FString ObjectPath = AssetData.ToSoftObjectPath().ToString();
+    const ELibraryKind Kind = GetLibraryKind(AssetData);
+    if (Kind == ELibraryKind::None)
+    {
+        // It may have been reparented away from a Yarn library
+        return RemoveLibrary(ObjectPath);
+    }
+
+    const FString Hash = HashPackage(AssetData);
+    const FYarnLibraryCacheEntry* Cached = Cache.Libraries.Find(ObjectPath);
+    if (!bForce && Cached && Cached->Hash == Hash)
+    {
+        return false;
+    }
+
+    UBlueprint* BP = Cast<UBlueprint>(AssetData.GetAsset());
+    if (!BP || !BP->GeneratedClass)
+    {
+        return RemoveLibrary(ObjectPath);
+    }
+
+    FYarnLibraryCacheEntry Entry;
+    Entry.Hash = Hash;
+    if (Kind == ELibraryKind::Function)
+    {
+        ExtractFunctions(BP, Entry.Functions);
+    }
+    else
+    {
+        ExtractCommands(BP, Entry.Commands);
+    }
+
+    SetOwners(ObjectPath, &Entry);
+    PatchYSLSData(ObjectPath, &Entry);
+    Cache.Libraries.Add(ObjectPath, MoveTemp(Entry));
+    bCacheDirty = true;
+    return true;
+}
+
+
+bool UYarnLibraryRegistryEditor::RemoveLibrary(const FString& ObjectPath)
+{
+    if (!Cache.Libraries.Contains(ObjectPath))
+    {
+        return false;
+    }
+
+    SetOwners(ObjectPath, nullptr);
+    PatchYSLSData(ObjectPath, nullptr);
+    Cache.Libraries.Remove(ObjectPath);
+    bCacheDirty = true;
+    return true;
+}
+
+
+void UYarnLibraryRegistryEditor::PatchYSLSData(const FString& ObjectPath, const FYarnLibraryCacheEntry* Entry)
+{
+    auto IsFromLibrary = [&ObjectPath](const FYSLSAction& Action) { return Action.FileName == ObjectPath; };
+    YSLSData.Functions.RemoveAll(IsFromLibrary);
+    YSLSData.Commands.RemoveAll(IsFromLibrary);
+
+    if (Entry)
+    {
+        YSLSData.Functions.Append(Entry->Functions);
+        YSLSData.Commands.Append(Entry->Commands);
+    }
+}
+
+
+void UYarnLibraryRegistryEditor::SetOwners(const FString& ObjectPath, const FYarnLibraryCacheEntry* Entry)
+{
+    auto IsOwnedByLibrary = [&ObjectPath](const TPair<FName, FString>& Owner) { return Owner.Value == ObjectPath; };
+    for (auto It = FunctionOwners.CreateIterator(); It; ++It)
+    {
+        if (IsOwnedByLibrary(*It))
+            It.RemoveCurrent();
+    }
+    for (auto It = CommandOwners.CreateIterator(); It; ++It)
+    {
+        if (IsOwnedByLibrary(*It))
+            It.RemoveCurrent();
+    }
+
+    if (Entry)
+    {
+        for (const FYSLSAction& Action : Entry->Functions)
+        {
+            FunctionOwners.Add(FName(Action.DefinitionName), ObjectPath);
+        }
+        for (const FYSLSAction& Action : Entry->Commands)
+        {
+            CommandOwners.Add(FName(Action.DefinitionName), ObjectPath);
+        }
+    }
 }
 
 
@@ -298,16 +520,13 @@ void UYarnLibraryRegistryEditor::ExtractFunctionDataFromBlueprintGraph(UBlueprin
 }
 
 
-void UYarnLibraryRegistryEditor::AddToYSLSData(FYarnBlueprintLibFunction FuncDetails)
+FYSLSAction UYarnLibraryRegistryEditor::MakeYSLSAction(const FYarnBlueprintLibFunction& FuncDetails)
 {
-    // convert to .ysls
-    
     const bool bIsCommand = !FuncDetails.OutParam.IsSet();
     
     FYSLSAction Action;
     Action.YarnName = FuncDetails.Name.ToString();
     Action.DefinitionName = FuncDetails.Name.ToString();
-    Action.DefinitionName = FuncDetails.Name.ToString();
     Action.FileName = FuncDetails.Library->GetPathName();
     
     if (bIsCommand)
@@ -323,7 +542,6 @@ void UYarnLibraryRegistryEditor::AddToYSLSData(FYarnBlueprintLibFunction FuncDet
             Action.Parameters.Add(Parameter);
             Action.Signature += " " + Parameter.Name;
         }
-        YSLSData.Commands.Add(Action);
     }
     else
     {
@@ -342,11 +560,13 @@ void UYarnLibraryRegistryEditor::AddToYSLSData(FYarnBlueprintLibFunction FuncDet
             Action.Signature.LeftInline(Action.Signature.Len() - 2);
         }
         Action.Signature += ")";
-        YSLSData.Functions.Add(Action);
     }
+
+    return Action;
 }
 
-void UYarnLibraryRegistryEditor::ImportFunctions(UBlueprint* YarnFunctionLibrary)
+
+void UYarnLibraryRegistryEditor::ExtractFunctions(UBlueprint* YarnFunctionLibrary, TArray<FYSLSAction>& OutActions) const
 {
     if (!YarnFunctionLibrary)
     {
@@ -354,10 +574,6 @@ void UYarnLibraryRegistryEditor::ImportFunctions(UBlueprint* YarnFunctionLibrary
         return;
     }
 
-    // Store a reference to the Blueprint library
-    FunctionLibraries.Add(YarnFunctionLibrary);
-    LibFunctions.Add(YarnFunctionLibrary, {});
-
     for (UEdGraph* Func : YarnFunctionLibrary->FunctionGraphs)
     {
         FYarnBlueprintLibFunction FuncDetails;
@@ -390,7 +606,8 @@ void UYarnLibraryRegistryEditor::ImportFunctions(UBlueprint* YarnFunctionLibrary
                 YS_WARN("Function '%s' has invalid parameter types. Yarn functions only support boolean, float and string.", *FuncDetails.Name.ToString())
             }
             // Check name is unique
-            if (AllFunctions.Contains(FuncDetails.Name) && AllFunctions[FuncDetails.Name].Library != FuncDetails.Library)
+            const FString* Owner = FunctionOwners.Find(FuncDetails.Name);
+            if (Owner && *Owner != YarnFunctionLibrary->GetPathName())
             {
                 bIsValid = false;
                 YS_WARN("Function '%s' already exists in another Blueprint.  Yarn function names must be unique.", *FuncDetails.Name.ToString())
@@ -410,17 +627,14 @@ void UYarnLibraryRegistryEditor::ImportFunctions(UBlueprint* YarnFunctionLibrary
             if (bIsValid)
             {
                 YS_LOG("Adding function '%s' to available YarnSpinner functions.", *FuncDetails.Name.ToString())
-                LibFunctions.FindOrAdd(YarnFunctionLibrary).Add(FuncDetails.Name);
-                AllFunctions.Add(FuncDetails.Name, FuncDetails);
-
-                AddToYSLSData(FuncDetails);
+                OutActions.Add(MakeYSLSAction(FuncDetails));
             }
         }
     }
 }
 
 
-void UYarnLibraryRegistryEditor::ImportCommands(UBlueprint* YarnCommandLibrary)
+void UYarnLibraryRegistryEditor::ExtractCommands(UBlueprint* YarnCommandLibrary, TArray<FYSLSAction>& OutActions) const
 {
     if (!YarnCommandLibrary)
     {
@@ -428,10 +642,6 @@ void UYarnLibraryRegistryEditor::ImportCommands(UBlueprint* YarnCommandLibrary)
         return;
     }
 
-    // Store a reference to the Blueprint library
-    CommandLibraries.Add(YarnCommandLibrary);
-    LibCommands.FindOrAdd(YarnCommandLibrary);
-
     for (UEdGraph* Func : YarnCommandLibrary->EventGraphs)
     {
         FYarnBlueprintLibFunction FuncDetails;
@@ -463,7 +673,8 @@ void UYarnLibraryRegistryEditor::ImportCommands(UBlueprint* YarnCommandLibrary)
             YS_WARN("Function '%s' has invalid parameter types. Yarn commands only support boolean, float and string.", *FuncDetails.Name.ToString())
         }
         // Check name is unique
-        if (AllFunctions.Contains(FuncDetails.Name) && AllFunctions[FuncDetails.Name].Library != FuncDetails.Library)
+        const FString* Owner = CommandOwners.Find(FuncDetails.Name);
+        if (Owner && *Owner != YarnCommandLibrary->GetPathName())
         {
             bIsValid = false;
             YS_WARN("Function '%s' already exists in another Blueprint.  Yarn command names must be unique.", *FuncDetails.Name.ToString())
@@ -483,71 +694,12 @@ void UYarnLibraryRegistryEditor::ImportCommands(UBlueprint* YarnCommandLibrary)
         if (bIsValid)
         {
             YS_LOG("Adding command '%s' to available YarnSpinner commands.", *FuncDetails.Name.ToString())
-            LibCommands.FindOrAdd(YarnCommandLibrary).Add(FuncDetails.Name);
-            AllCommands.Add(FuncDetails.Name, FuncDetails);
-
-            AddToYSLSData(FuncDetails);
+            OutActions.Add(MakeYSLSAction(FuncDetails));
         }
     }
 }
 
 
-void UYarnLibraryRegistryEditor::UpdateFunctions(UBlueprint* YarnFunctionLibrary)
-{
-    RemoveFunctions(YarnFunctionLibrary);
-    ImportFunctions(YarnFunctionLibrary);
-}
-
-
-void UYarnLibraryRegistryEditor::UpdateCommands(UBlueprint* YarnCommandLibrary)
-{
-    RemoveCommands(YarnCommandLibrary);
-    ImportCommands(YarnCommandLibrary);
-}
-
-
-void UYarnLibraryRegistryEditor::RemoveFunctions(UBlueprint* YarnFunctionLibrary)
-{
-    if (FunctionLibraries.Contains(YarnFunctionLibrary))
-    {
-        if (LibFunctions.Contains(YarnFunctionLibrary))
-        {
-            for (auto FuncName : LibFunctions[YarnFunctionLibrary])
-            {
-                if (AllFunctions.Contains(FuncName) && AllFunctions[FuncName].Library == YarnFunctionLibrary)
-                {
-                    AllFunctions.Remove(FuncName);
-                }
-                YSLSData.Functions.RemoveAll([FuncName](const FYSLSAction& F) { return F.DefinitionName == FuncName.ToString(); });
-            }
-            LibFunctions.Remove(YarnFunctionLibrary);
-        }
-        FunctionLibraries.Remove(YarnFunctionLibrary);
-    }
-}
-
-
-void UYarnLibraryRegistryEditor::RemoveCommands(UBlueprint* YarnCommandLibrary)
-{
-    if (CommandLibraries.Contains(YarnCommandLibrary))
-    {
-        if (LibCommands.Contains(YarnCommandLibrary))
-        {
-            for (auto FuncName : LibCommands[YarnCommandLibrary])
-            {
-                if (AllCommands.Contains(FuncName) && AllCommands[FuncName].Library == YarnCommandLibrary)
-                {
-                    AllCommands.Remove(FuncName);
-                }
-                YSLSData.Commands.RemoveAll([FuncName](const FYSLSAction& F) { return F.DefinitionName == FuncName.ToString(); });
-            }
-            LibCommands.Remove(YarnCommandLibrary);
-        }
-        CommandLibraries.Remove(YarnCommandLibrary);
-    }
-}
-
-
 void UYarnLibraryRegistryEditor::OnAssetRegistryFilesLoaded()
 {
     YS_LOG_FUNCSIG
@@ -562,16 +714,8 @@ void UYarnLibraryRegistryEditor::OnAssetAdded(const FAssetData& AssetData)
     if (!bRegistryEditorFilesLoaded)
         return;
 
-    YS_LOG_FUNCSIG
-
-    if (UBlueprint* BP = GetYarnFunctionLibraryBlueprint(AssetData))
+    if (GetLibraryKind(AssetData) != ELibraryKind::None && RefreshLibrary(AssetData))
     {
-        ImportFunctions(BP);
-        SaveYSLS();
-    }
-    if (UBlueprint* BP = GetYarnCommandLibraryBlueprint(AssetData))
-    {
-        ImportCommands(BP);
         SaveYSLS();
     }
 }
@@ -579,14 +723,8 @@ void UYarnLibraryRegistryEditor::OnAssetAdded(const FAssetData& AssetData)
 
 void UYarnLibraryRegistryEditor::OnAssetRemoved(const FAssetData& AssetData)
 {
-    if (UBlueprint* BP = GetYarnFunctionLibraryBlueprint(AssetData))
-    {
-        RemoveFunctions(BP);
-        SaveYSLS();
-    }
-    if (UBlueprint* BP = GetYarnCommandLibraryBlueprint(AssetData))
+    if (RemoveLibrary(AssetData.ToSoftObjectPath().ToString()))
     {
-        RemoveCommands(BP);
         SaveYSLS();
     }
 }
@@ -594,29 +732,26 @@ void UYarnLibraryRegistryEditor::OnAssetRemoved(const FAssetData& AssetData)
 
 void UYarnLibraryRegistryEditor::OnAssetUpdated(const FAssetData& AssetData)
 {
-    if (UBlueprint* BP = GetYarnFunctionLibraryBlueprint(AssetData))
-    {
-        UpdateFunctions(BP);
-        SaveYSLS();
-    }
-    if (UBlueprint* BP = GetYarnCommandLibraryBlueprint(AssetData))
+    if (!bRegistryEditorFilesLoaded)
+        return;
+
+    if (RefreshLibrary(AssetData))
     {
-        UpdateCommands(BP);
         SaveYSLS();
     }
 }
 
 
-void UYarnLibraryRegistryEditor::OnAssetRenamed(const FAssetData& AssetData, const FString& String)
+void UYarnLibraryRegistryEditor::OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath)
 {
-    if (UBlueprint* BP = GetYarnFunctionLibraryBlueprint(AssetData))
-    {
-        UpdateFunctions(BP);
-        SaveYSLS();
-    }
-    if (UBlueprint* BP = GetYarnCommandLibraryBlueprint(AssetData))
+    if (!bRegistryEditorFilesLoaded)
+        return;
+
+    // The renamed Blueprint's entries record its path, so they have to be extracted again
+    const bool bRemoved = RemoveLibrary(OldObjectPath);
+    const bool bAdded = GetLibraryKind(AssetData) != ELibraryKind::None && RefreshLibrary(AssetData, true);
+    if (bRemoved || bAdded)
     {
-        UpdateCommands(BP);
         SaveYSLS();
     }
 }
@@ -624,5 +759,21 @@ void UYarnLibraryRegistryEditor::OnAssetRenamed(const FAssetData& AssetData, con
 
 void UYarnLibraryRegistryEditor::OnStartGameInstance(UGameInstance* GameInstance)
 {
-    FindFunctionsAndCommands();
+    // Everything saved is already up to date; only libraries with unsaved changes need extracting again
+    bool bChanged = false;
+    TArray<FString> ObjectPaths;
+    Cache.Libraries.GetKeys(ObjectPaths);
+    for (const FString& ObjectPath : ObjectPaths)
+    {
+        const UBlueprint* BP = FindObject<UBlueprint>(nullptr, *ObjectPath);
+        if (BP && BP->GetOutermost()->IsDirty())
+        {
+            bChanged |= RefreshLibrary(FAssetData(BP), true);
+        }
+    }
+
+    if (bChanged)
+    {
+        SaveYSLS();
+    }
 }
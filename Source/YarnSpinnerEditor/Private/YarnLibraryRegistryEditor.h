@@ -10,6 +10,35 @@
 #include "YarnLibraryRegistryEditor.generated.h"
 
 
+// What was extracted from one library Blueprint, and the hash of the package file it was extracted from.
+USTRUCT()
+struct FYarnLibraryCacheEntry
+{
+    GENERATED_BODY()
+
+    UPROPERTY()
+    FString Hash;
+
+    UPROPERTY()
+    TArray<FYSLSAction> Functions;
+
+    UPROPERTY()
+    TArray<FYSLSAction> Commands;
+};
+
+
+// Persisted between editor sessions so unchanged libraries are never loaded just to be re-read.
+USTRUCT()
+struct FYarnLibraryCache
+{
+    GENERATED_BODY()
+
+    // Keyed by the library Blueprint's object path
+    UPROPERTY()
+    TMap<FString, FYarnLibraryCacheEntry> Libraries;
+};
+
+
 /**
  * 
  */
@@ -23,21 +52,22 @@ public:
     virtual void BeginDestroy() override;
 
 private:
+    enum class ELibraryKind : uint8
+    {
+        None,
+        Function,
+        Command,
+    };
+
     FYarnSpinnerLibraryData YSLSData;
-    
-    // Blueprints that extend YarnFunctionLibrary
-    UPROPERTY()
-    TSet<UBlueprint*> FunctionLibraries;
-    UPROPERTY()
-    TSet<UBlueprint*> CommandLibraries;
+    FString LastSavedYSLS;
+
+    FYarnLibraryCache Cache;
+    bool bCacheDirty = false;
 
-    // A map of blueprints to a list of their function names
-    TMap<UBlueprint*, TArray<FName>> LibFunctions;
-    TMap<UBlueprint*, TArray<FName>> LibCommands;
-    // A map of function names to lists of details of implementations
-    TMap<FName, FYarnBlueprintLibFunction> AllFunctions;
-    TMap<FName, FYarnStdLibFunction> StdFunctions;
-    TMap<FName, FYarnBlueprintLibFunction> AllCommands;
+    // Which library each function and command name came from, to keep names unique across libraries
+    TMap<FName, FString> FunctionOwners;
+    TMap<FName, FString> CommandOwners;
 
     FDelegateHandle OnAssetRegistryFilesLoadedHandle;
     FDelegateHandle OnAssetAddedHandle;
@@ -45,30 +75,39 @@ private:
     FDelegateHandle OnAssetUpdatedHandle;
     FDelegateHandle OnAssetRenamedHandle;
     bool bRegistryEditorFilesLoaded = false;
-    
-    static UBlueprint* GetYarnFunctionLibraryBlueprint(const FAssetData& AssetData);
-    static UBlueprint* GetYarnCommandLibraryBlueprint(const FAssetData& AssetData);
+
+    // Decided from the asset registry's parent class tag, without loading the Blueprint
+    static ELibraryKind GetLibraryKind(const FAssetData& AssetData);
+    static FString HashPackage(const FAssetData& AssetData);
+    static FString CacheFilePath();
+
     void SaveYSLS();
+    // Saves the Blueprint entries of the .ysls data as the binary index the runtime loads
+    void SaveLibraryIndex();
+    void LoadCache();
+    void SaveCache();
+
+    // Full scan on editor startup; libraries whose package hash matches the cache are reused without loading
     void FindFunctionsAndCommands();
+    // Re-extracts one library if its package changed (or always, if bForce) and patches the .ysls data.  Returns true
+    // if anything changed.
+    bool RefreshLibrary(const FAssetData& AssetData, bool bForce = false);
+    // Drops a library's entries from the cache and the .ysls data.  Returns true if it was known.
+    bool RemoveLibrary(const FString& ObjectPath);
+    void PatchYSLSData(const FString& ObjectPath, const FYarnLibraryCacheEntry* Entry);
+    void SetOwners(const FString& ObjectPath, const FYarnLibraryCacheEntry* Entry);
+
     static void ExtractFunctionDataFromBlueprintGraph(UBlueprint* YarnFunctionLibrary, UEdGraph* Func, FYarnBlueprintLibFunction& FuncDetails, FYarnBlueprintLibFunctionMeta& FuncMeta, bool bExpectDialogueRunnerParam = false);
-    void AddToYSLSData(FYarnBlueprintLibFunction FuncDetails);
-    // Import functions for a given Blueprint
-    void ImportFunctions(UBlueprint* YarnFunctionLibrary);
-    // Import functions for a given Blueprint
-    void ImportCommands(UBlueprint* YarnCommandLibrary);
-    // Update functions for a given Blueprint
-    void UpdateFunctions(UBlueprint* YarnFunctionLibrary);
-    // Update functions for a given Blueprint
-    void UpdateCommands(UBlueprint* YarnCommandLibrary);
-    // Clear functions and references for a given Blueprint
-    void RemoveFunctions(UBlueprint* YarnFunctionLibrary);
-    // Clear functions and references for a given Blueprint
-    void RemoveCommands(UBlueprint* YarnCommandLibrary);
+    static FYSLSAction MakeYSLSAction(const FYarnBlueprintLibFunction& FuncDetails);
+    // Extract valid functions for a given Blueprint
+    void ExtractFunctions(UBlueprint* YarnFunctionLibrary, TArray<FYSLSAction>& OutActions) const;
+    // Extract valid commands for a given Blueprint
+    void ExtractCommands(UBlueprint* YarnCommandLibrary, TArray<FYSLSAction>& OutActions) const;
     
     void OnAssetRegistryFilesLoaded();
     void OnAssetAdded(const FAssetData& AssetData);
     void OnAssetRemoved(const FAssetData& AssetData);
     void OnAssetUpdated(const FAssetData& AssetData);
-    void OnAssetRenamed(const FAssetData& AssetData, const FString& String);
+    void OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath);
     void OnStartGameInstance(UGameInstance* GameInstance);
 };
@@ -19,6 +19,7 @@
 #include "Misc/YarnAssetHelpers.h"
 #include "Misc/YSLogging.h"
 #include "Sound/SoundWave.h"
+#include "UObject/UObjectIterator.h"
 
 
 FYarnProjectSynchronizer::FYarnProjectSynchronizer()
@@ -125,18 +126,52 @@ void FYarnProjectSynchronizer::OnAssetRegistryFilesLoaded()
 void FYarnProjectSynchronizer::OnAssetAdded(const FAssetData& AssetData) const
 {
     // TODO: check if asset is a yarn project; if so update its localisation assets
+    UpdateLineAssetIndexes(AssetData, nullptr);
 }
 
 
 void FYarnProjectSynchronizer::OnAssetRemoved(const FAssetData& AssetData) const
 {
     // TODO: check if asset is a yarn project; if so delete its localisation assets
+    const FSoftObjectPath RemovedPath = AssetData.ToSoftObjectPath();
+    UpdateLineAssetIndexes(FAssetData(), &RemovedPath);
 }
 
 
 void FYarnProjectSynchronizer::OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath) const
 {
     // TODO: check if asset is a yarn project; if so move its localisation assets
+    const FSoftObjectPath OldPath(OldObjectPath);
+    UpdateLineAssetIndexes(AssetData, &OldPath);
+}
+
+
+void FYarnProjectSynchronizer::UpdateLineAssetIndexes(const FAssetData& AddedAsset, const FSoftObjectPath* RemovedPath) const
+{
+    // Every asset is added while the registry does its first scan; projects index them when they're imported or cooked
+    const FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry");
+    if (AssetRegistryModule.Get().IsLoadingAssets())
+    {
+        return;
+    }
+
+    // Projects that aren't loaded get a fresh index when they're next cooked
+    for (TObjectIterator<UYarnProject> It; It; ++It)
+    {
+        UYarnProject* YarnProject = *It;
+        if (YarnProject->HasAnyFlags(RF_ClassDefaultObject))
+        {
+            continue;
+        }
+
+        bool bChanged = RemovedPath && YarnProject->RemoveLineAsset(*RemovedPath);
+        bChanged |= AddedAsset.IsValid() && YarnProject->AddLineAsset(AddedAsset);
+        if (bChanged)
+        {
+            YS_LOG("Updated line assets for %s", *YarnProject->GetName())
+            YarnProject->MarkPackageDirty();
+        }
+    }
 }
 
 
@@ -45,6 +45,8 @@ private:
 	void OnAssetAdded(const FAssetData& AssetData) const;
 	void OnAssetRemoved(const FAssetData& AssetData) const;
 	void OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath) const;
+	// Keeps the line asset index of every loaded Yarn project up to date as assets come and go
+	void UpdateLineAssetIndexes(const FAssetData& AddedAsset, const FSoftObjectPath* RemovedPath) const;
 
 	// Scan all YarnProjectAssets and update them as necessary.
 	void UpdateAllYarnProjects() const;